@@ -0,0 +1,183 @@
+// Copyright 2025 Sebastian Cyliax
+
+// Measures OBJ load throughput of mesh_parse_obj against the previous fgets/sscanf loader.
+// Usage: obj_load_bench [path] [size_mb]
+// If the file at path doesn't exist, an OBJ of roughly size_mb megabytes is generated first.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "../src/darray.h"
+#include "../src/mesh.h"
+
+#define DEFAULT_PATH "bench_mesh.obj"
+#define DEFAULT_SIZE_MB 1024
+
+static void generate_obj(const char* filepath, const size_t size_mb)
+{
+  FILE* file = fopen(filepath, "w");
+
+  if (!file) {
+    perror("Error creating file");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("Generating %zu MB OBJ at %s...\n", size_mb, filepath);
+
+  // grid of quads, split into two triangles each, written in row blocks
+  const size_t row_len = 1024;
+  const size_t target = size_mb * 1024 * 1024;
+  size_t written = 0;
+  size_t row = 0;
+
+  while (written < target) {
+    for (size_t i = 0; i < row_len; ++i) {
+      written += fprintf(file, "v %.6f %.6f %.6f\n", 
+        (float)i * 0.01f, (float)row * 0.01f, 0.001f * (float)((i * 7 + row * 13) % 97));
+      written += fprintf(file, "vt %.6f %.6f\n", (float)i / row_len, (float)(row % row_len) / row_len);
+    }
+
+    if (row > 0) {
+      const size_t prev = (row - 1) * row_len + 1;
+      const size_t curr = row * row_len + 1;
+
+      for (size_t i = 0; i + 1 < row_len; ++i) {
+        written += fprintf(file, "f %zu/%zu/1 %zu/%zu/1 %zu/%zu/1\n", 
+          prev + i, prev + i, curr + i, curr + i, prev + i + 1, prev + i + 1);
+        written += fprintf(file, "f %zu/%zu/1 %zu/%zu/1 %zu/%zu/1\n", 
+          prev + i + 1, prev + i + 1, curr + i, curr + i, curr + i + 1, curr + i + 1);
+      }
+    }
+
+    ++row;
+  }
+
+  fclose(file);
+}
+
+// the mesh layout of the loader mesh_parse_obj replaced, with uvs stored per face corner
+typedef struct reference_face {
+  uint32_t a, b, c;
+  uv_t tex_coords[3];
+} reference_face_t;
+
+typedef struct reference_mesh {
+  vec3_t* vertices;
+  reference_face_t* faces;
+} reference_mesh_t;
+
+// the loader mesh_parse_obj replaced, kept as the baseline
+static void reference_parse_obj(reference_mesh_t* mesh, const char* filepath)
+{
+  FILE* file = fopen(filepath, "r");
+  if (file == NULL) return;
+
+  char line[256];
+  vec3_t v = { .x = 0.f, .y = 0.f, .z = 0.f };
+  reference_face_t f = { 0 };
+  uv_t* tex_coords = NULL;
+
+  while (fgets(line, sizeof(line), file)) {
+    if (strncmp(line, "v ", 2) == 0) {
+      if (sscanf(line + 2, "%f %f %f", &v.x, &v.y, &v.z) == 3)
+        darray_push(mesh->vertices, v);
+    }
+
+    if (strncmp(line, "vt ", 3) == 0) {
+      uv_t uv;
+
+      if (sscanf(line + 3, "%f %f", &uv.u, &uv.v) == 2) {
+        uv.v = 1.f - uv.v;
+        darray_push(tex_coords, uv);
+      }
+    }
+
+    if (strncmp(line, "f ", 2) == 0) {
+      size_t a, b, c;
+      int tex_idx[3];
+      int n[3];
+
+      if (sscanf(line + 2, "%zu/%d/%d %zu/%d/%d %zu/%d/%d", 
+        &a, &tex_idx[0], &n[0], &b, &tex_idx[1], &n[1], &c, &tex_idx[2], &n[2]) == 9) {
+        f.a = (uint32_t)(a - 1);
+        f.b = (uint32_t)(b - 1);
+        f.c = (uint32_t)(c - 1);
+
+        for (size_t i = 0; i < 3; ++i)
+          f.tex_coords[i] = tex_coords[tex_idx[i] - 1];
+        
+        darray_push(mesh->faces, f);
+      }
+    }
+  }
+
+  darray_free(tex_coords);
+  fclose(file);
+}
+
+static double seconds_since(const Uint64 start)
+{
+  return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static void report(const char* name, const size_t num_vertices, const size_t num_faces, const double seconds, 
+  const size_t num_lines)
+{
+  printf("%-16s %10zu vertices %10zu faces %8.2f s %12.0f lines/s\n", name, 
+    num_vertices, num_faces, seconds, (double)num_lines / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+  const char* filepath = argc > 1 ? argv[1] : DEFAULT_PATH;
+  const size_t size_mb = argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : DEFAULT_SIZE_MB;
+
+  FILE* existing = fopen(filepath, "r");
+
+  if (existing) fclose(existing);
+  else generate_obj(filepath, size_mb);
+
+  // line count, so both loaders are measured in the same unit
+  size_t num_lines = 0;
+  {
+    FILE* file = fopen(filepath, "rb");
+    char buffer[1 << 16];
+    size_t read = 0;
+
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      for (size_t i = 0; i < read; ++i)
+        num_lines += buffer[i] == '\n';
+    }
+
+    fclose(file);
+  }
+
+  reference_mesh_t reference = { 0 };
+  Uint64 start = SDL_GetPerformanceCounter();
+  reference_parse_obj(&reference, filepath);
+  const double reference_seconds = seconds_since(start);
+
+  const size_t reference_faces = darray_size(reference.faces);
+  report("fgets/sscanf", darray_size(reference.vertices), reference_faces, reference_seconds, num_lines);
+  darray_free(reference.faces);
+  darray_free(reference.vertices);
+
+  mesh_t mesh = { 0 };
+  start = SDL_GetPerformanceCounter();
+  mesh_parse_obj(&mesh, filepath);
+  const double seconds = seconds_since(start);
+  report("mesh_parse_obj", darray_size(mesh.vertices), darray_size(mesh.faces), seconds, num_lines);
+
+  printf("speedup: %.1fx\n", reference_seconds / seconds);
+
+  // vertices are welded by position, uv and normal, so only the face counts are comparable
+  if (darray_size(mesh.faces) != reference_faces) {
+    fprintf(stderr, "Loader results differ.\n");
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
@@ -0,0 +1,252 @@
+// Copyright 2025 Sebastian Cyliax
+
+// Compares texture sampling with texels stored in rows against 8x8 tiles and BC1 blocks.
+// Usage: texture_layout_bench [texture_size] [screen_size]
+// A screen_size squared frame is filled with nearest samples of a texture_size squared texture,
+// one texel per pixel, with the texture rotated by several angles against the screen. For each
+// layout it reports the fill rate with nearest and with bilinear filtering, and the misses of 
+// nearest sampling in a simulated 32 KB, 8-way L1 data cache. Misses of BC1 count the blocks that
+// aren't in the decoded block cache, which is small enough to stay in L1 itself.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "../src/texture.h"
+
+#define DEFAULT_TEXTURE_SIZE 2048
+#define DEFAULT_SCREEN_SIZE 1024
+#define REPEATS 4
+#define NUM_LAYOUTS 3
+
+#define CACHE_LINE 64
+#define CACHE_WAYS 8
+#define CACHE_SETS (32 * 1024 / CACHE_LINE / CACHE_WAYS)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct cache {
+  uint64_t tags[CACHE_SETS][CACHE_WAYS];
+  uint64_t misses;
+} cache_t;
+
+// set associative with LRU replacement, the ways of a set are kept in most recently used order
+static void cache_access(cache_t* cache, const void* address)
+{
+  const uint64_t line = (uint64_t)(uintptr_t)address / CACHE_LINE;
+  uint64_t* ways = cache->tags[line % CACHE_SETS];
+  const uint64_t tag = line + 1;
+  int hit = CACHE_WAYS - 1;
+
+  for (int i = 0; i < CACHE_WAYS; ++i) {
+    if (ways[i] == tag) {
+      hit = i;
+      break;
+    }
+  }
+
+  if (ways[hit] != tag)
+    ++cache->misses;
+
+  memmove(&ways[1], &ways[0], sizeof(uint64_t) * (size_t)hit);
+  ways[0] = tag;
+}
+
+typedef struct mapping {
+  float u0, v0;
+  float du_dx, dv_dx;
+  float du_dy, dv_dy;
+} mapping_t;
+
+// one texel per pixel, rotated by degrees around the texture's center
+static mapping_t make_mapping(const float degrees, const uint32_t texture_size, const uint32_t screen_size)
+{
+  const float angle = degrees * (float)M_PI / 180.f;
+  const float scale = 1.f / (float)texture_size;
+  const float c = cosf(angle) * scale;
+  const float s = sinf(angle) * scale;
+  const float half = 0.5f * (float)screen_size;
+
+  return (mapping_t) {
+    .u0 = 0.5f - c * half + s * half,
+    .v0 = 0.5f - s * half - c * half,
+    .du_dx = c, .dv_dx = s,
+    .du_dy = -s, .dv_dy = c
+  };
+}
+
+static color_t fill(const tex2_t* texture, const mapping_t* m, const uint32_t screen_size, const bool bilinear, 
+  color_t* frame)
+{
+  color_t checksum = 0;
+
+  for (uint32_t y = 0; y < screen_size; ++y) {
+    float u = m->u0 + m->du_dy * (float)y;
+    float v = m->v0 + m->dv_dy * (float)y;
+
+    for (uint32_t x = 0; x < screen_size; ++x) {
+      const color_t color = bilinear ? texture_sample_bilinear(texture, 0, u, v) : 
+        texture_sample_level(texture, 0, u, v);
+
+      frame[(size_t)y * screen_size + x] = color;
+      checksum += color;
+      u += m->du_dx;
+      v += m->dv_dx;
+    }
+  }
+
+  return checksum;
+}
+
+static bool block_cached(const tex2_level_t* level, const size_t index)
+{
+  const uint64_t tag = ((uint64_t)level->id << 32) | index;
+
+  for (int i = 0; i < TEXTURE_BLOCK_CACHE_SIZE; ++i) {
+    if (texture_block_cache.tags[i] == tag) return true;
+  }
+
+  return false;
+}
+
+// the same walk as fill, feeding the sampled addresses to the cache model
+static uint64_t count_misses(const tex2_t* texture, const mapping_t* m, const uint32_t screen_size, cache_t* cache)
+{
+  const tex2_level_t* level = &texture->levels[0];
+
+  memset(cache, 0, sizeof(*cache));
+
+  for (uint32_t y = 0; y < screen_size; ++y) {
+    float u = m->u0 + m->du_dy * (float)y;
+    float v = m->v0 + m->dv_dy * (float)y;
+
+    for (uint32_t x = 0; x < screen_size; ++x) {
+      const uint32_t tx = (uint32_t)(int32_t)(u * level->size.x) & level->mask_x;
+      const uint32_t ty = (uint32_t)(int32_t)(v * level->size.y) & level->mask_y;
+      if (texture->compressed) {
+        const size_t index = ((size_t)(ty >> 2) << level->blocks_shift) + (tx >> 2);
+
+        if (!block_cached(level, index))
+          cache_access(cache, level->blocks + index);
+
+        texture_block_texel(level, tx, ty);
+      } else {
+        const size_t offset = texture->tiled ? texture_tiled_offset(level, tx, ty) :
+          ((size_t)ty << level->stride_shift) + tx;
+
+        cache_access(cache, level->data + offset);
+      }
+
+      u += m->du_dx;
+      v += m->dv_dx;
+    }
+  }
+
+  return cache->misses;
+}
+
+static double seconds_since(const Uint64 start)
+{
+  return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static color_t* make_texels(const uint32_t size)
+{
+  color_t* data = malloc(sizeof(color_t) * size * size);
+
+  if (!data) {
+    fprintf(stderr, "Error allocating texture.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (uint32_t i = 0; i < size * size; ++i)
+    data[i] = 0xFF000000 | ((i * 2654435761u) >> 8);
+
+  return data;
+}
+
+int main(int argc, char* argv[])
+{
+  const uint32_t texture_size = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : DEFAULT_TEXTURE_SIZE;
+  const uint32_t screen_size = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : DEFAULT_SCREEN_SIZE;
+
+  if (texture_size == 0 || (texture_size & (texture_size - 1)) != 0 || screen_size == 0) {
+    fprintf(stderr, "The texture size has to be a power of two.\n");
+    return EXIT_FAILURE;
+  }
+
+  tex2_t rows = { 0 };
+  tex2_t tiles = { 0 };
+  tex2_t blocks = { 0 };
+
+  texture_init(&rows, make_texels(texture_size), texture_size, texture_size, texture_size, false, true);
+  texture_init(&tiles, make_texels(texture_size), texture_size, texture_size, texture_size, false, true);
+  texture_init(&blocks, make_texels(texture_size), texture_size, texture_size, texture_size, false, true);
+  texture_swizzle(&tiles);
+  texture_compress(&blocks);
+
+  const tex2_t* layouts[NUM_LAYOUTS] = { &rows, &tiles, &blocks };
+  const char* names[NUM_LAYOUTS] = { "rows", "tiles", "bc1" };
+  const float angles[] = { 0.f, 15.f, 30.f, 45.f, 60.f, 90.f, 135.f };
+  const size_t num_angles = sizeof(angles) / sizeof(angles[0]);
+  const double num_pixels = (double)screen_size * screen_size;
+
+  color_t* frame = malloc(sizeof(color_t) * screen_size * screen_size);
+  cache_t* cache = malloc(sizeof(cache_t));
+
+  if (!frame || !cache) {
+    fprintf(stderr, "Error allocating frame.\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("%ux%u texture, %ux%u frame\n", texture_size, texture_size, screen_size, screen_size);
+  printf("texture memory: rows %.1f MB, tiles %.1f MB, bc1 %.1f MB\n", 
+    (double)texture_memory_size(&rows) / (1024. * 1024.), (double)texture_memory_size(&tiles) / (1024. * 1024.),
+    (double)texture_memory_size(&blocks) / (1024. * 1024.));
+  printf("%8s %8s %18s %18s %14s\n", "angle", "layout", "nearest Mpixels/s", "bilinear Mpixels/s", 
+    "misses/pixel");
+
+  color_t checksums[NUM_LAYOUTS] = { 0, 0, 0 };
+
+  for (size_t i = 0; i < num_angles; ++i) {
+    const mapping_t mapping = make_mapping(angles[i], texture_size, screen_size);
+
+    for (int l = 0; l < NUM_LAYOUTS; ++l) {
+      double best[2] = { 1e30, 1e30 };
+
+      for (int f = 0; f < 2; ++f) {
+        for (int r = 0; r < REPEATS; ++r) {
+          const Uint64 start = SDL_GetPerformanceCounter();
+          checksums[l] += fill(layouts[l], &mapping, screen_size, f == 1, frame);
+          const double seconds = seconds_since(start);
+
+          best[f] = seconds < best[f] ? seconds : best[f];
+        }
+      }
+
+      const uint64_t misses = count_misses(layouts[l], &mapping, screen_size, cache);
+
+      printf("%8.0f %8s %18.1f %18.1f %14.3f\n", angles[i], names[l], num_pixels / best[0] / 1e6, 
+        num_pixels / best[1] / 1e6, (double)misses / num_pixels);
+    }
+  }
+
+  free(cache);
+  free(frame);
+  texture_free(&blocks);
+  texture_free(&tiles);
+  texture_free(&rows);
+
+  // both uncompressed layouts have to sample the same texels
+  if (checksums[0] != checksums[1]) {
+    fprintf(stderr, "Layout results differ.\n");
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
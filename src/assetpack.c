@@ -0,0 +1,353 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assetpack.h"
+#include "darray.h"
+#include "hash.h"
+#include "mesh.h"
+#include "meshquant.h"
+#include "texture.h"
+#include "textures.h"
+
+static const char asset_pack_magic[8] = { 'S', 'R', 'P', 'A', 'C', 'K', 0, 0 };
+
+static bool pad_to(FILE* file, const uint64_t offset)
+{
+  static const char zeros[MESH_CACHE_ALIGN] = { 0 };
+  uint64_t pos = (uint64_t)ftell(file);
+
+  while (pos < offset) {
+    const size_t count = (size_t)MIN(offset - pos, (uint64_t)sizeof(zeros));
+
+    if (fwrite(zeros, 1, count, file) != count) return false;
+    pos += count;
+  }
+
+  return pos == offset;
+}
+
+static bool write_texture(FILE* file, asset_pack_entry_t* entry, const tex2_t* texture)
+{
+  // every level, laid out like a texture cache, so opening the texture only views them
+  const tex2_level_t* base = &texture->levels[0];
+  asset_pack_texture_t data = { 
+    .width = base->width, 
+    .height = base->height, 
+    .tiled = texture->tiled, 
+    .compressed = texture->compressed 
+  };
+
+  const size_t data_size = texture->compressed ? sizeof(uint64_t) * texture_block_count(data.width, data.height) :
+    sizeof(color_t) * texture_texel_count(data.width, data.height);
+
+  entry->type = ASSET_PACK_TEXTURE;
+  entry->offset = align_size((size_t)ftell(file), MESH_CACHE_ALIGN);
+  data.texel_offset = align_size((size_t)(entry->offset + sizeof(data)), MESH_CACHE_ALIGN);
+  entry->size = data.texel_offset + data_size - entry->offset;
+
+  bool written = pad_to(file, entry->offset) && fwrite(&data, sizeof(data), 1, file) == 1 &&
+    pad_to(file, data.texel_offset);
+
+  for (uint32_t i = 0; i < texture->num_levels && written; ++i) {
+    const tex2_level_t* level = &texture->levels[i];
+
+    if (texture->compressed) {
+      const size_t num_blocks = (size_t)((level->width + 3) / 4) * ((level->height + 3) / 4);
+      written = fwrite(level->blocks, sizeof(uint64_t), num_blocks, file) == num_blocks;
+      continue;
+    }
+
+    // tiled levels are stored as they are, rows are packed, whatever the stride in memory
+    if (texture->tiled) {
+      const size_t num_texels = (size_t)level->width * level->height;
+      written = fwrite(level->data, sizeof(color_t), num_texels, file) == num_texels;
+      continue;
+    }
+
+    for (uint32_t y = 0; y < level->height && written; ++y)
+      written = fwrite(level->data + (size_t)y * level->stride, sizeof(color_t), level->width, file) == level->width;
+  }
+
+  return written && (uint64_t)ftell(file) == data.texel_offset + data_size;
+}
+
+static bool write_mesh(FILE* file, asset_pack_entry_t* entry, const mesh_t* mesh)
+{
+  asset_pack_mesh_t data = {
+    .bounds_min = mesh->bounds_min,
+    .bounds_max = mesh->bounds_max,
+    .quantization = mesh->quantization
+  };
+
+  entry->type = ASSET_PACK_MESH;
+  entry->offset = align_size((size_t)ftell(file), MESH_CACHE_ALIGN);
+  entry->size = mesh_cache_layout(mesh, entry->offset + sizeof(data), data.sections) - entry->offset;
+
+  return pad_to(file, entry->offset) && fwrite(&data, sizeof(data), 1, file) == 1 &&
+    mesh_cache_write_sections(file, mesh, data.sections);
+}
+
+static int compare_entries(const void* a, const void* b)
+{
+  const asset_pack_entry_t* ea = (const asset_pack_entry_t*)a;
+  const asset_pack_entry_t* eb = (const asset_pack_entry_t*)b;
+
+  if (ea->name_hash != eb->name_hash) return ea->name_hash < eb->name_hash ? -1 : 1;
+  return (ea->type > eb->type) - (ea->type < eb->type);
+}
+
+bool asset_pack_write(const char* pack_path, const char* const* asset_paths, const size_t count)
+{
+  if (!pack_path || (!asset_paths && count > 0)) return false;
+
+  FILE* file = fopen(pack_path, "wb");
+
+  if (!file) {
+    perror("Error creating asset pack");
+    return false;
+  }
+
+  asset_pack_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  asset_pack_entry_t* entries = NULL;
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  // one asset at a time, so only the current one is in memory
+  for (size_t i = 0; i < count && written; ++i) {
+    const char* path = asset_paths[i];
+    asset_pack_entry_t entry = { .name_hash = hash_string(path) };
+
+    if (file_has_extension(path, ".png")) {
+      tex2_t texture = { 0 };
+      load_texture(&texture, path);
+
+      if (texture.size.x <= 0.f) {
+        fprintf(stderr, "Error packing texture: %s\n", path);
+        written = false;
+        break;
+      }
+
+      written = write_texture(file, &entry, &texture);
+      darray_push(entries, entry);
+      texture_free(&texture);
+      continue;
+    }
+
+    mesh_t mesh = { 0 };
+    mesh_load(&mesh, path);
+
+    if (mesh_vertex_count(&mesh) == 0 || !mesh.faces) {
+      fprintf(stderr, "Error packing mesh: %s\n", path);
+      mesh_free(&mesh);
+      written = false;
+      break;
+    }
+
+    written = write_mesh(file, &entry, &mesh);
+    darray_push(entries, entry);
+
+    // a glb's embedded texture is stored under the mesh's name
+    const tex2_t* texture = textures_get(mesh.texture);
+
+    if (written && texture) {
+      written = write_texture(file, &entry, texture);
+      darray_push(entries, entry);
+    }
+
+    mesh_free(&mesh);
+  }
+
+  const size_t num_entries = darray_size(entries);
+
+  if (num_entries > 0)
+    qsort(entries, num_entries, sizeof(asset_pack_entry_t), compare_entries);
+
+  for (size_t i = 1; i < num_entries && written; ++i) {
+    if (compare_entries(&entries[i - 1], &entries[i]) == 0) {
+      fprintf(stderr, "Error writing asset pack, duplicate or colliding asset names.\n");
+      written = false;
+    }
+  }
+
+  memcpy(header.magic, asset_pack_magic, sizeof(header.magic));
+  header.version = ASSET_PACK_VERSION;
+  header.darray_header_size = (uint32_t)align_size(sizeof(da_hdr_t), DEFAULT_ALIGN);
+  header.num_entries = (uint32_t)num_entries;
+  header.toc_offset = align_size((size_t)ftell(file), sizeof(uint64_t));
+
+  written = written && pad_to(file, header.toc_offset) &&
+    (num_entries == 0 || fwrite(entries, sizeof(asset_pack_entry_t), num_entries, file) == num_entries) &&
+    fseek(file, 0, SEEK_SET) == 0 &&
+    fwrite(&header, sizeof(header), 1, file) == 1;
+
+  fclose(file);
+  darray_free(entries);
+
+  if (!written) {
+    fprintf(stderr, "Error writing asset pack: %s\n", pack_path);
+    remove(pack_path);
+    return false;
+  }
+
+  printf("Packed %zu assets into %s.\n", count, pack_path);
+  return true;
+}
+
+static bool pack_valid(const file_map_t* map, const asset_pack_header_t* header)
+{
+  if (memcmp(header->magic, asset_pack_magic, sizeof(header->magic)) != 0 ||
+    header->version != ASSET_PACK_VERSION ||
+    header->darray_header_size != align_size(sizeof(da_hdr_t), DEFAULT_ALIGN))
+    return false;
+
+  const uint64_t toc_offset = header->toc_offset;
+
+  if (toc_offset % sizeof(uint64_t) != 0 || toc_offset > map->size ||
+    header->num_entries > (map->size - toc_offset) / sizeof(asset_pack_entry_t))
+    return false;
+
+  const asset_pack_entry_t* entries = (const asset_pack_entry_t*)(map->data + toc_offset);
+
+  for (uint32_t i = 0; i < header->num_entries; ++i) {
+    const asset_pack_entry_t* entry = &entries[i];
+    const uint64_t min_size = entry->type == ASSET_PACK_MESH ? 
+      sizeof(asset_pack_mesh_t) : sizeof(asset_pack_texture_t);
+
+    if (entry->type > ASSET_PACK_TEXTURE || entry->offset % MESH_CACHE_ALIGN != 0 ||
+      entry->offset > map->size || entry->size > map->size - entry->offset || entry->size < min_size)
+      return false;
+
+    if (i > 0 && compare_entries(&entries[i - 1], entry) >= 0)
+      return false;
+  }
+
+  return true;
+}
+
+bool asset_pack_open(asset_pack_t* pack, const char* pack_path)
+{
+  if (!pack || !pack_path) return false;
+
+  memset(pack, 0, sizeof(*pack));
+
+  FILE* exists = fopen(pack_path, "rb");
+  if (!exists) return false;
+  fclose(exists);
+
+  // copy on write, since the renderer updates darray sizes in place
+  if (!file_map_open_copy_on_write(&pack->map, pack_path))
+    return false;
+
+  asset_pack_header_t header;
+
+  if (pack->map.size < sizeof(header)) {
+    fprintf(stderr, "Invalid asset pack: %s\n", pack_path);
+    file_map_close(&pack->map);
+    return false;
+  }
+
+  memcpy(&header, pack->map.data, sizeof(header));
+
+  if (!pack_valid(&pack->map, &header)) {
+    fprintf(stderr, "Invalid asset pack: %s\n", pack_path);
+    file_map_close(&pack->map);
+    return false;
+  }
+
+  pack->entries = (const asset_pack_entry_t*)(pack->map.data + header.toc_offset);
+  pack->num_entries = header.num_entries;
+
+  return true;
+}
+
+void asset_pack_close(asset_pack_t* pack)
+{
+  if (!pack) return;
+
+  file_map_close(&pack->map);
+  memset(pack, 0, sizeof(*pack));
+}
+
+static const asset_pack_entry_t* find_entry(const asset_pack_t* pack, const char* name, 
+  const enum asset_pack_type type)
+{
+  if (!pack || !pack->entries || !name) return NULL;
+
+  const asset_pack_entry_t key = { .name_hash = hash_string(name), .type = (uint32_t)type };
+
+  return (const asset_pack_entry_t*)bsearch(&key, pack->entries, pack->num_entries,
+    sizeof(asset_pack_entry_t), compare_entries);
+}
+
+bool asset_pack_contains(const asset_pack_t* pack, const char* name, const enum asset_pack_type type)
+{
+  return find_entry(pack, name, type) != NULL;
+}
+
+bool asset_pack_mesh(const asset_pack_t* pack, const char* name, mesh_t* mesh)
+{
+  const asset_pack_entry_t* entry = find_entry(pack, name, ASSET_PACK_MESH);
+  if (!entry || !mesh) return false;
+
+  asset_pack_mesh_t data;
+  memcpy(&data, pack->map.data + entry->offset, sizeof(data));
+
+  if (!mesh_cache_sections_valid(&pack->map, data.sections)) {
+    fprintf(stderr, "Invalid mesh in asset pack: %s\n", name);
+    return false;
+  }
+
+  mesh_free(mesh);
+  mesh_cache_map_sections(mesh, &pack->map, data.sections);
+
+  mesh->bounds_min = data.bounds_min;
+  mesh->bounds_max = data.bounds_max;
+  mesh->quantization = data.quantization;
+  mesh->borrowed = true;
+
+  tex2_t texture = { 0 };
+
+  if (asset_pack_texture(pack, name, &texture))
+    mesh->texture = textures_adopt(name, &texture, true);
+
+  return true;
+}
+
+bool asset_pack_texture(const asset_pack_t* pack, const char* name, tex2_t* texture)
+{
+  const asset_pack_entry_t* entry = find_entry(pack, name, ASSET_PACK_TEXTURE);
+  if (!entry || !texture) return false;
+
+  asset_pack_texture_t data;
+  memcpy(&data, pack->map.data + entry->offset, sizeof(data));
+
+  const bool pow2 = data.width > 0 && data.height > 0 && 
+    (data.width & (data.width - 1)) == 0 && (data.height & (data.height - 1)) == 0;
+
+  // texels or blocks
+  const uint64_t count = data.compressed && pow2 ? (uint64_t)texture_block_count(data.width, data.height) :
+    (uint64_t)texture_texel_count(data.width, data.height);
+  const uint64_t unit = data.compressed ? sizeof(uint64_t) : sizeof(color_t);
+
+  if (data.texel_offset % MESH_CACHE_ALIGN != 0 || data.texel_offset > pack->map.size ||
+    count > (pack->map.size - data.texel_offset) / unit || ((data.tiled || data.compressed) && !pow2)) {
+    fprintf(stderr, "Invalid texture in asset pack: %s\n", name);
+    return false;
+  }
+
+  texture_free(texture);
+
+  if (data.compressed) {
+    texture_init_blocks(texture, (const uint64_t*)(pack->map.data + data.texel_offset), data.width, data.height);
+    return true;
+  }
+
+  texture_init_chain(texture, (const color_t*)(pack->map.data + data.texel_offset), data.width, data.height,
+    data.tiled != 0);
+
+  return true;
+}
@@ -0,0 +1,78 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "filemap.h"
+#include "meshcache.h"
+#include "types.h"
+
+// Single file holding pre-converted meshes and textures. The table of contents maps the hash of
+// each asset's path to its data, so a pack is mapped once and assets are used in place, without
+// opening or parsing their source files.
+
+#define ASSET_PACK_VERSION 6
+
+enum asset_pack_type {
+  ASSET_PACK_MESH,
+  ASSET_PACK_TEXTURE
+};
+
+typedef struct asset_pack_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t darray_header_size;
+  uint32_t num_entries;
+  uint32_t reserved;
+  uint64_t toc_offset;
+} asset_pack_header_t;
+
+// the table of contents at toc_offset, sorted by name_hash and type. It goes after the asset data,
+// since its size is only known once the meshes are loaded.
+typedef struct asset_pack_entry {
+  uint64_t name_hash;
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+} asset_pack_entry_t;
+
+// data of mesh entries, the section offsets are relative to the start of the pack
+typedef struct asset_pack_mesh {
+  vec3_t bounds_min;
+  vec3_t bounds_max;
+  vertex_quantization_t quantization;
+  mesh_cache_section_t sections[MESH_CACHE_SECTION_COUNT];
+} asset_pack_mesh_t;
+
+// data of texture entries, followed by all levels at texel_offset, as counted by
+// texture_texel_count(), in tiles if tiled is set and in rows otherwise. Compressed textures store
+// the BC1 blocks of all levels there instead, as counted by texture_block_count().
+typedef struct asset_pack_texture {
+  uint32_t width;
+  uint32_t height;
+  uint32_t tiled;
+  uint32_t compressed;
+  uint64_t texel_offset;
+} asset_pack_texture_t;
+
+typedef struct asset_pack {
+  file_map_t map;
+  const asset_pack_entry_t* entries;
+  uint32_t num_entries;
+} asset_pack_t;
+
+// loads the assets from their sources, names are the paths as passed here
+bool asset_pack_write(const char* pack_path, const char* const* asset_paths, const size_t count);
+
+bool asset_pack_open(asset_pack_t* pack, const char* pack_path);
+void asset_pack_close(asset_pack_t* pack);
+
+bool asset_pack_contains(const asset_pack_t* pack, const char* name, const enum asset_pack_type type);
+
+// The mesh arrays and texels are borrowed from the pack, which has to stay open while they're used.
+// A mesh's texture is registered in textures.h under the mesh's name.
+bool asset_pack_mesh(const asset_pack_t* pack, const char* name, mesh_t* mesh);
+bool asset_pack_texture(const asset_pack_t* pack, const char* name, tex2_t* texture);
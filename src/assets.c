@@ -0,0 +1,348 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "assetpack.h"
+#include "assets.h"
+#include "defs.h"
+#include "mesh.h"
+#include "meshquant.h"
+#include "textures.h"
+
+enum asset_type {
+  ASSET_MESH,
+  ASSET_TEXTURE,
+  // reloads a reduced texture of the registry, no request owns it
+  ASSET_TEXTURE_RELOAD
+};
+
+typedef struct asset_slot {
+  // written by the main thread before queueing, then by one loader thread until published
+  enum asset_type type;
+  char path[256];
+  mesh_t mesh;
+  texture_handle_t texture;
+
+  SDL_atomic_t state;
+
+  // requests that weren't released yet, main thread only
+  uint32_t refs;
+} asset_slot_t;
+
+static struct {
+  asset_slot_t slots[ASSET_MAX_SLOTS];
+  // slots ever used, those below may be free again
+  size_t num_slots;
+
+  // queue of slot indices, guarded by mutex, loader threads sleep on cond while it's empty
+  uint32_t queue[ASSET_MAX_SLOTS];
+  size_t queue_head;
+  size_t queue_tail;
+  SDL_mutex* mutex;
+  SDL_cond* cond;
+  bool quit;
+
+  SDL_Thread* threads[ASSET_LOADER_THREADS];
+
+  // assets found in the pack are used from its mapping right away, without a loader thread
+  asset_pack_t pack;
+} loader;
+
+static bool load_slot(asset_slot_t* slot)
+{
+  if (slot->type == ASSET_MESH) {
+    mesh_load(&slot->mesh, slot->path);
+    return mesh_vertex_count(&slot->mesh) > 0 && slot->mesh.faces;
+  }
+
+  if (slot->type == ASSET_TEXTURE_RELOAD) {
+    textures_reload(slot->texture);
+    return true;
+  }
+
+  slot->texture = textures_acquire(slot->path);
+  return slot->texture != TEXTURE_INVALID;
+}
+
+static int loader_thread(void* data)
+{
+  (void)data;
+
+  for (;;) {
+    SDL_LockMutex(loader.mutex);
+
+    while (loader.queue_head == loader.queue_tail && !loader.quit)
+      SDL_CondWait(loader.cond, loader.mutex);
+
+    if (loader.quit) {
+      SDL_UnlockMutex(loader.mutex);
+      return 0;
+    }
+
+    asset_slot_t* slot = &loader.slots[loader.queue[loader.queue_head++ % ASSET_MAX_SLOTS]];
+    SDL_UnlockMutex(loader.mutex);
+
+    SDL_AtomicSet(&slot->state, ASSET_LOADING);
+    const bool loaded = load_slot(slot);
+
+    if (!loaded)
+      fprintf(stderr, "Failed to load %s.\n", slot->path);
+
+    // everything written to the slot becomes visible before the state does
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&slot->state, loaded ? ASSET_READY : ASSET_FAILED);
+  }
+}
+
+bool assets_init(void)
+{
+  loader.mutex = SDL_CreateMutex();
+  loader.cond = SDL_CreateCond();
+
+  if (!loader.mutex || !loader.cond) {
+    fprintf(stderr, "Error creating asset loader queue: %s\n", SDL_GetError());
+    return false;
+  }
+
+  for (size_t i = 0; i < ASSET_LOADER_THREADS; ++i) {
+    loader.threads[i] = SDL_CreateThread(loader_thread, "asset loader", NULL);
+
+    if (!loader.threads[i]) {
+      fprintf(stderr, "Error creating asset loader thread: %s\n", SDL_GetError());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void assets_shutdown(void)
+{
+  if (loader.mutex) {
+    SDL_LockMutex(loader.mutex);
+    loader.quit = true;
+    SDL_CondBroadcast(loader.cond);
+    SDL_UnlockMutex(loader.mutex);
+  }
+
+  // loads in progress are finished first, queued ones are dropped
+  for (size_t i = 0; i < ASSET_LOADER_THREADS; ++i) {
+    if (loader.threads[i])
+      SDL_WaitThread(loader.threads[i], NULL);
+  }
+
+  for (size_t i = 0; i < loader.num_slots; ++i) {
+    mesh_free(&loader.slots[i].mesh);
+    textures_release(loader.slots[i].texture);
+  }
+
+  textures_set_pack(NULL);
+  asset_pack_close(&loader.pack);
+  SDL_DestroyCond(loader.cond);
+  SDL_DestroyMutex(loader.mutex);
+  memset(&loader, 0, sizeof(loader));
+}
+
+bool assets_open_pack(const char* pack_path)
+{
+  textures_set_pack(NULL);
+  asset_pack_close(&loader.pack);
+
+  if (!asset_pack_open(&loader.pack, pack_path))
+    return false;
+
+  textures_set_pack(&loader.pack);
+  return true;
+}
+
+static bool load_packed(asset_slot_t* slot)
+{
+  if (slot->type == ASSET_MESH)
+    return asset_pack_mesh(&loader.pack, slot->path, &slot->mesh);
+
+  if (!asset_pack_contains(&loader.pack, slot->path, ASSET_PACK_TEXTURE))
+    return false;
+
+  // the registry takes it from the pack
+  slot->texture = textures_acquire(slot->path);
+  return slot->texture != TEXTURE_INVALID;
+}
+
+static bool slot_done(asset_slot_t* slot)
+{
+  return SDL_AtomicGet(&slot->state) >= ASSET_READY;
+}
+
+// a slot requested or loaded for filepath before, unless its load failed
+static asset_slot_t* find_slot(const enum asset_type type, const char* filepath)
+{
+  for (size_t i = 0; i < loader.num_slots; ++i) {
+    asset_slot_t* slot = &loader.slots[i];
+
+    if (slot->type == type && slot->path[0] && strcmp(slot->path, filepath) == 0 &&
+      SDL_AtomicGet(&slot->state) != ASSET_FAILED)
+      return slot;
+  }
+
+  return NULL;
+}
+
+static void clear_slot(asset_slot_t* slot)
+{
+  mesh_free(&slot->mesh);
+  textures_release(slot->texture);
+  memset(slot, 0, sizeof(*slot));
+}
+
+// a cleared slot, which has no path, or one that was released while it was loading and is done now
+static asset_slot_t* free_slot(void)
+{
+  for (size_t i = 0; i < loader.num_slots; ++i) {
+    asset_slot_t* slot = &loader.slots[i];
+    const bool cleared = !slot->path[0] && slot->type != ASSET_TEXTURE_RELOAD;
+
+    if (slot->refs == 0 && (cleared || slot_done(slot))) {
+      clear_slot(slot);
+      return slot;
+    }
+  }
+
+  return loader.num_slots < ASSET_MAX_SLOTS ? &loader.slots[loader.num_slots++] : NULL;
+}
+
+static void push_slot(const uint32_t index)
+{
+  SDL_LockMutex(loader.mutex);
+  loader.queue[loader.queue_tail++ % ASSET_MAX_SLOTS] = index;
+  SDL_CondSignal(loader.cond);
+  SDL_UnlockMutex(loader.mutex);
+}
+
+static asset_handle_t queue_asset(const enum asset_type type, const char* filepath)
+{
+  if (!filepath || !loader.mutex) return ASSET_INVALID;
+
+  asset_slot_t* slot = find_slot(type, filepath);
+
+  if (slot) {
+    ++slot->refs;
+    return (asset_handle_t)(slot - loader.slots);
+  }
+
+  slot = free_slot();
+
+  if (!slot) {
+    fprintf(stderr, "Can't load %s, all %d asset slots are in use.\n", filepath, ASSET_MAX_SLOTS);
+    return ASSET_INVALID;
+  }
+
+  const uint32_t index = (uint32_t)(slot - loader.slots);
+
+  slot->type = type;
+  slot->refs = 1;
+  snprintf(slot->path, sizeof(slot->path), "%s", filepath);
+
+  if (load_packed(slot)) {
+    SDL_AtomicSet(&slot->state, ASSET_READY);
+    return index;
+  }
+
+  SDL_AtomicSet(&slot->state, ASSET_QUEUED);
+  push_slot(index);
+
+  return index;
+}
+
+void assets_reload_textures(void)
+{
+  if (!loader.mutex) return;
+
+  // finished reloads give their texture reference back right away, free_slot() only clears the
+  // first slot it can take
+  for (size_t i = 0; i < loader.num_slots; ++i) {
+    asset_slot_t* slot = &loader.slots[i];
+
+    if (slot->type == ASSET_TEXTURE_RELOAD && slot_done(slot))
+      clear_slot(slot);
+  }
+
+  for (;;) {
+    // a slot that isn't taken stays cleared for the next request
+    asset_slot_t* slot = free_slot();
+    if (!slot) return;
+
+    texture_handle_t texture;
+    if (textures_reload_requests(&texture, 1) == 0) return;
+
+    // the slot keeps the reference of the request until it's cleared
+    slot->type = ASSET_TEXTURE_RELOAD;
+    slot->texture = texture;
+    SDL_AtomicSet(&slot->state, ASSET_QUEUED);
+    push_slot((uint32_t)(slot - loader.slots));
+  }
+}
+
+asset_handle_t assets_load_mesh(const char* filepath)
+{
+  return queue_asset(ASSET_MESH, filepath);
+}
+
+asset_handle_t assets_load_texture(const char* filepath)
+{
+  return queue_asset(ASSET_TEXTURE, filepath);
+}
+
+void assets_release(const asset_handle_t handle)
+{
+  if (handle >= loader.num_slots || loader.slots[handle].refs == 0) return;
+
+  asset_slot_t* slot = &loader.slots[handle];
+
+  // slots that are still loading belong to their loader thread until they're done, a request for
+  // the same path meanwhile takes the slot up again
+  if (--slot->refs == 0 && slot_done(slot))
+    clear_slot(slot);
+}
+
+enum asset_state assets_state(const asset_handle_t handle)
+{
+  if (handle >= loader.num_slots || loader.slots[handle].refs == 0) return ASSET_FAILED;
+
+  const enum asset_state state = (enum asset_state)SDL_AtomicGet(&loader.slots[handle].state);
+
+  // pairs with the release in loader_thread()
+  SDL_MemoryBarrierAcquire();
+
+  return state;
+}
+
+mesh_t* assets_get_mesh(const asset_handle_t handle)
+{
+  if (assets_state(handle) != ASSET_READY || loader.slots[handle].type != ASSET_MESH)
+    return NULL;
+
+  return &loader.slots[handle].mesh;
+}
+
+texture_handle_t assets_get_texture(const asset_handle_t handle)
+{
+  if (assets_state(handle) != ASSET_READY || loader.slots[handle].type != ASSET_TEXTURE)
+    return TEXTURE_INVALID;
+
+  return loader.slots[handle].texture;
+}
+
+texture_handle_t assets_take_texture(const asset_handle_t handle)
+{
+  const texture_handle_t texture = assets_get_texture(handle);
+
+  if (texture != TEXTURE_INVALID) {
+    textures_retain(texture);
+    assets_release(handle);
+  }
+
+  return texture;
+}
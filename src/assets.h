@@ -0,0 +1,51 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "types.h"
+
+// Background loading of meshes and textures. Requests return a handle right away, and loader
+// threads publish finished assets through the slot's atomic state, so the render thread polls
+// without taking a lock. All functions except the loader threads' are meant for the main thread.
+
+typedef uint32_t asset_handle_t;
+
+#define ASSET_INVALID UINT32_MAX
+
+enum asset_state {
+  ASSET_QUEUED,
+  ASSET_LOADING,
+  ASSET_READY,
+  ASSET_FAILED
+};
+
+bool assets_init(void);
+void assets_shutdown(void);
+
+// assets requested afterwards are taken from the pack if it has them
+bool assets_open_pack(const char* pack_path);
+
+asset_handle_t assets_load_mesh(const char* filepath);
+asset_handle_t assets_load_texture(const char* filepath);
+
+// queues the reloads textures_end_frame() requested on the loader threads, as many as there are
+// free slots for, the others wait for the next frame
+void assets_reload_textures(void);
+
+enum asset_state assets_state(const asset_handle_t handle);
+
+// NULL or TEXTURE_INVALID until the asset is ready, owned by the asset system, which holds a
+// reference to the texture until the handle is released
+mesh_t* assets_get_mesh(const asset_handle_t handle);
+texture_handle_t assets_get_texture(const asset_handle_t handle);
+
+// the texture with a reference of the caller's own, releasing handle. Until the asset is ready it
+// returns TEXTURE_INVALID and keeps handle.
+texture_handle_t assets_take_texture(const asset_handle_t handle);
+
+// Requests for the same path share a slot and its result, each one holds a reference to it until
+// it's released, afterwards the handle is invalid. The slot is reused once none are left.
+void assets_release(const asset_handle_t handle);
@@ -116,6 +116,13 @@ void darray_clear(void* darray)
   hdr->occupied = 0;
 }
 
+void darray_free(void* darray)
+{
+  VALIDATE_PTR(darray);
+
+  free(darray_get_hdr(darray));
+}
+
 void darray_reset_size(void* darray, size_t size)
 {
   VALIDATE_PTR(darray);
@@ -91,6 +91,8 @@ void darray_pop_first(void* darray);
 
 void darray_clear(void* darray);
 
+void darray_free(void* darray);
+
 size_t darray_size(void* darray);
 
 size_t darray_capacity(void* darray);
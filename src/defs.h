@@ -20,7 +20,81 @@
 #define FPS 120
 #define FRAME_TIME (1000 / FPS)
 
+// triangles covering at least this many pixels are rasterized block-wise
+#define LARGE_TRIANGLE_AREA 2048
+#define RASTER_BLOCK_SIZE 8
+
+// faces projected and rasterized together in GEOMETRY_BATCHED mode, sized to keep
+// the resulting triangles (up to twice as many, due to clipping) within L2
+#define GEOMETRY_BATCH_SIZE 2048
+
+// OBJ files of at least this many bytes are parsed by up to OBJ_MAX_THREADS threads
+#define OBJ_PARALLEL_MIN_SIZE (4 * 1024 * 1024)
+#define OBJ_MAX_THREADS 16
+
+// post-transform cache size that face reordering at load optimizes for, and ACMR is measured with
+#define VERTEX_CACHE_SIZE 32
+
+// meshes with at least this many vertices are stored quantized, see meshquant.h
+#define MESH_QUANTIZE_MIN_VERTICES (1 << 16)
+
+// Meshes from files of at least MESH_STREAM_MIN_SIZE bytes are split into blocks and streamed,
+// keeping at most MESH_STREAM_BUDGET bytes of blocks resident
+#define MESH_STREAM_MIN_SIZE (1024ull * 1024 * 1024)
+#define MESH_STREAM_BUDGET (256 * 1024 * 1024)
+#define MESH_STREAM_LOADS_PER_FRAME 4
+#define MESH_BLOCK_MAX_FACES 16384
+
+// The split into blocks spills the scanned file next to the blocks and sorts at most
+// MESH_STREAM_BUILD_FACES triangles at a time, by their cell in a grid of 2^MESH_STREAM_GRID_BITS
+// cells per axis
+#define MESH_STREAM_BUILD_FACES (4 * 1024 * 1024)
+#define MESH_STREAM_GRID_BITS 7
+
+// assets requested at once, and the threads loading them in the background
+#define ASSET_MAX_SLOTS 64
+#define ASSET_LOADER_THREADS 2
+
 #define TEXTURE_SIZE 64
+
+// mip levels of a texture, enough for 32768 texels on a side
+#define TEXTURE_MAX_LEVELS 16
+
+// tiled textures are stored in tiles of 2^TEXTURE_TILE_BITS texels squared, 8x8 is 4 cache lines
+#define TEXTURE_TILE_BITS 3
+
+// With TEXTURE_COMPRESS set to 1, power-of-two textures of at least TEXTURE_COMPRESS_MIN_TEXELS
+// texels are compressed to 4 bits per texel (BC1). That's lossy, with 1-bit alpha, and fills at
+// about half the rate, so it's off by default.
+#define TEXTURE_COMPRESS 0
+#define TEXTURE_COMPRESS_MIN_TEXELS (512 * 512)
+
+// decoded BC1 blocks cached per thread, a window of 2^bits squared blocks, 32x32 texels for 3
+#define TEXTURE_BLOCK_CACHE_BITS 3
+
+// threads converting textures into texture cache files at once, at most one per CPU
+#define TEXTURE_CACHE_THREADS 16
+
+// Textures of at least TEXTURE_STREAM_MIN_TEXELS texels (256 MB decoded) are virtual, split into pages
+// of 2^TEXTURE_PAGE_BITS texels squared (64 KB for 7), of which TEXTURE_STREAM_BUDGET bytes are resident
+#define TEXTURE_STREAM_MIN_TEXELS (8192ull * 8192)
+#define TEXTURE_STREAM_BUDGET (64 * 1024 * 1024)
+#define TEXTURE_STREAM_LOADS_PER_FRAME 16
+#define TEXTURE_PAGE_BITS 7
+
+// Texture-space shading lights square atlases of SHADE_CACHE_MIN_SIZE to SHADE_CACHE_MAX_SIZE texels,
+// as large as the albedo and with about SHADE_CACHE_FACE_TEXELS texels across each face, at most
+// SHADE_CACHE_TEXELS_PER_FRAME texels per frame, and only again once the light direction in object
+// space moved by more than the angle whose cosine is SHADE_CACHE_LIGHT_TOLERANCE
+#define SHADE_CACHE_MIN_SIZE 64
+#define SHADE_CACHE_MAX_SIZE 1024
+#define SHADE_CACHE_FACE_TEXELS 2.f
+#define SHADE_CACHE_TEXELS_PER_FRAME (64 * 1024)
+#define SHADE_CACHE_LIGHT_TOLERANCE 0.9995f
+
+// textures registered at once, and the bytes they may take before unused ones are evicted
+#define TEXTURE_MAX_ENTRIES 256
+#define TEXTURE_BUDGET (128 * 1024 * 1024)
 #define PIXELFORMAT SDL_PIXELFORMAT_ARGB8888
 
 #define DEG2RAD(x) (x * PI / 180.f)
@@ -0,0 +1,186 @@
+// Copyright 2025 Sebastian Cyliax
+
+#ifndef _WIN32
+  #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "filemap.h"
+#include "hash.h"
+
+static bool file_map_open_base(file_map_t* map, const char* filepath, const bool copy_on_write)
+{
+  if (!map || !filepath) return false;
+
+  *map = (file_map_t) { .data = NULL, .size = 0, .handle = NULL };
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    fprintf(stderr, "Error opening file: %s\n", filepath);
+    return false;
+  }
+
+  LARGE_INTEGER size;
+
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // an empty file can't be mapped, but is still a valid (empty) view
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return true;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+
+  if (!mapping) {
+    fprintf(stderr, "Error mapping file: %s\n", filepath);
+    return false;
+  }
+
+  const void* view = MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+
+  if (!view) {
+    CloseHandle(mapping);
+    fprintf(stderr, "Error mapping file: %s\n", filepath);
+    return false;
+  }
+
+  map->data = (const char*)view;
+  map->size = (size_t)size.QuadPart;
+  map->handle = (void*)mapping;
+#else
+  const int fd = open(filepath, O_RDONLY);
+
+  if (fd < 0) {
+    perror("Error opening file");
+    return false;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  // an empty file can't be mapped, but is still a valid (empty) view
+  if (st.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  const int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* view = mmap(NULL, (size_t)st.st_size, prot, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (view == MAP_FAILED) {
+    perror("Error mapping file");
+    return false;
+  }
+
+  map->data = (const char*)view;
+  map->size = (size_t)st.st_size;
+#endif
+
+  return true;
+}
+
+bool file_map_open(file_map_t* map, const char* filepath)
+{
+  return file_map_open_base(map, filepath, false);
+}
+
+bool file_map_open_copy_on_write(file_map_t* map, const char* filepath)
+{
+  return file_map_open_base(map, filepath, true);
+}
+
+void file_map_close(file_map_t* map)
+{
+  if (!map || !map->data) return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(map->data);
+  CloseHandle((HANDLE)map->handle);
+#else
+  munmap((void*)map->data, map->size);
+#endif
+
+  *map = (file_map_t) { .data = NULL, .size = 0, .handle = NULL };
+}
+
+bool file_stat(const char* filepath, uint64_t* size, int64_t* mtime)
+{
+  if (!filepath || !size || !mtime) return false;
+
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+  if (!GetFileAttributesExA(filepath, GetFileExInfoStandard, &attributes))
+    return false;
+
+  *size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+  *mtime = (int64_t)(((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | 
+    attributes.ftLastWriteTime.dwLowDateTime);
+#else
+  struct stat st;
+
+  if (stat(filepath, &st) != 0)
+    return false;
+
+  *size = (uint64_t)st.st_size;
+  *mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+
+  return true;
+}
+
+bool file_hash(const char* filepath, uint64_t* hash)
+{
+  file_map_t file;
+
+  if (!hash || !file_map_open(&file, filepath))
+    return false;
+
+  *hash = hash_fnv1a(file.data, file.size, HASH_FNV1A_SEED);
+  file_map_close(&file);
+
+  return true;
+}
+
+bool file_has_extension(const char* filepath, const char* extension)
+{
+  if (!filepath || !extension) return false;
+
+  const size_t length = strlen(filepath);
+  const size_t extension_length = strlen(extension);
+
+  if (length < extension_length) return false;
+
+  for (size_t i = 0; i < extension_length; ++i) {
+    if (tolower((unsigned char)filepath[length - extension_length + i]) != extension[i])
+      return false;
+  }
+
+  return true;
+}
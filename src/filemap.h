@@ -0,0 +1,30 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <stdint.h>
+
+// view of a whole file, backed by the OS page cache instead of a heap copy
+typedef struct file_map {
+  const char* data;
+  size_t size;
+  void* handle;
+} file_map_t;
+
+bool file_map_open(file_map_t* map, const char* filepath);
+
+// writes to the view only create private copies of the touched pages, the file stays unchanged
+bool file_map_open_copy_on_write(file_map_t* map, const char* filepath);
+
+void file_map_close(file_map_t* map);
+
+bool file_stat(const char* filepath, uint64_t* size, int64_t* mtime);
+
+// FNV-1a hash of the file's content
+bool file_hash(const char* filepath, uint64_t* hash);
+
+// case insensitive, extension is lower case and includes the dot
+bool file_has_extension(const char* filepath, const char* extension);
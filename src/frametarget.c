@@ -0,0 +1,199 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "defs.h"
+#include "frametarget.h"
+
+static bool init_window(frame_target_t* target)
+{
+  if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+    fprintf(stderr, "Error initializing SDL video: %s\n", SDL_GetError());
+    return false;
+  }
+
+  SDL_DisplayMode displayMode;
+  SDL_GetCurrentDisplayMode(0, &displayMode);
+  const int fullScreenWidth = displayMode.w;
+  const int fullScreenHeight = displayMode.h;
+
+  target->window = SDL_CreateWindow(
+    NULL,
+    SDL_WINDOWPOS_CENTERED,
+    SDL_WINDOWPOS_CENTERED,
+    fullScreenWidth,
+    fullScreenHeight,
+    SDL_WINDOW_BORDERLESS
+  );
+
+  if (!target->window) {
+    fprintf(stderr, "Error initializing window.\n");
+    return false;
+  }
+
+  target->renderer = SDL_CreateRenderer(target->window, -1, 0);
+
+  if (!target->renderer) {
+    fprintf(stderr, "Error initializing renderer.\n");
+    return false;
+  }
+
+  SDL_SetRenderDrawBlendMode(target->renderer, SDL_BLENDMODE_BLEND);
+  SDL_ShowCursor(SDL_DISABLE);
+
+  target->texture = SDL_CreateTexture(
+    target->renderer,
+    PIXELFORMAT,
+    SDL_TEXTUREACCESS_STREAMING,
+    (int)target->width,
+    (int)target->height
+  );
+
+  if (!target->texture) {
+    fprintf(stderr, "Error initializing color buffer texture.\n");
+    return false;
+  }
+
+  return true;
+}
+
+bool frame_target_init(frame_target_t* target, const enum frame_target_backend backend, const uint32_t width,
+  const uint32_t height)
+{
+  if (!target || width == 0 || height == 0) return false;
+
+  memset(target, 0, sizeof(*target));
+  target->backend = backend;
+  target->width = width;
+  target->height = height;
+  target->pixels = calloc((size_t)width * height, sizeof(color_t));
+
+  if (!target->pixels) {
+    fprintf(stderr, "Error initializing color buffer.\n");
+    return false;
+  }
+
+  if (backend == FRAME_TARGET_WINDOW && !init_window(target)) {
+    frame_target_destroy(target);
+    return false;
+  }
+
+  return true;
+}
+
+void frame_target_destroy(frame_target_t* target)
+{
+  if (!target) return;
+
+  if (target->texture) SDL_DestroyTexture(target->texture);
+  if (target->renderer) SDL_DestroyRenderer(target->renderer);
+  if (target->window) SDL_DestroyWindow(target->window);
+
+  if (target->backend == FRAME_TARGET_WINDOW)
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+
+  free(target->pixels);
+  memset(target, 0, sizeof(*target));
+}
+
+void frame_target_present(frame_target_t* target)
+{
+  if (!target || !target->renderer) return;
+
+  SDL_UpdateTexture(target->texture, NULL, target->pixels, (int)(sizeof(color_t) * target->width));
+  SDL_RenderCopyEx(target->renderer, target->texture, NULL, NULL, 0, NULL, SDL_FLIP_HORIZONTAL);
+  SDL_RenderPresent(target->renderer);
+}
+
+// a copy of the pixels in the order they're presented in
+static color_t* mirrored_pixels(const frame_target_t* target)
+{
+  color_t* mirrored = malloc(sizeof(color_t) * target->width * target->height);
+  if (!mirrored) exit(EXIT_FAILURE);
+
+  for (uint32_t y = 0; y < target->height; ++y) {
+    const color_t* src = &target->pixels[(size_t)y * target->width];
+    color_t* dst = &mirrored[(size_t)y * target->width];
+
+    for (uint32_t x = 0; x < target->width; ++x)
+      dst[x] = src[target->width - 1 - x];
+  }
+
+  return mirrored;
+}
+
+static bool save_ppm(const color_t* pixels, const uint32_t width, const uint32_t height, const char* path)
+{
+  FILE* file = fopen(path, "wb");
+
+  if (!file) {
+    perror("Error creating frame");
+    return false;
+  }
+
+  uint8_t* row = malloc((size_t)width * 3);
+  if (!row) exit(EXIT_FAILURE);
+
+  bool written = fprintf(file, "P6\n%u %u\n255\n", width, height) > 0;
+
+  for (uint32_t y = 0; y < height && written; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      const color_t color = pixels[(size_t)y * width + x];
+
+      row[x * 3 + 0] = (uint8_t)(color >> 16);
+      row[x * 3 + 1] = (uint8_t)(color >> 8);
+      row[x * 3 + 2] = (uint8_t)color;
+    }
+
+    written = fwrite(row, 3, width, file) == width;
+  }
+
+  free(row);
+  written = fclose(file) == 0 && written;
+
+  if (!written)
+    fprintf(stderr, "Error writing frame: %s\n", path);
+
+  return written;
+}
+
+// the alpha channel is ignored, like it is by the window
+static bool save_png(color_t* pixels, const uint32_t width, const uint32_t height, const char* path)
+{
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, (int)width, (int)height, 32,
+    (int)(sizeof(color_t) * width), SDL_PIXELFORMAT_RGB888);
+
+  if (!surface) {
+    fprintf(stderr, "Error creating frame surface: %s\n", SDL_GetError());
+    return false;
+  }
+
+  const bool written = IMG_SavePNG(surface, path) == 0;
+  SDL_FreeSurface(surface);
+
+  if (!written)
+    fprintf(stderr, "Error writing frame %s: %s\n", path, IMG_GetError());
+
+  return written;
+}
+
+bool frame_target_save(const frame_target_t* target, const char* path)
+{
+  if (!target || !target->pixels || !path) return false;
+
+  const size_t length = strlen(path);
+  const bool png = length >= 4 && SDL_strcasecmp(path + length - 4, ".png") == 0;
+  color_t* pixels = mirrored_pixels(target);
+
+  const bool saved = png ? save_png(pixels, target->width, target->height, path) :
+    save_ppm(pixels, target->width, target->height, path);
+
+  free(pixels);
+
+  return saved;
+}
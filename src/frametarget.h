@@ -0,0 +1,41 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "types.h"
+
+// What frames are rendered into: a color buffer, and the backend that shows it. The window backend
+// copies each frame into a borderless SDL window sized to the desktop. The headless one keeps frames
+// in memory only and doesn't need a display, SDL's video subsystem is never initialized for it.
+// Frames of either can be saved to PPM or PNG files.
+
+enum frame_target_backend {
+  FRAME_TARGET_WINDOW,
+  FRAME_TARGET_HEADLESS
+};
+
+typedef struct frame_target {
+  enum frame_target_backend backend;
+  uint32_t width;
+  uint32_t height;
+  color_t* pixels;
+
+  // the window backend's, NULL for headless targets
+  struct SDL_Window* window;
+  struct SDL_Renderer* renderer;
+  struct SDL_Texture* texture;
+} frame_target_t;
+
+bool frame_target_init(frame_target_t* target, const enum frame_target_backend backend, const uint32_t width,
+  const uint32_t height);
+void frame_target_destroy(frame_target_t* target);
+
+// shows the pixels, mirrored horizontally like the renderer expects, headless targets do nothing
+void frame_target_present(frame_target_t* target);
+
+// writes the pixels mirrored like they're presented, as PNG if path ends in .png and as binary PPM
+// otherwise
+bool frame_target_save(const frame_target_t* target, const char* path);
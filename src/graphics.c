@@ -2,53 +2,98 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
-#include <time.h>
 
 #include <SDL.h>
 #include <SDL_image.h>
 
+#include "assets.h"
 #include "camera.h"
 #include "darray.h"
+#include "frametarget.h"
 #include "graphics.h"
+#include "hash.h"
 #include "light.h"
 #include "matrix.h"
+#include "meshquant.h"
+#include "meshstream.h"
+#include "shadecache.h"
 #include "texture.h"
+#include "textures.h"
+#include "texturestream.h"
 #include "triangle.h"
 #include "vector.h"
 
 const char* mesh_path = "assets/cube.obj";
 const char* texture_path = "assets/cube.png";
+const char* pack_path = "assets/assets.pack";
 
 static struct {
-	SDL_Renderer* renderer;
-	SDL_Window* window;
+  frame_target_t target;
+  // the target's pixels
 	color_t* color_buffer;
   float* depth_buffer;
-	SDL_Texture* color_buffer_texture;
 	mat4_t mat_projection;
   mat4_t mat_view;
   plane_t frustum_planes[6];
   tri2_t* triangles_to_render;  
+  tri2_t* sorted_triangles;
   // tri2_t* new_tris;
   vec4_t* transformed_vertices;
   size_t triangles_to_render_size;
   camera_t camera;
 	uint32_t prev_frame_time;
   float delta_time;
+  // headless frames advance by FRAME_TIME each instead of waiting for it
+  bool fixed_time_step;
 } state;
 
+// totals since init_graphics(), printed by destroy_window()
+typedef struct frame_stats {
+  uint64_t frames;
+  uint64_t triangles;
+  uint64_t material_batches;
+  uint64_t sort_ticks;
+  uint64_t render_ticks;
+  uint64_t shaded_texels;
+} frame_stats_t;
+
+static frame_stats_t frame_stats;
+
 camera_t* state_camera = &state.camera;
 float* state_delta_time = &state.delta_time;
 
 enum cull_method cull_method = CULL_NONE;
 enum render_method render_method = RENDER_WIRE;
+enum texture_filter texture_filter = TEXTURE_FILTER_MIPMAP;
+enum geometry_method geometry_method = GEOMETRY_WHOLE_MESH;
 
 //==============================================
 // Only for testing
-static mesh_t curr_mesh;
+static mesh_t placeholder_mesh;
+static tex2_t placeholder_texture;
+static mesh_t* curr_mesh = &placeholder_mesh;
+static const tex2_t* curr_texture = &placeholder_texture;
+static texture_handle_t curr_texture_handle;
+static texture_handle_t loaded_texture;
+// per material of curr_mesh, its texture asset until it's ready and then its texture
+static asset_handle_t* material_assets;
+static texture_handle_t* material_textures;
+// where the triangles of each material start after sort_by_material(), see material_bucket()
+static size_t* material_offsets;
+// per bucket of curr_mesh, its texture-space shading, set up when RENDER_TEXTURE_SHADED is first used,
+// and the indices of its faces until it's baked
+static shade_cache_t* shade_caches;
+static uint32_t** shade_faces;
+static asset_handle_t mesh_handle = ASSET_INVALID;
+static asset_handle_t texture_handle = ASSET_INVALID;
 static size_t num_faces;
 static size_t num_vertices;
+static mesh_stream_t stream;
+static bool streaming;
+static texture_stream_t virtual_texture;
+static bool texture_streaming;
 const light_t light = { { 1.f, 0.f, 0.f} };
 //==============================================
 
@@ -64,67 +109,202 @@ size_t screen_buffer_size(void)
   return (size_t)(WINDOW_WIDTH * WINDOW_HEIGHT);
 }
 
-bool init_graphics(void)
+// drops the requests and textures of the previous mesh's materials
+static void release_material_textures(void)
 {
-  if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-    fprintf(stderr, "Error initializing SDL.\n");
-    return false;
-  };
+  for (size_t i = 0; i < darray_size(material_assets); ++i) {
+    if (material_assets[i] != ASSET_INVALID)
+      assets_release(material_assets[i]);
 
-  int imgFlags = IMG_INIT_PNG;
-  if (!(IMG_Init(imgFlags) & imgFlags)) {
-    printf("Error initializing SDL_Image: %s\n", IMG_GetError());
-    return false;
+    textures_release(material_textures[i]);
   }
 
-  SDL_DisplayMode displayMode;
-  SDL_GetCurrentDisplayMode(0, &displayMode);
-  const int fullScreenWidth = displayMode.w;
-  const int fullScreenHeight = displayMode.h;
+  darray_clear(material_assets);
+  darray_clear(material_textures);
+}
 
-  state.window = SDL_CreateWindow(
-    NULL,
-    SDL_WINDOWPOS_CENTERED,
-    SDL_WINDOWPOS_CENTERED,
-    fullScreenWidth,
-    fullScreenHeight,
-    SDL_WINDOW_BORDERLESS
-  );
+// the textures of the mesh's materials load in the background, their faces are drawn with the
+// mesh's texture until then. Materials sharing a texture share its asset slot.
+static void request_material_textures(const mesh_t* mesh)
+{
+  const size_t num_materials = darray_size(mesh->materials);
 
-  if (!state.window) {
-    fprintf(stderr, "Error initializing window.\n");
-    return false;
+  release_material_textures();
+
+  for (size_t i = 0; i < num_materials; ++i) {
+    const char* path = mesh->materials[i].texture_path;
+    const asset_handle_t asset = path[0] ? assets_load_texture(path) : ASSET_INVALID;
+
+    darray_push(material_assets, asset);
+    darray_push(material_textures, TEXTURE_INVALID);
   }
+}
 
-  state.renderer = SDL_CreateRenderer(state.window, -1, 0);
+static void free_shade_caches(void)
+{
+  for (size_t i = 0; i < darray_size(shade_caches); ++i) {
+    shade_cache_free(&shade_caches[i]);
+    darray_free(shade_faces[i]);
+  }
 
-  if (!state.renderer) {
-    fprintf(stderr, "Error initializing renderer.\n");
-    return false;
+  darray_clear(shade_caches);
+  darray_clear(shade_faces);
+}
+
+// makes mesh the one that is rendered, and picks its texture
+static void use_mesh(mesh_t* mesh)
+{
+  curr_mesh = mesh;
+  num_faces = darray_size(mesh->faces);
+  num_vertices = mesh_vertex_count(mesh);
+
+  // this needs to be adapted when working with several meshes
+  state.triangles_to_render_size = geometry_method == GEOMETRY_BATCHED ? 
+    MIN(num_faces, GEOMETRY_BATCH_SIZE) : num_faces;
+
+  darray_reserve(state.triangles_to_render, state.triangles_to_render_size * 2);
+
+  mesh_init_transform(mesh);
+  request_material_textures(mesh);
+
+  // the atlases follow the uvs of the mesh's faces
+  free_shade_caches();
+
+  // meshes with an embedded texture (.glb) keep it
+  curr_texture_handle = mesh->texture != TEXTURE_INVALID ? mesh->texture : loaded_texture;
+}
+
+// makes the resident block the one that is rendered, placed like curr_mesh
+static void use_block(mesh_t* block)
+{
+  num_faces = darray_size(block->faces);
+  num_vertices = mesh_vertex_count(block);
+
+  block->scale = curr_mesh->scale;
+  block->rotation = curr_mesh->rotation;
+  block->translation = curr_mesh->translation;
+}
+
+// project_mesh() for all resident blocks of the stream, into one triangle buffer
+static void project_stream(void)
+{
+  darray_clear(state.triangles_to_render);
+
+  for (uint32_t i = 0; i < stream.header.num_blocks; ++i) {
+    mesh_t* block = &stream.resident[i];
+    if (!block->faces) continue;
+
+    use_block(block);
+    transform_mesh_vertices(block);
+    project_faces(block, 0, num_faces);
+
+    darray_reset_size(block->faces, num_faces);
+    darray_reset_size(block->vertices, num_vertices);
+    darray_clear(state.transformed_vertices);
   }
 
-  SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_BLEND);
-  SDL_ShowCursor(SDL_DISABLE);
+  num_faces = darray_size(curr_mesh->faces);
+  num_vertices = mesh_vertex_count(curr_mesh);
+}
 
-  size_t buffer_size = screen_buffer_size();
-  state.color_buffer = malloc(sizeof(color_t) * buffer_size);
-  state.depth_buffer = malloc(sizeof(float) * buffer_size);
+static void render_stream_batched(void)
+{
+  for (uint32_t i = 0; i < stream.header.num_blocks; ++i) {
+    mesh_t* block = &stream.resident[i];
+    if (!block->faces) continue;
+
+    use_block(block);
+    render_mesh_batched(block);
+  }
+
+  num_faces = darray_size(curr_mesh->faces);
+  num_vertices = mesh_vertex_count(curr_mesh);
+}
+
+// adopts assets the loader threads have finished, without waiting for the others
+static void poll_assets(void)
+{
+  if (mesh_handle != ASSET_INVALID && assets_state(mesh_handle) >= ASSET_READY) {
+    mesh_t* mesh = assets_get_mesh(mesh_handle);
+
+    if (mesh) use_mesh(mesh);
+    else fprintf(stderr, "Failed to load mesh, keeping the placeholder.\n");
+
+    mesh_handle = ASSET_INVALID;
+  }
+
+  if (texture_handle != ASSET_INVALID && assets_state(texture_handle) >= ASSET_READY) {
+    loaded_texture = assets_take_texture(texture_handle);
+
+    // failed, the handle isn't taken
+    if (loaded_texture == TEXTURE_INVALID)
+      assets_release(texture_handle);
+
+    if (curr_texture_handle == TEXTURE_INVALID) 
+      curr_texture_handle = loaded_texture;
+
+    texture_handle = ASSET_INVALID;
+  }
+
+  const size_t num_materials = darray_size(material_assets);
+
+  for (size_t i = 0; i < num_materials; ++i) {
+    if (material_assets[i] != ASSET_INVALID && assets_state(material_assets[i]) >= ASSET_READY) {
+      material_textures[i] = assets_take_texture(material_assets[i]);
+
+      if (material_textures[i] == TEXTURE_INVALID)
+        assets_release(material_assets[i]);
+
+      material_assets[i] = ASSET_INVALID;
+    }
+  }
+}
+
+// still waiting for the mesh or one of the textures
+static bool assets_pending(void)
+{
+  bool pending = mesh_handle != ASSET_INVALID || texture_handle != ASSET_INVALID;
+
+  for (size_t i = 0; i < darray_size(material_assets) && !pending; ++i)
+    pending = material_assets[i] != ASSET_INVALID;
+
+  return pending;
+}
 
-  if (!state.color_buffer) {
-    fprintf(stderr, "Error initializing color buffer.\n");
+void wait_for_assets(void)
+{
+  poll_assets();
+
+  while (assets_pending()) {
+    SDL_Delay(1);
+    poll_assets();
+  }
+}
+
+bool init_graphics(const bool headless)
+{
+  // the window backend initializes video itself, headless rendering works without a display
+  if (SDL_Init(SDL_INIT_TIMER) != 0) {
+    fprintf(stderr, "Error initializing SDL.\n");
+    return false;
+  };
+
+  int imgFlags = IMG_INIT_PNG;
+  if (!(IMG_Init(imgFlags) & imgFlags)) {
+    printf("Error initializing SDL_Image: %s\n", IMG_GetError());
     return false;
   }
 
-  state.color_buffer_texture = SDL_CreateTexture(
-    state.renderer, 
-    PIXELFORMAT, 
-    SDL_TEXTUREACCESS_STREAMING, 
-    WINDOW_WIDTH, 
-    WINDOW_HEIGHT
-  );
+  if (!frame_target_init(&state.target, headless ? FRAME_TARGET_HEADLESS : FRAME_TARGET_WINDOW, WINDOW_WIDTH,
+    WINDOW_HEIGHT))
+    return false;
+
+  state.color_buffer = state.target.pixels;
+  state.depth_buffer = malloc(sizeof(float) * screen_buffer_size());
+  state.fixed_time_step = headless;
 
-  if (!state.color_buffer_texture) {
-    fprintf(stderr, "Error initializing color buffer texture.\n");
+  if (!state.depth_buffer) {
+    fprintf(stderr, "Error initializing depth buffer.\n");
     return false;
   }
 
@@ -134,31 +314,39 @@ bool init_graphics(void)
     0.1f,
     FOV_ANGLE);
 
-  // populate face arrays; this can stay dynamic, since it only happens once
-  mesh_parse_obj(&curr_mesh, mesh_path);
+  textures_init(TEXTURE_BUDGET);
 
-  num_faces = darray_size(curr_mesh.faces);
-  num_vertices = darray_size(curr_mesh.vertices);
+  // the assets load in the background, a checkered cube is rendered until they're ready
+  if (!assets_init())
+    return false;
 
-  // this needs to be adapted when working with several meshes
-  state.triangles_to_render_size = num_faces;
-  darray_reserve(state.triangles_to_render, state.triangles_to_render_size * 2);
+  // without a pack, every asset is loaded from its own source file
+  assets_open_pack(pack_path);
 
-  if (!curr_mesh.vertices || !curr_mesh.faces) {
-    fprintf(stderr, "Failed to load mesh.\n");
-    return false;
-  }
+  uint64_t mesh_size = 0;
+  int64_t mesh_mtime = 0;
 
-  // seed random color generator and throwaway color for actual subsequent randomization
-  srand((unsigned int)time(NULL));
+  // meshes too large for memory are streamed in blocks around the camera, placed like the cube
+  streaming = file_stat(mesh_path, &mesh_size, &mesh_mtime) && mesh_size >= MESH_STREAM_MIN_SIZE &&
+    mesh_stream_open(&stream, mesh_path, MESH_STREAM_BUDGET);
 
-  for (size_t i = 0; i < darray_size(curr_mesh.faces); ++i) {
-    curr_mesh.faces[i].color = random_color();
-  }
+  if (!streaming)
+    mesh_handle = assets_load_mesh(mesh_path);
+
+  uint32_t texture_width = 0;
+  uint32_t texture_height = 0;
 
-  load_texture(&curr_mesh.texture, texture_path);
+  // textures too large for memory are virtual, their pages load as the frames sample them
+  texture_streaming = texture_image_size(texture_path, &texture_width, &texture_height) &&
+    (uint64_t)texture_width * texture_height >= TEXTURE_STREAM_MIN_TEXELS &&
+    texture_stream_open(&virtual_texture, texture_path, TEXTURE_STREAM_BUDGET);
 
-  mesh_init_transform(&curr_mesh);
+  if (!texture_streaming)
+    texture_handle = assets_load_texture(texture_path);
+
+  mesh_make_cube(&placeholder_mesh);
+  make_checker_texture(&placeholder_texture, 0xFF808080, 0xFFC0C0C0);
+  use_mesh(&placeholder_mesh);
 
   state.camera = (camera_t) {
     .translation = { 0.f, 0.f, 0.f },
@@ -174,85 +362,364 @@ bool init_meshes(void)
   return true;
 }
 
+static size_t material_bucket(const uint32_t material, const size_t num_materials);
+
+// the albedo of bucket b, see material_bucket()
+static const tex2_t* bucket_albedo(const size_t bucket);
+
+// the albedo of bucket b may still change, while its texture or the mesh's is loading
+static bool bucket_albedo_pending(const size_t bucket)
+{
+  if (bucket > 0 && material_textures[bucket - 1] != TEXTURE_INVALID) return false;
+
+  return (bucket > 0 && material_assets[bucket - 1] != ASSET_INVALID) || texture_handle != ASSET_INVALID;
+}
+
+// sorts the faces of curr_mesh into the buckets in one pass, buckets no face uses keep no cache
+static void sort_shade_faces(const size_t num_buckets)
+{
+  const size_t num_materials = darray_size(material_textures);
+
+  shade_caches = darray_alloc(shade_caches, sizeof(shade_cache_t), num_buckets);
+  shade_faces = darray_alloc(shade_faces, sizeof(uint32_t*), num_buckets);
+  memset(shade_caches, 0, sizeof(shade_cache_t) * num_buckets);
+  memset(shade_faces, 0, sizeof(uint32_t*) * num_buckets);
+
+  for (size_t i = 0; i < num_faces; ++i) {
+    const uint32_t face = (uint32_t)i;
+    darray_push(shade_faces[material_bucket(curr_mesh->faces[i].material, num_materials)], face);
+  }
+}
+
+// Bakes one bucket per frame whose albedo is final, then continues shading the atlas of each bucket,
+// SHADE_CACHE_TEXELS_PER_FRAME texels per frame for all of them. The light is fixed in world space,
+// so only the mesh's rotation, and not the camera, makes the atlases shade again.
+static void update_shade_caches(void)
+{
+  const size_t num_buckets = darray_size(material_textures) + 1;
+
+  if (darray_size(shade_caches) != num_buckets) {
+    free_shade_caches();
+    sort_shade_faces(num_buckets);
+  }
+
+  for (size_t b = 0; b < num_buckets; ++b) {
+    if (!shade_faces[b] || bucket_albedo_pending(b)) continue;
+
+    shade_cache_init(&shade_caches[b], curr_mesh, b > 0 ? (uint32_t)(b - 1) : MATERIAL_NONE, shade_faces[b],
+      darray_size(shade_faces[b]), bucket_albedo(b));
+    darray_free(shade_faces[b]);
+    shade_faces[b] = NULL;
+    break;
+  }
+
+  // the light in object space, the transform's rotation applied inversely through its transpose,
+  // scales are uniform
+  const mat4_t transform = mesh_get_transform(curr_mesh);
+  const vec3_t* l = &light.direction;
+  vec3_t object_light = {
+    transform.m[0][0] * l->x + transform.m[1][0] * l->y + transform.m[2][0] * l->z,
+    transform.m[0][1] * l->x + transform.m[1][1] * l->y + transform.m[2][1] * l->z,
+    transform.m[0][2] * l->x + transform.m[1][2] * l->y + transform.m[2][2] * l->z
+  };
+
+  if (vec3_mag(&object_light) == 0.f) return;
+  vec3_normalize(&object_light);
+
+  size_t budget = SHADE_CACHE_TEXELS_PER_FRAME;
+
+  for (size_t b = 0; b < num_buckets && budget > 0; ++b) {
+    const size_t shaded = shade_cache_update(&shade_caches[b], bucket_albedo(b), &object_light, budget);
+
+    budget -= MIN(shaded, budget);
+    frame_stats.shaded_texels += shaded;
+  }
+}
+
 void update(void)
 {
-  const uint32_t ticks = SDL_GetTicks();
+  // headless frames are the same in every run, and rendered as fast as possible
+  const uint32_t ticks = state.fixed_time_step ? (uint32_t)(frame_stats.frames * FRAME_TIME) : SDL_GetTicks();
   const uint32_t time_to_wait = (uint32_t)FRAME_TIME - (ticks - state.prev_frame_time);
 
-  if (ticks < state.prev_frame_time + (uint32_t)FRAME_TIME)
+  if (!state.fixed_time_step && ticks < state.prev_frame_time + (uint32_t)FRAME_TIME)
     SDL_Delay(time_to_wait);
 
   state.delta_time = (float)(ticks - state.prev_frame_time) / 1000.f;
 
+  poll_assets();
+
+  // the registry may have evicted or reduced it at the end of the last frame
+  const tex2_t* texture = textures_get(curr_texture_handle);
+
+  // the virtual texture takes the place of texture_path, a mesh's own texture still comes first
+  if (!texture && texture_streaming)
+    texture = &virtual_texture.texture;
+
+  curr_texture = texture ? texture : &placeholder_texture;
+
   // transform, project
-  curr_mesh.scale = (vec3_t) {
+  curr_mesh->scale = (vec3_t) {
     .x = 0.5f,
     .y = 0.5f,
     .z = 0.5f
   };
 
-  curr_mesh.rotation.y = PI * sinf(0.0001f * (float)ticks);
-  curr_mesh.rotation.x = PI * sinf(0.0001f * (float)ticks);
-  curr_mesh.translation.z = 3.f;
+  curr_mesh->rotation.y = PI * sinf(0.0001f * (float)ticks);
+  curr_mesh->rotation.x = PI * sinf(0.0001f * (float)ticks);
+  curr_mesh->translation.z = 3.f;
 
   state.mat_view = mat4_look_at(&state.camera);
 
-  project_mesh(&curr_mesh);
+  if (streaming) {
+    const mat4_t transform = mesh_get_transform(curr_mesh);
+    mesh_stream_update(&stream, &transform, &state.camera.translation);
+  }
+
+  if (render_method == RENDER_TEXTURE_SHADED && !streaming)
+    update_shade_caches();
+
+  // batched geometry is projected during render(), right before it's rasterized
+  if (geometry_method == GEOMETRY_WHOLE_MESH && streaming)
+    project_stream();
 
-  state.prev_frame_time = SDL_GetTicks();
+  else if (geometry_method == GEOMETRY_WHOLE_MESH)
+    project_mesh(curr_mesh);
+
+  state.prev_frame_time = state.fixed_time_step ? ticks : SDL_GetTicks();
 }
 
 void render(void)
 {
-  if (!state.renderer) return;
+  if (!state.color_buffer) return;
+
+  const uint64_t start = SDL_GetPerformanceCounter();
 
   // SDL_RenderClear(state.renderer);
   clear_color_buffer(0x00000000);
   clear_depth_buffer();
   // draw_grid();
 
+  if (geometry_method == GEOMETRY_BATCHED && streaming)
+    render_stream_batched();
+
+  else if (geometry_method == GEOMETRY_BATCHED)
+    render_mesh_batched(curr_mesh);
+
+  else
+    rasterize_triangles();
+
+  render_color_buffer();
+
+  textures_end_frame();
+  assets_reload_textures();
+  texture_stream_end_frame(&virtual_texture);
+
+  frame_stats.render_ticks += SDL_GetPerformanceCounter() - start;
+  ++frame_stats.frames;
+}
+
+// bucket 0 holds the triangles without a material, or with one curr_mesh doesn't define, e.g.
+// those of stream blocks
+static size_t material_bucket(const uint32_t material, const size_t num_materials)
+{
+  return material < num_materials ? (size_t)material + 1 : 0;
+}
+
+// Groups state.triangles_to_render by material with a stable counting sort, so each material's
+// texture is looked up once and stays in cache while its triangles are drawn. Bucket b spans
+// [material_offsets[b], material_offsets[b + 1]). Returns the number of buckets.
+static size_t sort_by_material(void)
+{
+  const uint64_t start = SDL_GetPerformanceCounter();
+  const size_t num_triangles = darray_size(state.triangles_to_render);
+  const size_t num_materials = darray_size(material_textures);
+  const size_t num_buckets = num_materials + 1;
+
+  darray_clear(material_offsets);
+  material_offsets = darray_alloc(material_offsets, sizeof(size_t), num_buckets + 1);
+  memset(material_offsets, 0, sizeof(size_t) * (num_buckets + 1));
+
+  bool sorted = true;
+  size_t prev_bucket = 0;
+
+  for (size_t i = 0; i < num_triangles; ++i) {
+    const size_t bucket = material_bucket(state.triangles_to_render[i].material, num_materials);
+
+    ++material_offsets[bucket + 1];
+    sorted = sorted && bucket >= prev_bucket;
+    prev_bucket = bucket;
+  }
+
+  for (size_t b = 1; b <= num_buckets; ++b)
+    material_offsets[b] += material_offsets[b - 1];
+
+  // faces are usually grouped by material already, e.g. by usemtl blocks
+  if (!sorted) {
+    darray_clear(state.sorted_triangles);
+    state.sorted_triangles = darray_alloc(state.sorted_triangles, sizeof(tri2_t), num_triangles);
+
+    // the offsets advance to the end of their bucket, which is where the next one starts
+    for (size_t i = 0; i < num_triangles; ++i) {
+      const tri2_t* triangle = &state.triangles_to_render[i];
+      state.sorted_triangles[material_offsets[material_bucket(triangle->material, num_materials)]++] = *triangle;
+    }
+
+    memmove(material_offsets + 1, material_offsets, sizeof(size_t) * num_buckets);
+    material_offsets[0] = 0;
+
+    tri2_t* triangles = state.triangles_to_render;
+    state.triangles_to_render = state.sorted_triangles;
+    state.sorted_triangles = triangles;
+  }
+
+  frame_stats.sort_ticks += SDL_GetPerformanceCounter() - start;
+
+  return num_buckets;
+}
+
+// the registry may evict textures between frames, so they're looked up again in each one
+static const tex2_t* bucket_albedo(const size_t bucket)
+{
+  const tex2_t* texture = bucket > 0 ? textures_get(material_textures[bucket - 1]) : NULL;
+  return texture ? texture : curr_texture;
+}
+
+// the shaded atlas once its first pass is done, until then the unlit albedo
+static const tex2_t* bucket_texture(const size_t bucket)
+{
+  const tex2_t* atlas = render_method == RENDER_TEXTURE_SHADED && !streaming && bucket < darray_size(shade_caches) ?
+    shade_cache_atlas(&shade_caches[bucket]) : NULL;
+
+  return atlas ? atlas : bucket_albedo(bucket);
+}
+
+void rasterize_triangles(void)
+{
+  if (!state.triangles_to_render) return;
+
   size_t tris_current_size = darray_size(state.triangles_to_render);
 
   // printf("num tris: %zd\n", tris_current_size);
 
-  // draw projections
-  if (state.triangles_to_render) {
-    for (size_t i = 0; i < tris_current_size; ++i) {
+  const size_t num_buckets = sort_by_material();
+
+  // draw projections, one material at a time
+  for (size_t b = 0; b < num_buckets; ++b) {
+    const size_t first = material_offsets[b];
+    const size_t last = material_offsets[b + 1];
+
+    if (first == last) continue;
+
+    const tex2_t* texture = bucket_texture(b);
+    ++frame_stats.material_batches;
+
+    for (size_t i = first; i < last; ++i) {
       tri2_t* triangle = &state.triangles_to_render[i];
       tri2_round(triangle);
-      tri2_draw_texture(triangle, &curr_mesh.texture);
+      tri2_draw_texture(triangle, texture);
     }
+  }
 
-    if (render_method == RENDER_WIRE ||
-      render_method == RENDER_WIRE_VERTEX ||
-      render_method == RENDER_FILL_TRIANGLE_WIRE ||
-      render_method == RENDER_TEXTURE_WIRE) {
-      for (size_t i = 0; i < tris_current_size; ++i) {
-        tri2_t* triangle = &state.triangles_to_render[i];
-        tri2_round(triangle);
-        draw_triangle_edges(triangle, 0xFFFFFFFF);
-
-        if (render_method == RENDER_WIRE_VERTEX)
-          draw_triangle_vertices(&state.triangles_to_render[i], 0xFF00FF00);
-      }
+  frame_stats.triangles += tris_current_size;
+
+  if (render_method == RENDER_WIRE ||
+    render_method == RENDER_WIRE_VERTEX ||
+    render_method == RENDER_FILL_TRIANGLE_WIRE ||
+    render_method == RENDER_TEXTURE_WIRE) {
+    for (size_t i = 0; i < tris_current_size; ++i) {
+      tri2_t* triangle = &state.triangles_to_render[i];
+      tri2_round(triangle);
+      draw_triangle_edges(triangle, 0xFFFFFFFF);
+
+      if (render_method == RENDER_WIRE_VERTEX)
+        draw_triangle_vertices(&state.triangles_to_render[i], 0xFF00FF00);
     }
   }
+}
 
-  render_color_buffer();
-  SDL_RenderPresent(state.renderer);
+// Projects and rasterizes the mesh GEOMETRY_BATCH_SIZE faces at a time, so the triangle buffer
+// stays small enough to remain in cache between projection and rasterization. Edges are drawn 
+// per batch, so in the wireframe overlay modes later batches may paint over earlier edges.
+void render_mesh_batched(mesh_t* mesh)
+{
+  if (!mesh || !mesh->faces || mesh_vertex_count(mesh) == 0) 
+    return;
+
+  const size_t batch_capacity = (size_t)GEOMETRY_BATCH_SIZE * 2;
+
+  // drop the capacity left over from whole mesh frames
+  if (darray_capacity(state.triangles_to_render) > batch_capacity) {
+    darray_clear(state.triangles_to_render);
+    darray_shrink_to_fit(state.triangles_to_render);
+    darray_reserve(state.triangles_to_render, batch_capacity);
+  }
+
+  transform_mesh_vertices(mesh);
+
+  for (size_t first = 0; first < num_faces; first += GEOMETRY_BATCH_SIZE) {
+    darray_clear(state.triangles_to_render);
+    project_faces(mesh, first, MIN(first + GEOMETRY_BATCH_SIZE, num_faces));
+    rasterize_triangles();
+  }
+
+  darray_reset_size(mesh->faces, num_faces);
+  darray_reset_size(mesh->vertices, num_vertices);
+  darray_clear(state.transformed_vertices);
+}
+
+static void print_frame_stats(void)
+{
+  if (frame_stats.frames == 0) return;
+
+  const double frames = (double)frame_stats.frames;
+  const double ms_per_tick = 1000. / (double)SDL_GetPerformanceFrequency();
+
+  printf("Frames: %llu, %.0f triangles in %.1f material batches per frame.\n",
+    (unsigned long long)frame_stats.frames, (double)frame_stats.triangles / frames,
+    (double)frame_stats.material_batches / frames);
+  printf("Material sort: %.3f ms of %.2f ms rendering per frame.\n",
+    (double)frame_stats.sort_ticks * ms_per_tick / frames, (double)frame_stats.render_ticks * ms_per_tick / frames);
+
+  uint64_t passes = 0;
+
+  for (size_t i = 0; i < darray_size(shade_caches); ++i)
+    passes += shade_caches[i].passes;
+
+  if (frame_stats.shaded_texels > 0)
+    printf("Texture-space shading: %.0f texels per frame, %llu atlas passes.\n",
+      (double)frame_stats.shaded_texels / frames, (unsigned long long)passes);
 }
 
 void destroy_window(void)
 {
+  release_material_textures();
+  textures_release(loaded_texture);
+  assets_shutdown();
+  mesh_stream_close(&stream);
+  texture_stream_print_stats(&virtual_texture);
+  texture_stream_close(&virtual_texture);
+  mesh_free(&placeholder_mesh);
+  texture_free(&placeholder_texture);
+
+  print_frame_stats();
+  free_shade_caches();
+  darray_free(shade_caches);
+  darray_free(shade_faces);
+  textures_print_stats();
+  textures_shutdown();
+
   IMG_Quit();
 
-  free(state.triangles_to_render);
-  free(state.color_buffer);
+  darray_free(material_assets);
+  darray_free(material_textures);
+  darray_free(material_offsets);
+  darray_free(state.sorted_triangles);
+  darray_free(state.triangles_to_render);
   free(state.depth_buffer);
 
-  SDL_DestroyTexture(state.color_buffer_texture);
-  SDL_DestroyRenderer(state.renderer);
-  SDL_DestroyWindow(state.window);
+  frame_target_destroy(&state.target);
+  state.color_buffer = NULL;
 }
 
 void clear_color_buffer(color_t color)
@@ -273,15 +740,12 @@ void clear_depth_buffer()
 
 void render_color_buffer(void)
 {
-  SDL_UpdateTexture(
-    state.color_buffer_texture,
-    NULL,
-    state.color_buffer,
-    sizeof(color_t) * WINDOW_WIDTH
-  );
+  frame_target_present(&state.target);
+}
 
-  SDL_RenderCopyEx(state.renderer, state.color_buffer_texture, NULL, NULL, 0, NULL, SDL_FLIP_HORIZONTAL);
-  SDL_RenderPresent(state.renderer);
+bool save_frame(const char* path)
+{
+  return frame_target_save(&state.target, path);
 }
 
 void project_vertex(const vec4_t* vert_3d, vec2_t* vert_2d, float* inv_depth)
@@ -310,23 +774,62 @@ void project_vertex(const vec4_t* vert_3d, vec2_t* vert_2d, float* inv_depth)
 
 void project_mesh(mesh_t* mesh)
 {
-  if (!mesh || !mesh->faces || !mesh->vertices) 
+  if (!mesh || !mesh->faces || mesh_vertex_count(mesh) == 0) 
     return;
 
   darray_clear(state.triangles_to_render);
 
+  transform_mesh_vertices(mesh);
+  project_faces(mesh, 0, num_faces);
+
+  darray_reset_size(mesh->faces, num_faces);
+  darray_reset_size(mesh->vertices, num_vertices);
+  darray_clear(state.transformed_vertices);
+}
+
+void transform_mesh_vertices(const mesh_t* mesh)
+{
   const mat4_t mat_transform = mesh_get_transform(mesh);
-  const vec4_t camera_location = vec4_from_vec3(&state.camera.translation);
+
+  // quantized positions go to world space in one step, with the dequantization folded into the matrix
+  if (mesh->packed_vertices) {
+    const mat4_t mat_dequantize = vertex_quantization_matrix(&mesh->quantization);
+    const mat4_t mat_packed = mat4_mul_mat4(&mat_transform, &mat_dequantize);
+
+    for (size_t i = 0; i < num_vertices; ++i) {
+      const uint16_t* q = mesh->packed_vertices[i].position;
+      vec4_t vec4 = { (float)q[0], (float)q[1], (float)q[2], 1.f };
+      vec4 = mat4_mul_vec4(&mat_packed, &vec4);
+
+      darray_push(state.transformed_vertices, vec4);
+    }
+
+    return;
+  }
 
   // All original vertices to world space
   for (size_t i = 0; i < num_vertices; ++i) {
-    vec4_t vec4 = vec4_from_vec3(&mesh->vertices[i]);
+    vec4_t vec4 = vec4_from_vec3(&mesh->vertices[i].position);
     vec4 = mat4_mul_vec4(&mat_transform, &vec4);
 
     darray_push(state.transformed_vertices, vec4);
   }
+}
 
-  for (size_t i = 0; i < num_faces; ++i) {
+// random looking but stable colors for the filled render modes, derived from the face's vertices
+// instead of stored in it, since faces of cached meshes are mapped and writing them copies the pages
+static color_t face_color(const face_t* face)
+{
+  const uint32_t indices[3] = { face->a, face->b, face->c };
+  return 0xFF000000 | ((uint32_t)hash_fnv1a(indices, sizeof(indices), HASH_FNV1A_SEED) & 0x00FFFFFF);
+}
+
+// Appends the triangles of faces [first, last) to state.triangles_to_render.
+void project_faces(mesh_t* mesh, const size_t first, const size_t last)
+{
+  const vec4_t camera_location = vec4_from_vec3(&state.camera.translation);
+
+  for (size_t i = first; i < last; ++i) {
     // printf("cl: %d ", mesh->faces[i].clipped_plane);
     // face_print(&mesh->faces[i]);
 
@@ -336,7 +839,14 @@ void project_mesh(mesh_t* mesh)
       mesh->faces[i].c 
     };
 
-    face_t current_face = mesh->faces[i];
+    clip_face_t current_face = {
+      .tex_coords = { 
+        mesh_vertex_uv(mesh, vertex_indices[0]), 
+        mesh_vertex_uv(mesh, vertex_indices[1]), 
+        mesh_vertex_uv(mesh, vertex_indices[2]) 
+      },
+      .clipped_plane = -1
+    };
     vec4_t transformed_vertices[3];
 
     for (size_t j = 0; j < 3; ++j) {
@@ -345,10 +855,16 @@ void project_mesh(mesh_t* mesh)
       }
       
     unsigned int clip_mask = 0;
+
+    // clipping may push triangles of its own, they take the face's material below
+    const size_t first_triangle = darray_size(state.triangles_to_render);
       
     clip_face_against_frustum_planes(&current_face, transformed_vertices,
       vertex_indices, &clip_mask, mesh);
 
+    for (size_t j = first_triangle; j < darray_size(state.triangles_to_render); ++j)
+      state.triangles_to_render[j].material = mesh->faces[i].material;
+
     if (clip_mask >= 0b111) 
       continue;
 
@@ -379,7 +895,8 @@ void project_mesh(mesh_t* mesh)
     vec4_t light_dir = vec4_from_vec3(&light.direction);
     vec4_normalize(&light_dir);
     const float light_factor = (vec4_dot(&normal, &light_dir) + 1.f) / 2.f;
-    triangle.color = light_shade_flat(&mesh->faces[i], light_factor);
+    triangle.color = light_shade_flat(face_color(&mesh->faces[i]), light_factor);
+    triangle.material = mesh->faces[i].material;
     // triangle.color = mesh->faces[i].color;
     // triangle.color = 0xFFAAAA00;
 
@@ -390,10 +907,6 @@ void project_mesh(mesh_t* mesh)
     
     darray_push(state.triangles_to_render, triangle);
   }
-
-  darray_reset_size(mesh->faces, num_faces);
-  darray_reset_size(mesh->vertices, num_vertices);
-  darray_clear(state.transformed_vertices);
 }
 
 void draw_pixel(const unsigned int x, const unsigned int y, color_t color)
@@ -404,7 +917,7 @@ void draw_pixel(const unsigned int x, const unsigned int y, color_t color)
   state.color_buffer[WINDOW_WIDTH * y + x] = color;
 }
 
-void draw_texel(const unsigned int x, const unsigned int y, const tex2_t* tex, const tri2_t* tri)
+void draw_texel(const unsigned int x, const unsigned int y, const tex2_t* tex, const tri2_t* tri, const float lod)
 {
   if (!tex || !tri) return;
 
@@ -412,9 +925,17 @@ void draw_texel(const unsigned int x, const unsigned int y, const tex2_t* tex, c
 
   const vec3_t weights = tri2_barycentric_weights(tri, p);
 
-  const float alpha = weights.x;
-  const float beta = weights.y;
-  const float gamma = weights.z;
+  draw_texel_weighted(x, y, tex, tri, &weights, lod);
+}
+
+void draw_texel_weighted(const unsigned int x, const unsigned int y, const tex2_t* tex, const tri2_t* tri, 
+  const vec3_t* weights, const float lod)
+{
+  if (!tri || !weights) return;
+
+  const float alpha = weights->x;
+  const float beta = weights->y;
+  const float gamma = weights->z;
 
   const uv_t* tex_coords = tri->tex_coords;
   const float* inv_depth = tri->inv_depth;
@@ -442,10 +963,16 @@ void draw_texel(const unsigned int x, const unsigned int y, const tex2_t* tex, c
 
     color_t color = 0;
 
-    if (tex && (render_method == RENDER_TEXTURE || render_method == RENDER_TEXTURE_WIRE)) {
-      const int tex_x = (int)(interp_u * tex->size.x) % (int)tex->size.x;
-      const int tex_y = (int)(interp_v * tex->size.y) % (int)tex->size.y;
-      color = tex->data[(int)tex->size.x * tex_y + tex_x];
+    const bool textured = tex && tex->num_levels > 0 &&
+      (render_method == RENDER_TEXTURE || render_method == RENDER_TEXTURE_WIRE || render_method == RENDER_TEXTURE_SHADED);
+
+    if (textured && tex->stream) {
+      color = texture_stream_sample(tex->stream, interp_u, interp_v, texture_filter == TEXTURE_FILTER_NEAREST ? 0.f : lod,
+        texture_filter >= TEXTURE_FILTER_BILINEAR, texture_filter == TEXTURE_FILTER_TRILINEAR);
+    } else if (textured) {
+      color = texture_filter == TEXTURE_FILTER_NEAREST ? texture_sample_level(tex, 0, interp_u, interp_v) :
+        texture_sample_lod(tex, interp_u, interp_v, lod, texture_filter >= TEXTURE_FILTER_BILINEAR, 
+          texture_filter == TEXTURE_FILTER_TRILINEAR);
     }
 
     if (render_method == RENDER_FILL_TRIANGLE || render_method == RENDER_FILL_TRIANGLE_WIRE)
@@ -585,16 +1112,6 @@ void draw_depth_buffer(void)
     state.color_buffer[i] = (color_t)(0xFF000000 * state.depth_buffer[i]);
 }
 
-color_t random_color()
-{
-  unsigned char a = 255;
-  unsigned char r = rand() % 256;
-  unsigned char g = rand() % 256;
-  unsigned char b = rand() % 256;
-
-  return (a << 24) | (r << 16) | (g << 8) | b;
-}
-
 void update_frustum_planes(void)
 {
   mat4_t t = camera_get_transform(&state.camera);
@@ -660,7 +1177,7 @@ void update_frustum_planes(void)
 }
 
 // ? What else is contained in face ?
-void handle_single_outside_vertex(face_t* face, vec4_t* tri_verts, const size_t* vertex_indices, 
+void handle_single_outside_vertex(clip_face_t* face, vec4_t* tri_verts, const size_t* vertex_indices, 
   const size_t outside_idx, const vec4_t* plane_location, const vec4_t* plane_normal, const int plane_idx, mesh_t* mesh)
 {
   size_t inside_idx0 = (outside_idx + 2) % 3;
@@ -704,12 +1221,8 @@ void handle_single_outside_vertex(face_t* face, vec4_t* tri_verts, const size_t*
     vertex_indices[inside_idx1]
   };
 
-  face_t new_face = (face_t) {
-    .a = new_vertex_indices[0],
-    .b = new_vertex_indices[1],
-    .c = new_vertex_indices[2],
+  clip_face_t new_face = (clip_face_t) {
     .tex_coords = { { 0.f, 0.f }, { 0.f, 0.f }, { 0.f, 0.f } },
-    .color = 0xFFFFFF00,
     .clipped_plane = plane_idx
   };
 
@@ -759,7 +1272,7 @@ void handle_single_outside_vertex(face_t* face, vec4_t* tri_verts, const size_t*
   darray_push(state.triangles_to_render, triangle);
 }
 
-void handle_two_outside_vertices(face_t* face, vec4_t* vertices, const size_t* vertex_indices, 
+void handle_two_outside_vertices(clip_face_t* face, vec4_t* vertices, const size_t* vertex_indices, 
   const size_t inside_idx, const plane_t* plane)
 {
   const vec4_t plane_location = vec4_from_vec3(&(plane->location));
@@ -838,7 +1351,7 @@ void clip_triangle_against_plane(vec4_t* verts, unsigned int* clip_mask,
   }
 }
 
-void clip_face_against_frustum_planes(face_t* face, vec4_t* transformed_vertices, 
+void clip_face_against_frustum_planes(clip_face_t* face, vec4_t* transformed_vertices, 
   const size_t* vertex_indices, unsigned int* clip_mask, mesh_t* mesh)
 {
   for (int k = 0 ; k < PLANE_COUNT; ++k) {
@@ -24,15 +24,34 @@ enum render_method {
   RENDER_TEXTURE,
   RENDER_TEXTURE_WIRE,
   RENDER_DEPTH_BUFFER,
+  RENDER_TEXTURE_SHADED,
   RENDER_DEFAULT_MAX
 } extern render_method;
 
+enum geometry_method {
+  GEOMETRY_WHOLE_MESH,
+  GEOMETRY_BATCHED,
+  GEOMETRY_DEFAULT_MAX
+} extern geometry_method;
+
+enum texture_filter {
+  TEXTURE_FILTER_NEAREST,
+  TEXTURE_FILTER_MIPMAP,
+  TEXTURE_FILTER_BILINEAR,
+  TEXTURE_FILTER_TRILINEAR,
+  TEXTURE_FILTER_DEFAULT_MAX
+} extern texture_filter;
+
 typedef uint32_t color_t;
 
 extern camera_t* state_camera;
 extern float* state_delta_time;
 
-bool init_graphics(void);
+// headless renders into memory only, without a window or SDL video, at a fixed time step
+bool init_graphics(const bool headless);
+
+// blocks until the mesh and textures requested at init are loaded, or failed to
+void wait_for_assets(void);
 
 // preliminary
 bool init_meshes(void);
@@ -44,12 +63,21 @@ size_t screen_buffer_size(void);
 void clear_color_buffer(color_t color);
 void clear_depth_buffer();
 void render_color_buffer(void);
+
+// the last rendered frame as PNG if path ends in .png, as PPM otherwise
+bool save_frame(const char* path);
 void project_vertex(const vec4_t* vert_3d, vec2_t* vert_2d, float* inv_depth);
 void project_mesh(mesh_t* mesh);
+void transform_mesh_vertices(const mesh_t* mesh);
+void project_faces(mesh_t* mesh, const size_t first, const size_t last);
+void rasterize_triangles(void);
+void render_mesh_batched(mesh_t* mesh);
 void sort_triangles(tri2_t* triangles);
 
 void draw_pixel(const unsigned int x, const unsigned int y, color_t color);
-void draw_texel(const unsigned int x, const unsigned int y, const tex2_t* tex, const tri2_t* tri);
+void draw_texel(const unsigned int x, const unsigned int y, const tex2_t* tex, const tri2_t* tri, const float lod);
+void draw_texel_weighted(const unsigned int x, const unsigned int y, const tex2_t* tex, const tri2_t* tri, 
+  const vec3_t* weights, const float lod);
 void draw_line_dda(const unsigned int x0, const unsigned int y0, const unsigned int x1, const unsigned int y1, color_t color);
 void draw_line_bresenham(unsigned int x0, unsigned int y0, const unsigned int x1, const unsigned int y1, color_t color);
 void draw_triangle_vertices(const tri2_t* triangle, color_t color);
@@ -60,14 +88,12 @@ void draw_grid(void);
 
 void draw_depth_buffer(void);
 
-color_t random_color(void);
-
 // separate files?
 void update_frustum_planes(void);
 
-void handle_single_outside_vertex(face_t* face, vec4_t* tri_verts, const size_t* vertex_indices, const size_t outside_idx, 
+void handle_single_outside_vertex(clip_face_t* face, vec4_t* tri_verts, const size_t* vertex_indices, const size_t outside_idx, 
   const vec4_t* plane_location, const vec4_t* plane_normal, const int plane_idx, mesh_t* mesh);
-void handle_two_outside_vertices(face_t* face, vec4_t* vertices, const size_t* vertex_indices, const size_t inside_idx, const plane_t* plane);
+void handle_two_outside_vertices(clip_face_t* face, vec4_t* vertices, const size_t* vertex_indices, const size_t inside_idx, const plane_t* plane);
 
 void move_outside_vertex_to_plane(vec4_t* outside_vert, const size_t outside_idx, const vec4_t* inside_vert, const float inside_dot, 
   const vec4_t* plane_location, const vec4_t* plane_normal, float* out_lerp_factor);
@@ -78,5 +104,5 @@ const float calc_lerp_factor(const vec4_t* outside_vert, const float inside_dot,
 const bool vertex_outside_plane(const vec4_t* vert, const vec4_t* plane_location, const vec4_t* plane_normal);
 void clip_triangle_against_plane(vec4_t* verts, unsigned int* clip_mask, const vec4_t* plane_location, const vec4_t* plane_normal);
 
-void clip_face_against_frustum_planes(face_t* face, vec4_t* transformed_vertices, const size_t* vertex_indices, 
+void clip_face_against_frustum_planes(clip_face_t* face, vec4_t* transformed_vertices, const size_t* vertex_indices, 
   unsigned int* clip_mask, mesh_t* mesh);
@@ -0,0 +1,33 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH_FNV1A_SEED 0xcbf29ce484222325ULL
+
+// 64-bit FNV-1a, pass the result of a previous call as seed to hash data in pieces
+static inline uint64_t hash_fnv1a(const void* data, const size_t size, uint64_t seed)
+{
+  const unsigned char* bytes = (const unsigned char*)data;
+
+  for (size_t i = 0; i < size; ++i) {
+    seed ^= bytes[i];
+    seed *= 0x100000001b3ULL;
+  }
+
+  return seed;
+}
+
+static inline uint64_t hash_string(const char* str)
+{
+  uint64_t hash = HASH_FNV1A_SEED;
+
+  while (*str) {
+    hash ^= (unsigned char)*str++;
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
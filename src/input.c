@@ -38,6 +38,20 @@ void process_input(bool* is_running)
         break;
       }
 
+      if (event.key.keysym.sym == SDLK_b) {
+        if (geometry_method == GEOMETRY_WHOLE_MESH)
+          geometry_method = GEOMETRY_BATCHED;
+
+        else
+          geometry_method = GEOMETRY_WHOLE_MESH;
+        break;
+      }
+
+      if (event.key.keysym.sym == SDLK_t) {
+        texture_filter = (texture_filter + 1) % TEXTURE_FILTER_DEFAULT_MAX;
+        break;
+      }
+
       if (event.key.keysym.sym == SDLK_1) {
         render_method = RENDER_WIRE;
         break;
@@ -73,6 +87,11 @@ void process_input(bool* is_running)
         break;
       }
 
+      if (event.key.keysym.sym == SDLK_8) {
+        render_method = RENDER_TEXTURE_SHADED;
+        break;
+      }
+
       if (event.key.keysym.sym == SDLK_w) {
         direction.z = 1.f;
         move_camera(state_camera, &direction, *state_delta_time);
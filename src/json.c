@@ -0,0 +1,223 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "json.h"
+#include "parse.h"
+
+static inline bool is_json_space(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool is_json_delimiter(const char c)
+{
+  return is_json_space(c) || c == ',' || c == ':' || c == ']' || c == '}';
+}
+
+// Containers are pushed on a stack when opened, and get their end and next index when closed.
+// Separators aren't validated, the files come from exporters, not from users.
+bool json_parse(json_t* json, const char* text, const size_t size)
+{
+  if (!json || !text) return false;
+
+  json->text = text;
+  json->tokens = NULL;
+
+  uint32_t* open = NULL;
+  size_t i = 0;
+
+  while (i < size) {
+    const char c = text[i];
+
+    if (is_json_space(c) || c == ',' || c == ':') {
+      ++i;
+    } else if (c == '{' || c == '[') {
+      const json_token_t token = { .type = c == '{' ? JSON_OBJECT : JSON_ARRAY, .start = (uint32_t)i };
+      const uint32_t index = (uint32_t)darray_size(json->tokens);
+
+      darray_push(json->tokens, token);
+      darray_push(open, index);
+      ++i;
+    } else if (c == '}' || c == ']') {
+      const size_t depth = darray_size(open);
+      const json_type_t type = c == '}' ? JSON_OBJECT : JSON_ARRAY;
+
+      if (depth == 0 || json->tokens[open[depth - 1]].type != type)
+        break;
+
+      json_token_t* token = &json->tokens[open[depth - 1]];
+      token->end = (uint32_t)++i;
+      token->next = (uint32_t)darray_size(json->tokens);
+      darray_reset_size(open, depth - 1);
+    } else if (c == '"') {
+      size_t end = ++i;
+
+      while (end < size && text[end] != '"')
+        end += text[end] == '\\' ? 2 : 1;
+
+      if (end >= size)
+        break;
+
+      const json_token_t token = {
+        .type = JSON_STRING,
+        .start = (uint32_t)i,
+        .end = (uint32_t)end,
+        .next = (uint32_t)darray_size(json->tokens) + 1
+      };
+
+      darray_push(json->tokens, token);
+      i = end + 1;
+    } else {
+      size_t end = i;
+
+      while (end < size && !is_json_delimiter(text[end]))
+        ++end;
+
+      const json_token_t token = {
+        .type = JSON_PRIMITIVE,
+        .start = (uint32_t)i,
+        .end = (uint32_t)end,
+        .next = (uint32_t)darray_size(json->tokens) + 1
+      };
+
+      darray_push(json->tokens, token);
+      i = end;
+    }
+  }
+
+  const bool complete = i >= size && darray_size(open) == 0 && darray_size(json->tokens) > 0;
+  darray_free(open);
+
+  if (!complete) {
+    fprintf(stderr, "Error parsing JSON at offset %zu.\n", i);
+    json_free(json);
+  }
+
+  return complete;
+}
+
+void json_free(json_t* json)
+{
+  if (!json) return;
+
+  darray_free(json->tokens);
+  json->tokens = NULL;
+}
+
+static inline bool is_valid_token(const json_t* json, const int32_t token)
+{
+  return token >= 0 && (size_t)token < darray_size(json->tokens);
+}
+
+int32_t json_find(const json_t* json, const int32_t object, const char* key)
+{
+  if (!is_valid_token(json, object) || json->tokens[object].type != JSON_OBJECT)
+    return JSON_NONE;
+
+  uint32_t child = (uint32_t)object + 1;
+
+  // children alternate between keys and values
+  while (child < json->tokens[object].next) {
+    const uint32_t value = json->tokens[child].next;
+
+    if (value >= json->tokens[object].next)
+      break;
+
+    if (json_equals(json, (int32_t)child, key))
+      return (int32_t)value;
+
+    child = json->tokens[value].next;
+  }
+
+  return JSON_NONE;
+}
+
+int32_t json_at(const json_t* json, const int32_t array, const size_t index)
+{
+  if (!is_valid_token(json, array) || json->tokens[array].type != JSON_ARRAY)
+    return JSON_NONE;
+
+  uint32_t child = (uint32_t)array + 1;
+
+  for (size_t i = 0; i < index && child < json->tokens[array].next; ++i)
+    child = json->tokens[child].next;
+
+  return child < json->tokens[array].next ? (int32_t)child : JSON_NONE;
+}
+
+size_t json_count(const json_t* json, const int32_t container)
+{
+  if (!is_valid_token(json, container) || json->tokens[container].type > JSON_ARRAY)
+    return 0;
+
+  size_t count = 0;
+
+  for (uint32_t child = (uint32_t)container + 1; child < json->tokens[container].next; child = json->tokens[child].next)
+    ++count;
+
+  return json->tokens[container].type == JSON_OBJECT ? count / 2 : count;
+}
+
+bool json_equals(const json_t* json, const int32_t token, const char* str)
+{
+  if (!is_valid_token(json, token) || json->tokens[token].type != JSON_STRING)
+    return false;
+
+  const json_token_t* t = &json->tokens[token];
+  const size_t length = strlen(str);
+
+  return t->end - t->start == length && memcmp(json->text + t->start, str, length) == 0;
+}
+
+int64_t json_int(const json_t* json, const int32_t token, const int64_t fallback)
+{
+  if (!is_valid_token(json, token) || json->tokens[token].type != JSON_PRIMITIVE)
+    return fallback;
+
+  const char* cur = json->text + json->tokens[token].start;
+  int64_t value = 0;
+
+  return parse_int(&cur, json->text + json->tokens[token].end, &value) ? value : fallback;
+}
+
+bool json_bool(const json_t* json, const int32_t token, const bool fallback)
+{
+  if (!is_valid_token(json, token) || json->tokens[token].type != JSON_PRIMITIVE)
+    return fallback;
+
+  const char c = json->text[json->tokens[token].start];
+
+  return c == 't' ? true : c == 'f' ? false : fallback;
+}
+
+float json_float(const json_t* json, const int32_t token, const float fallback)
+{
+  if (!is_valid_token(json, token) || json->tokens[token].type != JSON_PRIMITIVE)
+    return fallback;
+
+  const char* cur = json->text + json->tokens[token].start;
+  float value = 0.f;
+
+  return parse_float(&cur, json->text + json->tokens[token].end, &value) ? value : fallback;
+}
+
+// copies the raw string, escape sequences are kept as they are
+void json_string(const json_t* json, const int32_t token, char* buffer, const size_t size)
+{
+  if (size == 0) return;
+
+  buffer[0] = '\0';
+
+  if (!is_valid_token(json, token) || json->tokens[token].type != JSON_STRING)
+    return;
+
+  const json_token_t* t = &json->tokens[token];
+  const size_t length = MIN((size_t)(t->end - t->start), size - 1);
+
+  memcpy(buffer, json->text + t->start, length);
+  buffer[length] = '\0';
+}
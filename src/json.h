@@ -0,0 +1,47 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal JSON tokenizer for asset headers (e.g. glTF). The text isn't copied or unescaped,
+// tokens only reference ranges of it, so it has to outlive the json_t.
+
+typedef enum json_type {
+  JSON_OBJECT,
+  JSON_ARRAY,
+  JSON_STRING,
+  JSON_PRIMITIVE
+} json_type_t;
+
+typedef struct json_token {
+  json_type_t type;
+  uint32_t start;
+  uint32_t end;
+  // index of the first token after this one's children
+  uint32_t next;
+} json_token_t;
+
+typedef struct json {
+  const char* text;
+  json_token_t* tokens;
+} json_t;
+
+#define JSON_NONE (-1)
+
+bool json_parse(json_t* json, const char* text, const size_t size);
+void json_free(json_t* json);
+
+// value of key in object, or JSON_NONE
+int32_t json_find(const json_t* json, const int32_t object, const char* key);
+// element of array, or JSON_NONE
+int32_t json_at(const json_t* json, const int32_t array, const size_t index);
+size_t json_count(const json_t* json, const int32_t container);
+
+bool json_equals(const json_t* json, const int32_t token, const char* str);
+int64_t json_int(const json_t* json, const int32_t token, const int64_t fallback);
+bool json_bool(const json_t* json, const int32_t token, const bool fallback);
+float json_float(const json_t* json, const int32_t token, const float fallback);
+void json_string(const json_t* json, const int32_t token, char* buffer, const size_t size);
@@ -4,4 +4,4 @@
 
 #include "types.h"
 
-color_t light_shade_flat(const face_t* face, float factor);
+color_t light_shade_flat(const color_t color, float factor);
@@ -1,15 +1,81 @@
 ﻿// Copyright 2025 Sebastian Cyliax
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assetpack.h"
 #include "graphics.h"
 #include "input.h"
+#include "texturecache.h"
 
 #define SDL_MAIN_HANDLED
 
 static bool is_running = false;
 
+// path with the frame number before its extension, e.g. frames/cube.png becomes frames/cube_0007.png
+static void frame_path(char* buffer, const size_t size, const char* path, const unsigned frame)
+{
+  const char* extension = strrchr(path, '.');
+  const char* separator = strpbrk(extension ? extension : path, "/\\");
+
+  if (!extension || separator)
+    extension = path + strlen(path);
+
+  snprintf(buffer, size, "%.*s_%04u%s", (int)(extension - path), path, frame, extension);
+}
+
+// e.g. --headless 60 frames/cube.png 5, renders 60 frames with the assets loaded and saves each, in
+// the render mode of key 5 if given
+static int render_headless(const int argc, char* argv[])
+{
+  const long num_frames = strtol(argv[2], NULL, 10);
+  const long mode = argc >= 5 ? strtol(argv[4], NULL, 10) : 0;
+
+  if (num_frames <= 0 || mode < 0 || mode > RENDER_DEFAULT_MAX) {
+    fprintf(stderr, "Usage: --headless <frames> <output.ppm|output.png> [render mode 1-%d]\n", RENDER_DEFAULT_MAX);
+    return 1;
+  }
+
+  if (mode > 0)
+    render_method = (enum render_method)(mode - 1);
+
+  if (!init_graphics(true)) return 1;
+
+  wait_for_assets();
+
+  bool saved = true;
+
+  for (long i = 0; i < num_frames && saved; ++i) {
+    update();
+    render();
+
+    char path[1024];
+    frame_path(path, sizeof(path), argv[3], (unsigned)i);
+    saved = save_frame(path);
+  }
+
+  destroy_window();
+
+  return saved ? 0 : 1;
+}
+
 int main(int argc, char* argv[])
 {
-  is_running = init_graphics();
+  // e.g. --pack assets/assets.pack assets/cube.obj assets/cube.png, packs and exits
+  if (argc >= 3 && strcmp(argv[1], "--pack") == 0)
+    return asset_pack_write(argv[2], (const char* const*)&argv[3], (size_t)(argc - 3)) ? 0 : 1;
+
+  // e.g. --convert-textures assets/*.png, writes the texture caches in parallel and exits
+  if (argc >= 2 && strcmp(argv[1], "--convert-textures") == 0) {
+    const size_t count = (size_t)(argc - 2);
+    return texture_cache_convert((const char* const*)&argv[2], count) == count ? 0 : 1;
+  }
+
+  if (argc >= 4 && strcmp(argv[1], "--headless") == 0)
+    return render_headless(argc, argv);
+
+  is_running = init_graphics(false);
 
   if (!is_running) return 0;
 
@@ -2,76 +2,1143 @@
 
 #include <stdio.h>
 #include <string.h>
+
+#include <SDL.h>
+
 #include "darray.h"
+#include "filemap.h"
 #include "matrix.h"
 #include "mesh.h"
+#include "meshcache.h"
+#include "meshglb.h"
+#include "meshopt.h"
+#include "meshply.h"
+#include "meshquant.h"
+#include "parse.h"
+#include "texture.h"
+#include "textures.h"
+#include "vector.h"
+
+#define OBJ_INDEX_NONE INT32_MIN
+#define OBJ_NONE UINT32_MAX
+#define OBJ_NAME_SIZE 64
+// material of the faces before a chunk's first "usemtl", the last one of the previous chunks
+#define OBJ_MATERIAL_INHERIT -1
+
+// triangle as written in the file: indices are 0-based and global, or relative to the chunk
+// that contains the face if the corresponding bit in relative_mask is set (bits 0-2 for 
+// positions, 3-5 for uvs, 6-8 for normals); missing uvs and normals are OBJ_INDEX_NONE. material
+// indexes the chunk's materials, or is OBJ_MATERIAL_INHERIT
+typedef struct obj_face {
+  int32_t vertex_idx[3];
+  int32_t tex_idx[3];
+  int32_t normal_idx[3];
+  int32_t material;
+  uint32_t line;
+  uint16_t relative_mask;
+} obj_face_t;
+
+typedef struct obj_name {
+  char name[OBJ_NAME_SIZE];
+} obj_name_t;
+
+// "o"/"g" statement, which starts before the chunk's face first_face
+typedef struct obj_group {
+  char name[OBJ_NAME_SIZE];
+  size_t first_face;
+} obj_group_t;
+
+// triangle with global attribute indices, OBJ_NONE for missing uvs and normals
+typedef struct obj_triangle {
+  uint32_t vertex_idx[3];
+  uint32_t tex_idx[3];
+  uint32_t normal_idx[3];
+  uint32_t material;
+} obj_triangle_t;
+
+// part of the file that ends at a line break, parsed independently of the other chunks
+typedef struct obj_chunk {
+  const char* begin;
+  const char* end;
+  vec3_t* vertices;
+  uv_t* tex_coords;
+  vec3_t* normals;
+  obj_face_t* faces;
+  obj_name_t* materials;
+  obj_name_t* material_libs;
+  obj_group_t* groups;
+  // active at the end of the chunk, or OBJ_MATERIAL_INHERIT
+  int32_t last_material;
+  size_t num_lines;
+  size_t num_bad_lines;
+  size_t first_bad_line;
+
+  // filled in before the merge
+  const uint32_t* material_map;
+  uint32_t inherited_material;
+  size_t line_base;
+  size_t vertex_base;
+  size_t tex_coord_base;
+  size_t normal_base;
+  size_t num_all_vertices;
+  size_t num_all_tex_coords;
+  size_t num_all_normals;
+  obj_triangle_t* triangles_out;
+  size_t num_faces_out;
+  size_t* group_starts;
+  size_t num_bad_faces;
+  size_t first_bad_face_line;
+} obj_chunk_t;
+
+static inline bool is_keyword(const char* cur, const char* end, const char* keyword, const size_t len)
+{
+  if ((size_t)(end - cur) <= len) return false;
+
+  for (size_t i = 0; i < len; ++i) {
+    if (cur[i] != keyword[i]) return false;
+  }
+
+  return cur[len] == ' ' || cur[len] == '\t';
+}
+
+// copies the rest of the line without surrounding whitespace, truncated to size
+static void parse_name(const char* cur, const char* end, char* name, const size_t size)
+{
+  cur = parse_skip_spaces(cur, end);
+
+  const char* name_end = cur;
+
+  while (name_end < end && *name_end != '\n' && *name_end != '#')
+    ++name_end;
+
+  while (name_end > cur && (name_end[-1] == ' ' || name_end[-1] == '\t' || name_end[-1] == '\r'))
+    --name_end;
+
+  const size_t len = MIN((size_t)(name_end - cur), size - 1);
+  memcpy(name, cur, len);
+  name[len] = '\0';
+}
+
+// converts a raw OBJ index, 0 is invalid
+static inline bool obj_index(const int64_t raw, const size_t local_count, int32_t* idx, bool* relative)
+{
+  const int64_t converted = raw < 0 ? (int64_t)local_count + raw : raw - 1;
+
+  if (raw == 0 || converted <= INT32_MIN || converted > INT32_MAX) return false;
+
+  *relative = raw < 0;
+  *idx = (int32_t)converted;
+
+  return true;
+}
+
+typedef struct obj_corner {
+  int32_t idx[3];
+  bool relative[3];
+} obj_corner_t;
+
+// parses "v", "v/t", "v//n" or "v/t/n"
+static bool parse_face_corner(const char** cur, const char* end, const size_t* local_counts, obj_corner_t* corner)
+{
+  const char* p = *cur;
+  int64_t raw = 0;
+
+  corner->idx[1] = OBJ_INDEX_NONE;
+  corner->idx[2] = OBJ_INDEX_NONE;
+  corner->relative[1] = false;
+  corner->relative[2] = false;
+
+  if (!parse_int(&p, end, &raw) || !obj_index(raw, local_counts[0], &corner->idx[0], &corner->relative[0]))
+    return false;
+
+  if (p < end && *p == '/') {
+    ++p;
+
+    if (p < end && *p != '/') {
+      if (!parse_int(&p, end, &raw) || !obj_index(raw, local_counts[1], &corner->idx[1], &corner->relative[1]))
+        return false;
+    }
+
+    if (p < end && *p == '/') {
+      ++p;
+
+      if (!parse_int(&p, end, &raw) || !obj_index(raw, local_counts[2], &corner->idx[2], &corner->relative[2]))
+        return false;
+    }
+  }
+
+  // corners are separated by whitespace
+  if (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '#')
+    return false;
+
+  *cur = p;
+  return true;
+}
+
+static inline bool line_done(const char* p, const char* end)
+{
+  p = parse_skip_spaces(p, end);
+  return p == end || *p == '\n' || *p == '#';
+}
+
+static int32_t find_or_add_name(obj_name_t** names, const char* name)
+{
+  const size_t count = darray_size(*names);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (strcmp((*names)[i].name, name) == 0)
+      return (int32_t)i;
+  }
+
+  obj_name_t entry;
+  snprintf(entry.name, sizeof(entry.name), "%s", name);
+  darray_push(*names, entry);
+
+  return (int32_t)count;
+}
+
+// polygons are triangulated as a fan around their first corner
+static bool parse_face(obj_chunk_t* chunk, const char* p, const char* end, const size_t* local_counts, 
+  const int32_t material)
+{
+  obj_corner_t first;
+  obj_corner_t prev;
+  obj_corner_t corner;
+  size_t num_corners = 0;
+
+  while (!line_done(p, end)) {
+    if (!parse_face_corner(&p, end, local_counts, &corner))
+      return false;
+
+    if (num_corners >= 2) {
+      const obj_corner_t* corners[3] = { &first, &prev, &corner };
+      obj_face_t f = { .relative_mask = 0, .material = material, .line = (uint32_t)chunk->num_lines };
+
+      for (size_t i = 0; i < 3; ++i) {
+        f.vertex_idx[i] = corners[i]->idx[0];
+        f.tex_idx[i] = corners[i]->idx[1];
+        f.normal_idx[i] = corners[i]->idx[2];
+
+        f.relative_mask |= (uint16_t)(corners[i]->relative[0] << i);
+        f.relative_mask |= (uint16_t)(corners[i]->relative[1] << (i + 3));
+        f.relative_mask |= (uint16_t)(corners[i]->relative[2] << (i + 6));
+      }
+
+      darray_push(chunk->faces, f);
+    }
+
+    if (num_corners == 0)
+      first = corner;
+
+    prev = corner;
+    ++num_corners;
+  }
+
+  return num_corners >= 3;
+}
+
+static void report_bad_line(obj_chunk_t* chunk)
+{
+  if (chunk->num_bad_lines++ == 0)
+    chunk->first_bad_line = chunk->num_lines;
+}
+
+static int parse_obj_chunk(void* data)
+{
+  obj_chunk_t* chunk = (obj_chunk_t*)data;
+
+  const char* cur = chunk->begin;
+  const char* end = chunk->end;
+  
+  size_t local_counts[3] = { 0, 0, 0 };
+  int32_t material = OBJ_MATERIAL_INHERIT;
+
+  while (cur < end) {
+    const char* p = parse_skip_spaces(cur, end);
+
+    if (is_keyword(p, end, "v", 1)) {
+      p += 2;
+      vec3_t v;
+
+      // an optional vertex color (or w) may follow
+      if (parse_float(&p, end, &v.x) && parse_float(&p, end, &v.y) && parse_float(&p, end, &v.z)) {
+        darray_push(chunk->vertices, v);
+        ++local_counts[0];
+      }
+
+      else report_bad_line(chunk);
+    }
+
+    else if (is_keyword(p, end, "vt", 2)) {
+      p += 3;
+      uv_t uv = { 0.f, 0.f };
+
+      // v is optional and defaults to 0
+      if (parse_float(&p, end, &uv.u)) {
+        parse_float(&p, end, &uv.v);
+        uv.v = 1.f - uv.v;
+        darray_push(chunk->tex_coords, uv);
+        ++local_counts[1];
+      }
+
+      else report_bad_line(chunk);
+    }
+
+    else if (is_keyword(p, end, "vn", 2)) {
+      p += 3;
+      vec3_t n;
+
+      if (parse_float(&p, end, &n.x) && parse_float(&p, end, &n.y) && parse_float(&p, end, &n.z)) {
+        darray_push(chunk->normals, n);
+        ++local_counts[2];
+      }
+
+      else report_bad_line(chunk);
+    }
+
+    else if (is_keyword(p, end, "f", 1)) {
+      const size_t num_faces = darray_size(chunk->faces);
+
+      // drop the triangles of a partially parsed polygon
+      if (!parse_face(chunk, p + 2, end, local_counts, material)) {
+        darray_reset_size(chunk->faces, num_faces);
+        report_bad_line(chunk);
+      }
+    }
+
+    else if (is_keyword(p, end, "usemtl", 6)) {
+      char name[OBJ_NAME_SIZE];
+      parse_name(p + 7, end, name, sizeof(name));
+      material = find_or_add_name(&chunk->materials, name);
+    }
+
+    else if (is_keyword(p, end, "mtllib", 6)) {
+      obj_name_t lib;
+      parse_name(p + 7, end, lib.name, sizeof(lib.name));
+      darray_push(chunk->material_libs, lib);
+    }
+
+    else if (is_keyword(p, end, "o", 1) || is_keyword(p, end, "g", 1)) {
+      obj_group_t group = { .first_face = darray_size(chunk->faces) };
+      parse_name(p + 2, end, group.name, sizeof(group.name));
+      darray_push(chunk->groups, group);
+    }
+
+    // p never moves past the end of the current line
+    cur = parse_skip_line(p, end);
+    ++chunk->num_lines;
+  }
+
+  chunk->last_material = material;
+
+  return 0;
+}
+
+static inline bool resolve_obj_index(const int32_t idx, const bool relative, const size_t base, 
+  const size_t count, size_t* out)
+{
+  const int64_t global = relative ? (int64_t)base + idx : idx;
+
+  if (global < 0 || global >= (int64_t)count) return false;
+
+  *out = (size_t)global;
+  return true;
+}
+
+static inline bool resolve_obj_corner(const obj_chunk_t* chunk, const obj_face_t* raw, const size_t corner,
+  obj_triangle_t* tri)
+{
+  size_t idx = 0;
+
+  if (!resolve_obj_index(raw->vertex_idx[corner], (raw->relative_mask >> corner) & 1, 
+    chunk->vertex_base, chunk->num_all_vertices, &idx))
+    return false;
+
+  tri->vertex_idx[corner] = (uint32_t)idx;
+  tri->tex_idx[corner] = OBJ_NONE;
+  tri->normal_idx[corner] = OBJ_NONE;
+
+  if (raw->tex_idx[corner] != OBJ_INDEX_NONE) {
+    if (!resolve_obj_index(raw->tex_idx[corner], (raw->relative_mask >> (corner + 3)) & 1, 
+      chunk->tex_coord_base, chunk->num_all_tex_coords, &idx))
+      return false;
+
+    tri->tex_idx[corner] = (uint32_t)idx;
+  }
+
+  // unlike positions and uvs, a broken normal index is tolerated, the normal is generated instead
+  if (raw->normal_idx[corner] != OBJ_INDEX_NONE && resolve_obj_index(raw->normal_idx[corner], 
+    (raw->relative_mask >> (corner + 6)) & 1, chunk->normal_base, chunk->num_all_normals, &idx))
+    tri->normal_idx[corner] = (uint32_t)idx;
+
+  return true;
+}
+
+// resolves the chunk's faces to global attribute indices
+static int merge_obj_chunk(void* data)
+{
+  obj_chunk_t* chunk = (obj_chunk_t*)data;
+
+  const size_t num_faces = darray_size(chunk->faces);
+  const size_t num_groups = darray_size(chunk->groups);
+  size_t group = 0;
+
+  for (size_t i = 0; i < num_faces; ++i) {
+    // groups start at the first valid face at or after their statement
+    for (; group < num_groups && chunk->groups[group].first_face <= i; ++group)
+      chunk->group_starts[group] = chunk->num_faces_out;
+
+    const obj_face_t* raw = &chunk->faces[i];
+    obj_triangle_t* tri = &chunk->triangles_out[chunk->num_faces_out];
+    bool valid = true;
+
+    for (size_t j = 0; j < 3 && valid; ++j)
+      valid = resolve_obj_corner(chunk, raw, j, tri);
+
+    if (!valid) {
+      if (chunk->num_bad_faces++ == 0)
+        chunk->first_bad_face_line = chunk->line_base + raw->line;
+
+      continue;
+    }
+
+    tri->material = raw->material != OBJ_MATERIAL_INHERIT ? chunk->material_map[raw->material] :
+      chunk->inherited_material;
+    ++chunk->num_faces_out;
+  }
+
+  for (; group < num_groups; ++group)
+    chunk->group_starts[group] = chunk->num_faces_out;
+
+  return 0;
+}
+
+typedef struct weld_entry {
+  uint32_t key[3];
+  uint32_t vertex;
+} weld_entry_t;
+
+static inline size_t weld_hash(const uint32_t* key, const size_t mask)
+{
+  uint64_t h = key[0] * 0x9E3779B97F4A7C15ULL;
+  h ^= (key[1] + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+  h ^= (key[2] + 0x165667B19E3779F9ULL) * 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+
+  return (size_t)h & mask;
+}
+
+// open addressing, so the entries are probed linearly in one allocation
+static weld_entry_t* weld_find(weld_entry_t* table, const size_t mask, const uint32_t* key)
+{
+  size_t slot = weld_hash(key, mask);
+
+  while (table[slot].vertex != OBJ_NONE && 
+    (table[slot].key[0] != key[0] || table[slot].key[1] != key[1] || table[slot].key[2] != key[2]))
+    slot = (slot + 1) & mask;
+
+  return &table[slot];
+}
+
+static weld_entry_t* weld_table_alloc(const size_t capacity)
+{
+  weld_entry_t* table = malloc(sizeof(weld_entry_t) * capacity);
+  if (!table) exit(EXIT_FAILURE);
+
+  for (size_t i = 0; i < capacity; ++i)
+    table[i].vertex = OBJ_NONE;
+
+  return table;
+}
+
+// Builds one vertex per unique (position, uv, normal) combination, and the faces as index triples
+// into them. Vertices without a normal in the file get the area weighted average of their faces' normals.
+static void weld_obj_triangles(mesh_t* mesh, const obj_triangle_t* tris, const size_t num_tris, 
+  const vec3_t* positions, const uv_t* tex_coords, const vec3_t* normals)
+{
+  size_t capacity = 64;
+
+  while (capacity < darray_size((void*)positions) * 2)
+    capacity <<= 1;
+
+  weld_entry_t* table = weld_table_alloc(capacity);
+  size_t num_vertices = 0;
+
+  // most meshes end up with about as many vertices as positions
+  if (darray_size((void*)positions) > 0) {
+    mesh->vertices = darray_alloc(mesh->vertices, sizeof(vertex_t), darray_size((void*)positions));
+    darray_reset_size(mesh->vertices, 0);
+  }
+
+  mesh->faces = num_tris > 0 ? darray_alloc(mesh->faces, sizeof(face_t), num_tris) : mesh->faces;
+
+  for (size_t i = 0; i < num_tris; ++i) {
+    const obj_triangle_t* tri = &tris[i];
+    uint32_t indices[3];
+
+    for (size_t j = 0; j < 3; ++j) {
+      const uint32_t key[3] = { tri->vertex_idx[j], tri->tex_idx[j], tri->normal_idx[j] };
+      weld_entry_t* entry = weld_find(table, capacity - 1, key);
+
+      if (entry->vertex == OBJ_NONE) {
+        const vertex_t vertex = {
+          .position = positions[key[0]],
+          .uv = key[1] != OBJ_NONE ? tex_coords[key[1]] : (uv_t) { 0.f, 0.f },
+          .normal = key[2] != OBJ_NONE ? normals[key[2]] : vec3_null
+        };
+
+        darray_push(mesh->vertices, vertex);
+
+        memcpy(entry->key, key, sizeof(key));
+        entry->vertex = (uint32_t)num_vertices++;
+
+        // keep the load factor below one half
+        if (num_vertices * 2 > capacity) {
+          weld_entry_t* old = table;
+          const size_t old_capacity = capacity;
+
+          capacity <<= 1;
+          table = weld_table_alloc(capacity);
+
+          for (size_t k = 0; k < old_capacity; ++k) {
+            if (old[k].vertex != OBJ_NONE)
+              *weld_find(table, capacity - 1, old[k].key) = old[k];
+          }
+
+          free(old);
+          entry = weld_find(table, capacity - 1, key);
+        }
+      }
+
+      indices[j] = entry->vertex;
+    }
+
+    mesh->faces[i] = (face_t) {
+      .a = indices[0],
+      .b = indices[1],
+      .c = indices[2],
+      .color = 0xFF000000,
+      .material = tri->material
+    };
+
+    // accumulate the unnormalized face normal, its length is twice the face's area
+    if (tri->normal_idx[0] == OBJ_NONE || tri->normal_idx[1] == OBJ_NONE || tri->normal_idx[2] == OBJ_NONE) {
+      const vec3_t ab = vec3_sub(&positions[tri->vertex_idx[1]], &positions[tri->vertex_idx[0]]);
+      const vec3_t ac = vec3_sub(&positions[tri->vertex_idx[2]], &positions[tri->vertex_idx[0]]);
+      const vec3_t normal = vec3_cross(&ab, &ac);
+
+      for (size_t j = 0; j < 3; ++j) {
+        if (tri->normal_idx[j] == OBJ_NONE)
+          mesh->vertices[indices[j]].normal = vec3_add(&mesh->vertices[indices[j]].normal, &normal);
+      }
+    }
+  }
+
+  free(table);
+
+  for (size_t i = 0; i < num_vertices; ++i) {
+    vec3_t* normal = &mesh->vertices[i].normal;
+
+    if (vec3_mag(normal) > 0.f)
+      vec3_normalize(normal);
+  }
+}
+
+// runs func on every chunk, the first one on the calling thread
+static void run_obj_chunks(obj_chunk_t* chunks, const size_t num_chunks, int (*func)(void*))
+{
+  SDL_Thread* threads[OBJ_MAX_THREADS] = { NULL };
+
+  for (size_t i = 1; i < num_chunks; ++i) {
+    threads[i] = SDL_CreateThread(func, "obj_parse", &chunks[i]);
+
+    // fall back to this thread, if no new one can be started
+    if (!threads[i])
+      func(&chunks[i]);
+  }
+
+  func(&chunks[0]);
+
+  for (size_t i = 1; i < num_chunks; ++i) {
+    if (threads[i])
+      SDL_WaitThread(threads[i], NULL);
+  }
+}
 
+// concatenates the chunks' darrays of one element type into a single new darray
+#define MERGE_CHUNK_ARRAYS(chunks, num_chunks, member, type, out, bases)\
+do {\
+  size_t total_ = 0;\
+  for (size_t i_ = 0; i_ < (num_chunks); ++i_) {\
+    (chunks)[i_].bases = total_;\
+    total_ += darray_size((chunks)[i_].member);\
+  }\
+  (out) = total_ > 0 ? darray_alloc(NULL, sizeof(type), total_) : NULL;\
+  for (size_t i_ = 0; i_ < (num_chunks); ++i_) {\
+    const size_t count_ = darray_size((chunks)[i_].member);\
+    if (count_ > 0)\
+      memcpy((out) + (chunks)[i_].bases, (chunks)[i_].member, sizeof(type) * count_);\
+  }\
+} while (0);
+
+static void directory_of(const char* filepath, char* dir, const size_t size)
+{
+  const char* slash = strrchr(filepath, '/');
+  const char* backslash = strrchr(filepath, '\\');
+  const char* sep = MAX(slash, backslash);
+  const size_t len = sep ? MIN((size_t)(sep - filepath + 1), size - 1) : 0;
+
+  memcpy(dir, filepath, len);
+  dir[len] = '\0';
+}
+
+// Large files are split at line breaks into chunks that are parsed in parallel, each into its own
+// arrays. The merge then offsets relative indices by the element counts of the preceding chunks.
+// The text itself is only mapped, so memory use is bounded by the parsed arrays, not the file.
 void mesh_parse_obj(mesh_t* mesh, const char* filepath)
 {
   if (!mesh || !filepath) return;
 
   mesh_free(mesh);
 
-  FILE* file = fopen(filepath, "r");
-  if (file == NULL) {
-    perror("Error opening file");
+  file_map_t file;
+
+  if (!file_map_open(&file, filepath))
     return;
+
+  const char* begin = file.data;
+  const char* end = file.data + file.size;
+
+  size_t num_chunks = 1;
+
+  if (file.size >= OBJ_PARALLEL_MIN_SIZE)
+    num_chunks = (size_t)MIN(MAX(SDL_GetCPUCount(), 1), OBJ_MAX_THREADS);
+
+  obj_chunk_t chunks[OBJ_MAX_THREADS];
+  memset(chunks, 0, sizeof(chunks));
+
+  const size_t chunk_size = file.size / num_chunks;
+  const char* chunk_begin = begin;
+
+  for (size_t i = 0; i < num_chunks; ++i) {
+    const char* chunk_end = i + 1 == num_chunks ? end : parse_skip_line(begin + chunk_size * (i + 1) - 1, end);
+
+    chunks[i].begin = chunk_begin;
+    chunks[i].end = MAX(chunk_end, chunk_begin);
+    chunk_begin = chunks[i].end;
   }
 
-  char line[256];
-  vec3_t v = { .x = 0.f, .y = 0.f, .z = 0.f };
-  face_t f = { 
-    .a = 0, 
-    .b = 0, 
-    .c = 0, 
-    .color = 0xFF000000, 
-    .tex_coords = { { 0.f, 0.f }, { 0.f, 0.f }, { 0.f, 0.f } }, 
-    .clipped_plane = -1 
-  };
-  
+  run_obj_chunks(chunks, num_chunks, parse_obj_chunk);
+
+  vec3_t* vertices = NULL;
   uv_t* tex_coords = NULL;
+  vec3_t* normals = NULL;
+
+  // faces resolve attributes from anywhere in the file, so those are merged up front
+  MERGE_CHUNK_ARRAYS(chunks, num_chunks, vertices, vec3_t, vertices, vertex_base);
+  MERGE_CHUNK_ARRAYS(chunks, num_chunks, tex_coords, uv_t, tex_coords, tex_coord_base);
+  MERGE_CHUNK_ARRAYS(chunks, num_chunks, normals, vec3_t, normals, normal_base);
+
+  char dir[512];
+  directory_of(filepath, dir, sizeof(dir));
+
+  size_t num_faces = 0;
+  size_t num_lines = 0;
+  size_t num_bad_lines = 0;
+  size_t first_bad_line = 0;
+
+  // a "usemtl" stays active across chunk boundaries, like groups do
+  uint32_t material = MATERIAL_NONE;
+
+  for (size_t i = 0; i < num_chunks; ++i) {
+    obj_chunk_t* chunk = &chunks[i];
+
+    // chunk-local material indices to the mesh's material table
+    const size_t num_materials = darray_size(chunk->materials);
+    uint32_t* material_map = num_materials > 0 ? darray_alloc(NULL, sizeof(uint32_t), num_materials) : NULL;
+
+    for (size_t j = 0; j < num_materials; ++j)
+      material_map[j] = mesh_find_or_add_material(mesh, chunk->materials[j].name);
+
+    for (size_t j = 0; j < darray_size(chunk->material_libs); ++j) {
+      char path[1024];
+      snprintf(path, sizeof(path), "%s%s", dir, chunk->material_libs[j].name);
+      mesh_parse_mtl(mesh, path);
+    }
+
+    const size_t num_groups = darray_size(chunk->groups);
+
+    chunk->material_map = material_map;
+    chunk->inherited_material = material;
+
+    if (chunk->last_material != OBJ_MATERIAL_INHERIT)
+      material = material_map[chunk->last_material];
+
+    chunk->group_starts = num_groups > 0 ? darray_alloc(NULL, sizeof(size_t), num_groups) : NULL;
+
+    // faces index vertices with 32 bits, anything beyond that can't be referenced
+    chunk->num_all_vertices = MIN(darray_size(vertices), (size_t)UINT32_MAX);
+    chunk->num_all_tex_coords = darray_size(tex_coords);
+    chunk->num_all_normals = darray_size(normals);
+    chunk->line_base = num_lines;
+
+    if (chunk->num_bad_lines > 0 && num_bad_lines == 0)
+      first_bad_line = num_lines + chunk->first_bad_line;
+
+    num_faces += darray_size(chunk->faces);
+    num_lines += chunk->num_lines;
+    num_bad_lines += chunk->num_bad_lines;
+  }
+
+  obj_triangle_t* triangles = num_faces > 0 ? darray_alloc(NULL, sizeof(obj_triangle_t), num_faces) : NULL;
+  size_t face_offset = 0;
+
+  for (size_t i = 0; i < num_chunks; ++i) {
+    chunks[i].triangles_out = triangles + face_offset;
+    face_offset += darray_size(chunks[i].faces);
+  }
+
+  run_obj_chunks(chunks, num_chunks, merge_obj_chunk);
+
+  // close the gaps left by faces with invalid indices, and collect the groups
+  size_t num_valid_faces = 0;
+  size_t num_bad_faces = 0;
+  size_t first_bad_face_line = 0;
+
+  for (size_t i = 0; i < num_chunks; ++i) {
+    obj_chunk_t* chunk = &chunks[i];
+
+    if (chunk->num_faces_out > 0 && triangles + num_valid_faces != chunk->triangles_out)
+      memmove(triangles + num_valid_faces, chunk->triangles_out, sizeof(obj_triangle_t) * chunk->num_faces_out);
+
+    for (size_t j = 0; j < darray_size(chunk->groups); ++j) {
+      mesh_group_t group = { .first_face = (uint32_t)(num_valid_faces + chunk->group_starts[j]) };
+      snprintf(group.name, sizeof(group.name), "%s", chunk->groups[j].name);
+      darray_push(mesh->groups, group);
+    }
+
+    if (chunk->num_bad_faces > 0 && num_bad_faces == 0)
+      first_bad_face_line = chunk->first_bad_face_line;
+
+    num_valid_faces += chunk->num_faces_out;
+    num_bad_faces += chunk->num_bad_faces;
+
+    darray_free(chunk->vertices);
+    darray_free(chunk->tex_coords);
+    darray_free(chunk->normals);
+    darray_free(chunk->faces);
+    darray_free(chunk->materials);
+    darray_free(chunk->material_libs);
+    darray_free(chunk->groups);
+    darray_free(chunk->group_starts);
+    darray_free((void*)chunk->material_map);
+  }
+
+  weld_obj_triangles(mesh, triangles, num_valid_faces, vertices, tex_coords, normals);
+
+  // a group ends where the next one starts
+  const size_t num_groups = darray_size(mesh->groups);
 
-  while (fgets(line, sizeof(line), file)) {
-    if (strncmp(line, "v ", 2) == 0) {
-      if (sscanf(line + 2, "%f %f %f", &v.x, &v.y, &v.z) == 3)
-        darray_push(mesh->vertices, v);
+  for (size_t i = 0; i < num_groups; ++i) {
+    const size_t next = i + 1 < num_groups ? mesh->groups[i + 1].first_face : num_valid_faces;
+    mesh->groups[i].num_faces = (uint32_t)(next - mesh->groups[i].first_face);
+  }
+
+  if (num_bad_lines > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu malformed lines, the first at line %zu.\n", 
+      filepath, num_bad_lines, first_bad_line + 1);
+
+  if (num_bad_faces > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu triangles with out of range indices, the first at line %zu.\n", 
+      filepath, num_bad_faces, first_bad_face_line + 1);
+
+  darray_free(triangles);
+  darray_free(vertices);
+  darray_free(tex_coords);
+  darray_free(normals);
+  file_map_close(&file);
+
+  mesh_compute_bounds(mesh);
+}
+
+static uint32_t scan_index(const int32_t idx)
+{
+  return idx == OBJ_INDEX_NONE || idx < 0 ? MESH_SCAN_NONE : (uint32_t)idx;
+}
+
+// a face line's corners are all checked before its first triangle is passed on
+static bool scan_obj_face(const mesh_scan_t* scan, const char* begin, const char* end, const size_t* counts)
+{
+  const char* p = begin;
+  obj_corner_t corner;
+  size_t num_corners = 0;
+
+  // the counts are global, so relative indices resolve to global ones. Like in mesh_parse_obj(),
+  // broken normal indices are tolerated and the normals generated instead
+  while (!line_done(p, end)) {
+    if (!parse_face_corner(&p, end, counts, &corner) || corner.idx[0] < 0 ||
+      (corner.idx[1] != OBJ_INDEX_NONE && corner.idx[1] < 0))
+      return false;
+
+    ++num_corners;
+  }
+
+  if (num_corners < 3) return false;
+
+  uint32_t corners[3][3];
+  p = begin;
+
+  for (size_t i = 0; i < num_corners; ++i) {
+    parse_face_corner(&p, end, counts, &corner);
+
+    // fan around the first corner, corners[1] holds the previous one
+    uint32_t* target = i == 0 ? corners[0] : corners[2];
+
+    for (size_t j = 0; j < 3; ++j)
+      target[j] = scan_index(corner.idx[j]);
+
+    if (i >= 2) {
+      const uint32_t positions[3] = { corners[0][0], corners[1][0], corners[2][0] };
+      const uint32_t tex_coords[3] = { corners[0][1], corners[1][1], corners[2][1] };
+      const uint32_t normals[3] = { corners[0][2], corners[1][2], corners[2][2] };
+
+      scan->triangle(scan->user, positions, tex_coords, normals);
     }
 
-    if (strncmp(line, "vt ", 3) == 0) {
-      uv_t uv;
+    if (i > 0)
+      memcpy(corners[1], corners[2], sizeof(corners[1]));
+  }
+
+  return true;
+}
 
-      if (sscanf(line + 3, "%f %f", &uv.u, &uv.v) == 2) {
+// single threaded, in file order, with nothing kept but the counts
+static bool scan_obj(const char* filepath, const mesh_scan_t* scan)
+{
+  file_map_t file;
+
+  if (!file_map_open(&file, filepath))
+    return false;
+
+  const char* cur = file.data;
+  const char* end = file.data + file.size;
+  size_t counts[3] = { 0, 0, 0 };
+  size_t num_lines = 0;
+  size_t num_bad_lines = 0;
+  size_t first_bad_line = 0;
+
+  while (cur < end) {
+    const char* p = parse_skip_spaces(cur, end);
+    bool valid = true;
+
+    if (is_keyword(p, end, "v", 1)) {
+      p += 2;
+      vec3_t v;
+
+      valid = parse_float(&p, end, &v.x) && parse_float(&p, end, &v.y) && parse_float(&p, end, &v.z);
+
+      if (valid) {
+        scan->position(scan->user, &v);
+        ++counts[0];
+      }
+    }
+
+    else if (is_keyword(p, end, "vt", 2)) {
+      p += 3;
+      uv_t uv = { 0.f, 0.f };
+
+      valid = parse_float(&p, end, &uv.u);
+
+      if (valid) {
+        parse_float(&p, end, &uv.v);
         uv.v = 1.f - uv.v;
-        darray_push(tex_coords, uv);
+        scan->tex_coord(scan->user, &uv);
+        ++counts[1];
       }
     }
 
-    if (strncmp(line, "f ", 2) == 0) {
-      int tex_idx[3];
+    else if (is_keyword(p, end, "vn", 2)) {
+      p += 3;
+      vec3_t n;
+
+      valid = parse_float(&p, end, &n.x) && parse_float(&p, end, &n.y) && parse_float(&p, end, &n.z);
+
+      if (valid) {
+        scan->normal(scan->user, &n);
+        ++counts[2];
+      }
+    }
+
+    else if (is_keyword(p, end, "f", 1)) {
+      valid = scan_obj_face(scan, p + 2, end, counts);
+    }
+
+    if (!valid && num_bad_lines++ == 0)
+      first_bad_line = num_lines;
+
+    cur = parse_skip_line(p, end);
+    ++num_lines;
+  }
+
+  if (num_bad_lines > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu malformed lines, the first at line %zu.\n", 
+      filepath, num_bad_lines, first_bad_line + 1);
+
+  file_map_close(&file);
+
+  return true;
+}
+
+bool mesh_scan(const char* filepath, const mesh_scan_t* scan)
+{
+  if (!filepath || !scan) return false;
+
+  if (file_has_extension(filepath, ".glb"))
+    return false;
+
+  if (file_has_extension(filepath, ".ply"))
+    return mesh_scan_ply(filepath, scan);
+
+  return scan_obj(filepath, scan);
+}
+
+uint32_t mesh_find_or_add_material(mesh_t* mesh, const char* name)
+{
+  const size_t count = darray_size(mesh->materials);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (strcmp(mesh->materials[i].name, name) == 0)
+      return (uint32_t)i;
+  }
+
+  material_t material = { .diffuse = 0xFFFFFFFF, .texture_path = "" };
+  snprintf(material.name, sizeof(material.name), "%s", name);
+  darray_push(mesh->materials, material);
+
+  return (uint32_t)count;
+}
+
+color_t color_from_floats(const float r, const float g, const float b)
+{
+  const color_t cr = (color_t)(MIN(MAX(r, 0.f), 1.f) * 255.f + 0.5f);
+  const color_t cg = (color_t)(MIN(MAX(g, 0.f), 1.f) * 255.f + 0.5f);
+  const color_t cb = (color_t)(MIN(MAX(b, 0.f), 1.f) * 255.f + 0.5f);
+
+  return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
+}
+
+// reads the diffuse color and texture of the materials the mesh already references or defines
+void mesh_parse_mtl(mesh_t* mesh, const char* filepath)
+{
+  if (!mesh || !filepath) return;
+
+  file_map_t file;
+
+  if (!file_map_open(&file, filepath))
+    return;
+
+  const char* cur = file.data;
+  const char* end = file.data + file.size;
+
+  // longer directories can't fit into texture paths anyway
+  char dir[sizeof(mesh->materials->texture_path)];
+  directory_of(filepath, dir, sizeof(dir));
+
+  material_t* material = NULL;
+
+  while (cur < end) {
+    const char* p = parse_skip_spaces(cur, end);
+
+    if (is_keyword(p, end, "newmtl", 6)) {
+      char name[OBJ_NAME_SIZE];
+      parse_name(p + 7, end, name, sizeof(name));
+      material = &mesh->materials[mesh_find_or_add_material(mesh, name)];
+    }
+
+    else if (material && is_keyword(p, end, "Kd", 2)) {
+      float r = 1.f, g = 1.f, b = 1.f;
+      p += 3;
+
+      if (parse_float(&p, end, &r) && parse_float(&p, end, &g) && parse_float(&p, end, &b))
+        material->diffuse = color_from_floats(r, g, b);
+    }
+
+    else if (material && is_keyword(p, end, "map_Kd", 6)) {
+      char name[sizeof(material->texture_path)];
+      parse_name(p + 7, end, name, sizeof(name));
 
-      if (sscanf(line + 2, "%zd/%d/%*zd %zd/%d/%*zd %zd/%d/%*zd", 
-        &f.a, &tex_idx[0], &f.b, &tex_idx[1], &f.c, &tex_idx[2]) == 6) {
-        f.a -= 1;
-        f.b -= 1;
-        f.c -= 1;
+      const int length = snprintf(material->texture_path, sizeof(material->texture_path), "%s%s", dir, name);
 
-        for (size_t i = 0; i < 3; ++i)
-          f.tex_coords[i] = tex_coords[tex_idx[i] - 1];
-        
-        darray_push(mesh->faces, f);
+      // a cut path would load another file or none, the material goes without a texture instead
+      if (length < 0 || (size_t)length >= sizeof(material->texture_path)) {
+        fprintf(stderr, "Texture path of material %s is too long: %s%s\n", material->name, dir, name);
+        material->texture_path[0] = '\0';
       }
     }
+
+    cur = parse_skip_line(p, end);
+  }
+
+  file_map_close(&file);
+}
+
+// maps the mesh cache of filepath if it's up to date, otherwise parses the file and writes the cache
+void mesh_load(mesh_t* mesh, const char* filepath)
+{
+  if (!mesh || !filepath) return;
+
+  // parsed and copied into the arrays on every load, neither cached nor reordered, since the cache
+  // can't hold the embedded texture
+  if (file_has_extension(filepath, ".glb")) {
+    mesh_parse_glb(mesh, filepath);
+
+    if (darray_size(mesh->vertices) >= MESH_QUANTIZE_MIN_VERTICES)
+      mesh_quantize(mesh);
+
+    return;
+  }
+
+  if (mesh_cache_load(mesh, filepath))
+    return;
+
+  if (file_has_extension(filepath, ".ply"))
+    mesh_parse_ply(mesh, filepath);
+  else
+    mesh_parse_obj(mesh, filepath);
+
+  if (!mesh->vertices || !mesh->faces)
+    return;
+
+  // done once before caching, scanned meshes come in arbitrary order
+  const float acmr_before = mesh_acmr(mesh);
+  mesh_optimize_vertex_cache(mesh);
+  printf("%s: ACMR %.3f -> %.3f\n", filepath, acmr_before, mesh_acmr(mesh));
+
+  if (darray_size(mesh->vertices) >= MESH_QUANTIZE_MIN_VERTICES)
+    mesh_quantize(mesh);
+
+  mesh_cache_write(mesh, filepath);
+}
+
+// Area weighted vertex normals for vertices[first_vertex, ...) from faces[first_face, ...). The
+// normals of those vertices are expected to be zero, and the faces to only reference them.
+void mesh_generate_normals(mesh_t* mesh, const size_t first_vertex, const size_t first_face)
+{
+  if (!mesh) return;
+
+  const size_t num_vertices = darray_size(mesh->vertices);
+  const size_t num_faces = darray_size(mesh->faces);
+
+  for (size_t i = first_face; i < num_faces; ++i) {
+    const face_t* face = &mesh->faces[i];
+    const vec3_t ab = vec3_sub(&mesh->vertices[face->b].position, &mesh->vertices[face->a].position);
+    const vec3_t ac = vec3_sub(&mesh->vertices[face->c].position, &mesh->vertices[face->a].position);
+
+    // unnormalized, its length is twice the face's area
+    const vec3_t normal = vec3_cross(&ab, &ac);
+
+    mesh->vertices[face->a].normal = vec3_add(&mesh->vertices[face->a].normal, &normal);
+    mesh->vertices[face->b].normal = vec3_add(&mesh->vertices[face->b].normal, &normal);
+    mesh->vertices[face->c].normal = vec3_add(&mesh->vertices[face->c].normal, &normal);
   }
 
-  fclose(file);
+  for (size_t i = first_vertex; i < num_vertices; ++i) {
+    if (vec3_mag(&mesh->vertices[i].normal) > 0.f)
+      vec3_normalize(&mesh->vertices[i].normal);
+  }
+}
+
+void mesh_compute_bounds(mesh_t* mesh)
+{
+  if (!mesh) return;
+
+  const size_t num_vertices = darray_size(mesh->vertices);
+
+  mesh->bounds_min = num_vertices > 0 ? mesh->vertices[0].position : vec3_null;
+  mesh->bounds_max = mesh->bounds_min;
+
+  for (size_t i = 1; i < num_vertices; ++i) {
+    const vec3_t* v = &mesh->vertices[i].position;
+
+    mesh->bounds_min.x = MIN(mesh->bounds_min.x, v->x);
+    mesh->bounds_min.y = MIN(mesh->bounds_min.y, v->y);
+    mesh->bounds_min.z = MIN(mesh->bounds_min.z, v->z);
+
+    mesh->bounds_max.x = MAX(mesh->bounds_max.x, v->x);
+    mesh->bounds_max.y = MAX(mesh->bounds_max.y, v->y);
+    mesh->bounds_max.z = MAX(mesh->bounds_max.z, v->z);
+  }
 }
 
 void mesh_free(mesh_t* mesh)
 {
   if (!mesh) return;
 
-  darray_clear(mesh->faces);
-  darray_clear(mesh->vertices);
+  // mapped arrays belong to the mapping
+  if (!mesh->mapping.data && !mesh->borrowed) {
+    darray_free(mesh->vertices);
+    darray_free(mesh->packed_vertices);
+    darray_free(mesh->faces);
+    darray_free(mesh->materials);
+    darray_free(mesh->groups);
+  }
+
+  file_map_close(&mesh->mapping);
+  textures_release(mesh->texture);
+
+  mesh->vertices = NULL;
+  mesh->packed_vertices = NULL;
+  mesh->faces = NULL;
+  mesh->materials = NULL;
+  mesh->groups = NULL;
+  mesh->borrowed = false;
+  mesh->texture = TEXTURE_INVALID;
+}
+
+// Unit cube around the origin with one uv square per side, e.g. as a placeholder while loading.
+void mesh_make_cube(mesh_t* mesh)
+{
+  if (!mesh) return;
+
+  mesh_free(mesh);
+
+  const uv_t uvs[4] = { { 0.f, 1.f }, { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f } };
+
+  for (size_t side = 0; side < 6; ++side) {
+    // the side's normal axis and direction, u and v axes follow from it
+    const size_t axis = side / 2;
+    const float sign = side % 2 ? -1.f : 1.f;
+    const uint32_t first = (uint32_t)darray_size(mesh->vertices);
+
+    for (size_t i = 0; i < 4; ++i) {
+      float p[3];
+      float n[3] = { 0.f, 0.f, 0.f };
+
+      p[axis] = sign;
+      p[(axis + 1) % 3] = (i == 2 || i == 3) ? sign : -sign;
+      p[(axis + 2) % 3] = (i == 1 || i == 2) ? 1.f : -1.f;
+      n[axis] = sign;
+
+      const vertex_t vertex = {
+        .position = { p[0], p[1], p[2] },
+        .uv = uvs[i],
+        .normal = { n[0], n[1], n[2] }
+      };
+
+      darray_push(mesh->vertices, vertex);
+    }
+
+    // counter clockwise around the normal, like OBJ faces
+    const face_t faces[2] = {
+      { .a = first, .b = first + 2, .c = first + 1, .color = 0xFFFFFFFF, .material = MATERIAL_NONE },
+      { .a = first, .b = first + 3, .c = first + 2, .color = 0xFFFFFFFF, .material = MATERIAL_NONE }
+    };
+
+    darray_push(mesh->faces, faces[0]);
+    darray_push(mesh->faces, faces[1]);
+  }
+
+  mesh_compute_bounds(mesh);
 }
 
 void mesh_init_transform(mesh_t* mesh) 
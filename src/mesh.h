@@ -2,9 +2,35 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #include "types.h"
 
+#define MESH_SCAN_NONE UINT32_MAX
+
+// Receives the attributes and triangles of a mesh file in file order, for files too large to load.
+// Triangle corners index the positions, uvs and normals received so far, uvs and normals may be
+// MESH_SCAN_NONE. Indices are resolved, but not checked against the counts.
+typedef struct mesh_scan {
+  void* user;
+  void (*position)(void* user, const vec3_t* position);
+  void (*tex_coord)(void* user, const uv_t* uv);
+  void (*normal)(void* user, const vec3_t* normal);
+  void (*triangle)(void* user, const uint32_t* positions, const uint32_t* tex_coords, const uint32_t* normals);
+} mesh_scan_t;
+
+void mesh_load(mesh_t* mesh, const char* filepath);
+
+// reads OBJ and PLY files straight from their mapping, returns false for other formats
+bool mesh_scan(const char* filepath, const mesh_scan_t* scan);
+
 void mesh_parse_obj(mesh_t* mesh, const char* filepath);
+void mesh_parse_mtl(mesh_t* mesh, const char* filepath);
+uint32_t mesh_find_or_add_material(mesh_t* mesh, const char* name);
+color_t color_from_floats(const float r, const float g, const float b);
+void mesh_generate_normals(mesh_t* mesh, const size_t first_vertex, const size_t first_face);
+void mesh_compute_bounds(mesh_t* mesh);
+void mesh_make_cube(mesh_t* mesh);
 void mesh_init_transform(mesh_t* mesh);
 mat4_t mesh_get_transform(const mesh_t* mesh);
 void mesh_apply_transform(mesh_t* mesh);
@@ -0,0 +1,262 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include "darray.h"
+#include "filemap.h"
+#include "mesh.h"
+#include "meshcache.h"
+
+static const char mesh_cache_magic[8] = { 'S', 'R', 'M', 'E', 'S', 'H', 0, 0 };
+
+static void mesh_cache_path(char* buffer, const size_t size, const char* source_path)
+{
+  snprintf(buffer, size, "%s%s", source_path, MESH_CACHE_EXTENSION);
+}
+
+static bool write_padding(FILE* file, const uint64_t offset)
+{
+  static const char zeros[MESH_CACHE_ALIGN] = { 0 };
+  const uint64_t pos = (uint64_t)ftell(file);
+
+  return pos <= offset && fwrite(zeros, 1, (size_t)(offset - pos), file) == offset - pos;
+}
+
+// writes the darray header right in front of offset, followed by the elements
+static bool write_section(FILE* file, const uint64_t offset, const void* data, const size_t element_size, 
+  const size_t count)
+{
+  const uint64_t hdr_size = align_size(sizeof(da_hdr_t), DEFAULT_ALIGN);
+  const da_hdr_t hdr = { .capacity = count, .occupied = count, .element_size = element_size };
+  char hdr_bytes[MESH_CACHE_ALIGN] = { 0 };
+  memcpy(hdr_bytes, &hdr, sizeof(hdr));
+
+  return write_padding(file, offset - hdr_size) &&
+    fwrite(hdr_bytes, 1, (size_t)hdr_size, file) == hdr_size &&
+    (count == 0 || fwrite(data, element_size, count, file) == count);
+}
+
+// the mesh arrays in section order
+static void mesh_sections(const mesh_t* mesh, const void** arrays, size_t* element_sizes)
+{
+  arrays[MESH_CACHE_VERTICES] = mesh->vertices;
+  arrays[MESH_CACHE_FACES] = mesh->faces;
+  arrays[MESH_CACHE_MATERIALS] = mesh->materials;
+  arrays[MESH_CACHE_GROUPS] = mesh->groups;
+  arrays[MESH_CACHE_PACKED_VERTICES] = mesh->packed_vertices;
+
+  element_sizes[MESH_CACHE_VERTICES] = sizeof(vertex_t);
+  element_sizes[MESH_CACHE_FACES] = sizeof(face_t);
+  element_sizes[MESH_CACHE_MATERIALS] = sizeof(material_t);
+  element_sizes[MESH_CACHE_GROUPS] = sizeof(mesh_group_t);
+  element_sizes[MESH_CACHE_PACKED_VERTICES] = sizeof(packed_vertex_t);
+}
+
+uint64_t mesh_cache_layout(const mesh_t* mesh, uint64_t offset, mesh_cache_section_t* sections)
+{
+  const uint64_t hdr_size = align_size(sizeof(da_hdr_t), DEFAULT_ALIGN);
+
+  const void* arrays[MESH_CACHE_SECTION_COUNT];
+  size_t element_sizes[MESH_CACHE_SECTION_COUNT];
+  mesh_sections(mesh, arrays, element_sizes);
+
+  for (int i = 0; i < MESH_CACHE_SECTION_COUNT; ++i) {
+    mesh_cache_section_t* section = &sections[i];
+
+    section->offset = align_size((size_t)(offset + hdr_size), MESH_CACHE_ALIGN);
+    section->count = darray_size((void*)arrays[i]);
+    section->element_size = element_sizes[i];
+
+    offset = section->offset + section->count * section->element_size;
+  }
+
+  return offset;
+}
+
+bool mesh_cache_write_sections(FILE* file, const mesh_t* mesh, const mesh_cache_section_t* sections)
+{
+  const void* arrays[MESH_CACHE_SECTION_COUNT];
+  size_t element_sizes[MESH_CACHE_SECTION_COUNT];
+  mesh_sections(mesh, arrays, element_sizes);
+
+  bool written = true;
+
+  for (int i = 0; i < MESH_CACHE_SECTION_COUNT && written; ++i)
+    written = write_section(file, sections[i].offset, arrays[i], element_sizes[i], (size_t)sections[i].count);
+
+  return written;
+}
+
+bool mesh_cache_write(const mesh_t* mesh, const char* source_path)
+{
+  if (!mesh || !source_path) return false;
+
+  mesh_cache_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  if (!file_stat(source_path, &header.source_size, &header.source_mtime) || 
+    !file_hash(source_path, &header.source_hash))
+    return false;
+
+  const uint64_t hdr_size = align_size(sizeof(da_hdr_t), DEFAULT_ALIGN);
+
+  memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+  header.version = MESH_CACHE_VERSION;
+  header.darray_header_size = (uint32_t)hdr_size;
+  header.bounds_min = mesh->bounds_min;
+  header.bounds_max = mesh->bounds_max;
+  header.quantization = mesh->quantization;
+
+  mesh_cache_layout(mesh, sizeof(header), header.sections);
+
+  char path[1024];
+  mesh_cache_path(path, sizeof(path), source_path);
+
+  FILE* file = fopen(path, "wb");
+
+  if (!file) {
+    perror("Error creating mesh cache");
+    return false;
+  }
+
+  const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    mesh_cache_write_sections(file, mesh, header.sections);
+
+  fclose(file);
+
+  if (!written) {
+    fprintf(stderr, "Error writing mesh cache: %s\n", path);
+    remove(path);
+  }
+
+  return written;
+}
+
+static bool section_valid(const file_map_t* map, const mesh_cache_section_t* section, const size_t element_size, 
+  const uint64_t hdr_size)
+{
+  const uint64_t offset = section->offset;
+  const uint64_t count = section->count;
+
+  if (section->element_size != element_size) return false;
+  if (offset % MESH_CACHE_ALIGN != 0 || offset < hdr_size || offset > map->size) return false;
+  if (count > (map->size - offset) / element_size) return false;
+
+  const da_hdr_t* hdr = (const da_hdr_t*)(map->data + offset - hdr_size);
+
+  return hdr->occupied == count && hdr->capacity == count && hdr->element_size == element_size;
+}
+
+bool mesh_cache_sections_valid(const file_map_t* map, const mesh_cache_section_t* sections)
+{
+  const uint64_t hdr_size = align_size(sizeof(da_hdr_t), DEFAULT_ALIGN);
+
+  const size_t element_sizes[MESH_CACHE_SECTION_COUNT] = {
+    [MESH_CACHE_VERTICES] = sizeof(vertex_t),
+    [MESH_CACHE_FACES] = sizeof(face_t),
+    [MESH_CACHE_MATERIALS] = sizeof(material_t),
+    [MESH_CACHE_GROUPS] = sizeof(mesh_group_t),
+    [MESH_CACHE_PACKED_VERTICES] = sizeof(packed_vertex_t)
+  };
+
+  bool valid = sections[MESH_CACHE_VERTICES].count <= UINT32_MAX &&
+    sections[MESH_CACHE_PACKED_VERTICES].count <= UINT32_MAX;
+
+  for (int i = 0; i < MESH_CACHE_SECTION_COUNT && valid; ++i)
+    valid = section_valid(map, &sections[i], element_sizes[i], hdr_size);
+
+  return valid;
+}
+
+void mesh_cache_map_sections(mesh_t* mesh, const file_map_t* map, const mesh_cache_section_t* sections)
+{
+  void* arrays[MESH_CACHE_SECTION_COUNT];
+
+  for (int i = 0; i < MESH_CACHE_SECTION_COUNT; ++i)
+    arrays[i] = sections[i].count > 0 ? (void*)(map->data + sections[i].offset) : NULL;
+
+  mesh->vertices = (vertex_t*)arrays[MESH_CACHE_VERTICES];
+  mesh->faces = (face_t*)arrays[MESH_CACHE_FACES];
+  mesh->materials = (material_t*)arrays[MESH_CACHE_MATERIALS];
+  mesh->groups = (mesh_group_t*)arrays[MESH_CACHE_GROUPS];
+  mesh->packed_vertices = (packed_vertex_t*)arrays[MESH_CACHE_PACKED_VERTICES];
+}
+
+// the source is unchanged if size and mtime match, or if only the mtime changed but the 
+// content hash still matches (e.g. after a fresh checkout), in which case the stored mtime is updated
+static bool source_unchanged(const char* path, const mesh_cache_header_t* header, const char* source_path)
+{
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  if (!file_stat(source_path, &size, &mtime) || size != header->source_size)
+    return false;
+
+  if (mtime == header->source_mtime)
+    return true;
+
+  uint64_t hash = 0;
+
+  if (!file_hash(source_path, &hash) || hash != header->source_hash)
+    return false;
+
+  FILE* file = fopen(path, "r+b");
+
+  if (file) {
+    mesh_cache_header_t updated = *header;
+    updated.source_mtime = mtime;
+    fwrite(&updated, sizeof(updated), 1, file);
+    fclose(file);
+  }
+
+  return true;
+}
+
+bool mesh_cache_load(mesh_t* mesh, const char* source_path)
+{
+  if (!mesh || !source_path) return false;
+
+  char path[1024];
+  mesh_cache_path(path, sizeof(path), source_path);
+
+  FILE* exists = fopen(path, "rb");
+  if (!exists) return false;
+  fclose(exists);
+
+  // copy on write, since the renderer updates darray sizes in place
+  file_map_t map;
+
+  if (!file_map_open_copy_on_write(&map, path))
+    return false;
+
+  mesh_cache_header_t header;
+  const uint32_t hdr_size = (uint32_t)align_size(sizeof(da_hdr_t), DEFAULT_ALIGN);
+
+  bool valid = map.size >= sizeof(header);
+
+  if (valid) {
+    memcpy(&header, map.data, sizeof(header));
+
+    valid = memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) == 0 &&
+      header.version == MESH_CACHE_VERSION &&
+      header.darray_header_size == hdr_size &&
+      mesh_cache_sections_valid(&map, header.sections) &&
+      source_unchanged(path, &header, source_path);
+  }
+
+  if (!valid) {
+    file_map_close(&map);
+    return false;
+  }
+
+  mesh_free(mesh);
+  mesh_cache_map_sections(mesh, &map, header.sections);
+
+  mesh->bounds_min = header.bounds_min;
+  mesh->bounds_max = header.bounds_max;
+  mesh->quantization = header.quantization;
+  mesh->mapping = map;
+
+  return true;
+}
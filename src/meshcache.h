@@ -0,0 +1,56 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "filemap.h"
+#include "types.h"
+
+// Binary mesh files written next to the source (e.g. assets/cube.obj.meshcache). Every mesh array
+// is stored in its own section with a darray header in front, so a mapped file can be used in place.
+
+#define MESH_CACHE_EXTENSION ".meshcache"
+#define MESH_CACHE_VERSION 7
+#define MESH_CACHE_ALIGN 64
+
+enum mesh_cache_section_type {
+  MESH_CACHE_VERTICES,
+  MESH_CACHE_FACES,
+  MESH_CACHE_MATERIALS,
+  MESH_CACHE_GROUPS,
+  MESH_CACHE_PACKED_VERTICES,
+  MESH_CACHE_SECTION_COUNT
+};
+
+typedef struct mesh_cache_section {
+  uint64_t offset;
+  uint64_t count;
+  uint64_t element_size;
+} mesh_cache_section_t;
+
+typedef struct mesh_cache_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t darray_header_size;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+  vec3_t bounds_min;
+  vec3_t bounds_max;
+  vertex_quantization_t quantization;
+  mesh_cache_section_t sections[MESH_CACHE_SECTION_COUNT];
+} mesh_cache_header_t;
+
+bool mesh_cache_load(mesh_t* mesh, const char* source_path);
+bool mesh_cache_write(const mesh_t* mesh, const char* source_path);
+
+// the section helpers, for other files embedding mesh arrays in the same layout (asset packs)
+
+// lays the sections out from offset on, and returns the end of the last one
+uint64_t mesh_cache_layout(const mesh_t* mesh, uint64_t offset, mesh_cache_section_t* sections);
+bool mesh_cache_write_sections(FILE* file, const mesh_t* mesh, const mesh_cache_section_t* sections);
+bool mesh_cache_sections_valid(const file_map_t* map, const mesh_cache_section_t* sections);
+// points the mesh arrays into map, which has to outlive them
+void mesh_cache_map_sections(mesh_t* mesh, const file_map_t* map, const mesh_cache_section_t* sections);
@@ -0,0 +1,444 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "filemap.h"
+#include "json.h"
+#include "mesh.h"
+#include "meshglb.h"
+#include "texture.h"
+#include "textures.h"
+
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_HEADER_SIZE 8
+#define GLB_MODE_TRIANGLES 4
+
+enum glb_component_type {
+  GLB_BYTE = 5120,
+  GLB_UNSIGNED_BYTE = 5121,
+  GLB_SHORT = 5122,
+  GLB_UNSIGNED_SHORT = 5123,
+  GLB_UNSIGNED_INT = 5125,
+  GLB_FLOAT = 5126
+};
+
+typedef struct glb {
+  json_t json;
+  int32_t root;
+  const uint8_t* bin;
+  size_t bin_size;
+  const char* filepath;
+} glb_t;
+
+// an accessor resolved to a strided range of the BIN chunk
+typedef struct glb_accessor {
+  const uint8_t* data;
+  size_t count;
+  size_t stride;
+  int32_t component_type;
+  size_t num_components;
+  bool normalized;
+} glb_accessor_t;
+
+static size_t component_size(const int32_t type)
+{
+  switch (type) {
+    case GLB_BYTE:
+    case GLB_UNSIGNED_BYTE:
+      return 1;
+    case GLB_SHORT:
+    case GLB_UNSIGNED_SHORT:
+      return 2;
+    case GLB_UNSIGNED_INT:
+    case GLB_FLOAT:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+static size_t num_components_of(const json_t* json, const int32_t type)
+{
+  if (json_equals(json, type, "SCALAR")) return 1;
+  if (json_equals(json, type, "VEC2")) return 2;
+  if (json_equals(json, type, "VEC3")) return 3;
+  if (json_equals(json, type, "VEC4")) return 4;
+
+  return 0;
+}
+
+static uint32_t read_u32(const uint8_t* data)
+{
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+
+  return value;
+}
+
+static bool glb_accessor(const glb_t* glb, const int64_t index, glb_accessor_t* accessor)
+{
+  const json_t* json = &glb->json;
+  const int32_t node = json_at(json, json_find(json, glb->root, "accessors"), (size_t)MAX(index, 0));
+
+  if (index < 0 || node == JSON_NONE)
+    return false;
+
+  // sparse accessors and accessors without a buffer view (all zeros) aren't supported
+  if (json_find(json, node, "sparse") != JSON_NONE)
+    return false;
+
+  const int32_t view = json_at(json, json_find(json, glb->root, "bufferViews"),
+    (size_t)MAX(json_int(json, json_find(json, node, "bufferView"), -1), 0));
+
+  if (json_find(json, node, "bufferView") == JSON_NONE || view == JSON_NONE)
+    return false;
+
+  // only the GLB's own BIN chunk, external buffers would need another mapping
+  if (json_int(json, json_find(json, view, "buffer"), 0) != 0 ||
+    json_find(json, json_at(json, json_find(json, glb->root, "buffers"), 0), "uri") != JSON_NONE)
+    return false;
+
+  accessor->component_type = (int32_t)json_int(json, json_find(json, node, "componentType"), 0);
+  accessor->num_components = num_components_of(json, json_find(json, node, "type"));
+  accessor->count = (size_t)MAX(json_int(json, json_find(json, node, "count"), 0), 0);
+  accessor->normalized = json_bool(json, json_find(json, node, "normalized"), false);
+
+  const size_t element_size = component_size(accessor->component_type) * accessor->num_components;
+  const int64_t view_offset = json_int(json, json_find(json, view, "byteOffset"), 0);
+  const int64_t view_length = json_int(json, json_find(json, view, "byteLength"), 0);
+  const int64_t offset = json_int(json, json_find(json, node, "byteOffset"), 0);
+  const int64_t stride = json_int(json, json_find(json, view, "byteStride"), (int64_t)element_size);
+
+  if (element_size == 0 || view_offset < 0 || view_length < 0 || offset < 0 || stride < (int64_t)element_size ||
+    (uint64_t)view_offset + (uint64_t)view_length > glb->bin_size)
+    return false;
+
+  if (accessor->count > 0 &&
+    (uint64_t)offset + (uint64_t)stride * (accessor->count - 1) + element_size > (uint64_t)view_length)
+    return false;
+
+  accessor->data = glb->bin + view_offset + offset;
+  accessor->stride = (size_t)stride;
+
+  return true;
+}
+
+static float read_component(const uint8_t* data, const int32_t type, const bool normalized)
+{
+  switch (type) {
+    case GLB_FLOAT: {
+      float value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case GLB_BYTE:
+      return normalized ? MAX((float)(int8_t)data[0] / 127.f, -1.f) : (float)(int8_t)data[0];
+    case GLB_UNSIGNED_BYTE:
+      return normalized ? (float)data[0] / 255.f : (float)data[0];
+    case GLB_SHORT: {
+      int16_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? MAX((float)value / 32767.f, -1.f) : (float)value;
+    }
+    case GLB_UNSIGNED_SHORT: {
+      uint16_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? (float)value / 65535.f : (float)value;
+    }
+    case GLB_UNSIGNED_INT:
+      return (float)read_u32(data);
+    default:
+      return 0.f;
+  }
+}
+
+static void read_floats(const glb_accessor_t* accessor, const size_t index, float* out, const size_t num)
+{
+  const uint8_t* element = accessor->data + accessor->stride * index;
+  const size_t size = component_size(accessor->component_type);
+
+  // float data, the common case, is copied as is
+  if (accessor->component_type == GLB_FLOAT) {
+    memcpy(out, element, sizeof(float) * MIN(num, accessor->num_components));
+    return;
+  }
+
+  for (size_t i = 0; i < num && i < accessor->num_components; ++i)
+    out[i] = read_component(element + size * i, accessor->component_type, accessor->normalized);
+}
+
+static uint32_t read_index(const glb_accessor_t* accessor, const size_t index)
+{
+  const uint8_t* element = accessor->data + accessor->stride * index;
+
+  switch (accessor->component_type) {
+    case GLB_UNSIGNED_BYTE:
+      return element[0];
+    case GLB_UNSIGNED_SHORT: {
+      uint16_t value;
+      memcpy(&value, element, sizeof(value));
+      return value;
+    }
+    default:
+      return read_u32(element);
+  }
+}
+
+static void glb_load_image(const glb_t* glb, mesh_t* mesh, material_t* material, const int64_t texture)
+{
+  const json_t* json = &glb->json;
+  const int32_t texture_node = json_at(json, json_find(json, glb->root, "textures"), (size_t)MAX(texture, 0));
+  const int64_t source = json_int(json, json_find(json, texture_node, "source"), -1);
+  const int32_t image = json_at(json, json_find(json, glb->root, "images"), (size_t)MAX(source, 0));
+
+  if (texture < 0 || source < 0 || image == JSON_NONE)
+    return;
+
+  const int32_t uri = json_find(json, image, "uri");
+
+  if (uri != JSON_NONE) {
+    char name[256];
+    json_string(json, uri, name, sizeof(name));
+
+    // data uris would need base64 decoding
+    if (strncmp(name, "data:", 5) == 0)
+      return;
+
+    const char* slash = strrchr(glb->filepath, '/');
+    const char* backslash = strrchr(glb->filepath, '\\');
+    const char* sep = MAX(slash, backslash);
+    const int dir_length = sep ? (int)(sep - glb->filepath + 1) : 0;
+
+    const int length = snprintf(material->texture_path, sizeof(material->texture_path), "%.*s%s", dir_length,
+      glb->filepath, name);
+
+    // a cut path would load another file or none
+    if (length < 0 || (size_t)length >= sizeof(material->texture_path)) {
+      fprintf(stderr, "Texture path of material %s is too long: %.*s%s\n", material->name, dir_length, glb->filepath, name);
+      material->texture_path[0] = '\0';
+    }
+
+    return;
+  }
+
+  // embedded images have no path to load them by per material, the mesh takes the first one, which
+  // is used for faces whose material has no texture path
+  const int32_t view = json_at(json, json_find(json, glb->root, "bufferViews"),
+    (size_t)MAX(json_int(json, json_find(json, image, "bufferView"), -1), 0));
+
+  if (json_find(json, image, "bufferView") == JSON_NONE || view == JSON_NONE || mesh->texture != TEXTURE_INVALID)
+    return;
+
+  const int64_t offset = json_int(json, json_find(json, view, "byteOffset"), 0);
+  const int64_t length = json_int(json, json_find(json, view, "byteLength"), 0);
+
+  if (offset < 0 || length <= 0 || (uint64_t)offset + (uint64_t)length > glb->bin_size)
+    return;
+
+  // registered under the mesh's path, which only an asset pack can load it from again
+  tex2_t decoded = { 0 };
+  load_texture_memory(&decoded, glb->bin + offset, (size_t)length);
+  mesh->texture = textures_adopt(glb->filepath, &decoded, false);
+}
+
+static void glb_parse_materials(const glb_t* glb, mesh_t* mesh)
+{
+  const json_t* json = &glb->json;
+  const int32_t materials = json_find(json, glb->root, "materials");
+  const size_t num_materials = json_count(json, materials);
+
+  for (size_t i = 0; i < num_materials; ++i) {
+    const int32_t node = json_at(json, materials, i);
+    const int32_t pbr = json_find(json, node, "pbrMetallicRoughness");
+    const int32_t factor = json_find(json, pbr, "baseColorFactor");
+
+    material_t material = { .diffuse = 0xFFFFFFFF };
+    json_string(json, json_find(json, node, "name"), material.name, sizeof(material.name));
+
+    if (factor != JSON_NONE)
+      material.diffuse = color_from_floats(json_float(json, json_at(json, factor, 0), 1.f),
+        json_float(json, json_at(json, factor, 1), 1.f), json_float(json, json_at(json, factor, 2), 1.f));
+
+    const int32_t texture = json_find(json, pbr, "baseColorTexture");
+    glb_load_image(glb, mesh, &material, json_int(json, json_find(json, texture, "index"), -1));
+
+    darray_push(mesh->materials, material);
+  }
+}
+
+// adds one primitive's vertices and triangles, returns the number of skipped triangles
+static size_t glb_parse_primitive(const glb_t* glb, mesh_t* mesh, const int32_t primitive)
+{
+  const json_t* json = &glb->json;
+  const int32_t attributes = json_find(json, primitive, "attributes");
+
+  if (json_int(json, json_find(json, primitive, "mode"), GLB_MODE_TRIANGLES) != GLB_MODE_TRIANGLES) {
+    fprintf(stderr, "Warning: %s: skipped a primitive that isn't a triangle list.\n", glb->filepath);
+    return 0;
+  }
+
+  glb_accessor_t positions, tex_coords, normals, indices;
+
+  if (!glb_accessor(glb, json_int(json, json_find(json, attributes, "POSITION"), -1), &positions) ||
+    positions.num_components != 3) {
+    fprintf(stderr, "Warning: %s: skipped a primitive without usable positions.\n", glb->filepath);
+    return 0;
+  }
+
+  const bool has_tex_coords = glb_accessor(glb, json_int(json, json_find(json, attributes, "TEXCOORD_0"), -1),
+    &tex_coords) && tex_coords.num_components == 2 && tex_coords.count >= positions.count;
+  const bool has_normals = glb_accessor(glb, json_int(json, json_find(json, attributes, "NORMAL"), -1),
+    &normals) && normals.num_components == 3 && normals.count >= positions.count;
+  const bool has_indices = glb_accessor(glb, json_int(json, json_find(json, primitive, "indices"), -1),
+    &indices) && indices.num_components == 1 && indices.component_type != GLB_FLOAT;
+
+  if (json_find(json, primitive, "indices") != JSON_NONE && !has_indices) {
+    fprintf(stderr, "Warning: %s: skipped a primitive with unusable indices.\n", glb->filepath);
+    return 0;
+  }
+
+  const size_t vertex_base = darray_size(mesh->vertices);
+  const size_t num_vertices = positions.count;
+
+  if (vertex_base + num_vertices > UINT32_MAX)
+    return 0;
+
+  if (num_vertices > 0)
+    mesh->vertices = darray_alloc(mesh->vertices, sizeof(vertex_t), num_vertices);
+
+  for (size_t i = 0; i < num_vertices; ++i) {
+    vertex_t* vertex = &mesh->vertices[vertex_base + i];
+    *vertex = (vertex_t) { 0 };
+
+    read_floats(&positions, i, &vertex->position.x, 3);
+
+    // glTF uvs already have their origin at the top left
+    if (has_tex_coords)
+      read_floats(&tex_coords, i, &vertex->uv.u, 2);
+
+    if (has_normals)
+      read_floats(&normals, i, &vertex->normal.x, 3);
+  }
+
+  const int64_t material_index = json_int(json, json_find(json, primitive, "material"), -1);
+  const uint32_t material = material_index >= 0 && (size_t)material_index < darray_size(mesh->materials) ?
+    (uint32_t)material_index : MATERIAL_NONE;
+
+  const size_t num_indices = has_indices ? indices.count : num_vertices;
+  const size_t face_base = darray_size(mesh->faces);
+  size_t num_faces = 0;
+  size_t num_bad_faces = 0;
+
+  if (num_indices >= 3)
+    mesh->faces = darray_alloc(mesh->faces, sizeof(face_t), num_indices / 3);
+
+  for (size_t i = 0; i + 2 < num_indices; i += 3) {
+    uint32_t corners[3];
+
+    for (size_t j = 0; j < 3; ++j)
+      corners[j] = has_indices ? read_index(&indices, i + j) : (uint32_t)(i + j);
+
+    if (corners[0] >= num_vertices || corners[1] >= num_vertices || corners[2] >= num_vertices) {
+      ++num_bad_faces;
+      continue;
+    }
+
+    mesh->faces[face_base + num_faces++] = (face_t) {
+      .a = (uint32_t)vertex_base + corners[0],
+      .b = (uint32_t)vertex_base + corners[1],
+      .c = (uint32_t)vertex_base + corners[2],
+      .color = 0xFF000000,
+      .material = material
+    };
+  }
+
+  if (num_indices >= 3)
+    darray_reset_size(mesh->faces, face_base + num_faces);
+
+  // normals are optional in glTF, flat shading is expected then, but smooth ones are closer to the OBJ path
+  if (!has_normals)
+    mesh_generate_normals(mesh, vertex_base, face_base);
+
+  return num_bad_faces;
+}
+
+// Every mesh of the file becomes a group, node transforms and scenes are ignored.
+void mesh_parse_glb(mesh_t* mesh, const char* filepath)
+{
+  if (!mesh || !filepath) return;
+
+  mesh_free(mesh);
+
+  file_map_t file;
+
+  if (!file_map_open(&file, filepath))
+    return;
+
+  const uint8_t* data = (const uint8_t*)file.data;
+
+  // the chunk sizes below are checked against the length in the header, which has to cover them
+  if (file.size < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE || read_u32(data) != GLB_MAGIC ||
+    read_u32(data + 4) != GLB_VERSION || read_u32(data + 8) > file.size ||
+    read_u32(data + 8) < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE) {
+    fprintf(stderr, "Error: %s is not a binary glTF 2.0 file.\n", filepath);
+    file_map_close(&file);
+    return;
+  }
+
+  const size_t size = read_u32(data + 8);
+  const size_t json_size = read_u32(data + GLB_HEADER_SIZE);
+  const size_t json_offset = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE;
+
+  if (read_u32(data + GLB_HEADER_SIZE + 4) != GLB_CHUNK_JSON || json_size > size - json_offset) {
+    fprintf(stderr, "Error: %s has no JSON chunk.\n", filepath);
+    file_map_close(&file);
+    return;
+  }
+
+  glb_t glb = { .root = 0, .filepath = filepath };
+
+  // chunks are 4 byte aligned, the BIN chunk is optional
+  const size_t bin_header = json_offset + ((json_size + 3) & ~(size_t)3);
+
+  if (bin_header + GLB_CHUNK_HEADER_SIZE <= size && read_u32(data + bin_header + 4) == GLB_CHUNK_BIN) {
+    glb.bin = data + bin_header + GLB_CHUNK_HEADER_SIZE;
+    glb.bin_size = MIN((size_t)read_u32(data + bin_header), size - bin_header - GLB_CHUNK_HEADER_SIZE);
+  }
+
+  if (!json_parse(&glb.json, (const char*)data + json_offset, json_size)) {
+    fprintf(stderr, "Error: %s has an invalid JSON chunk.\n", filepath);
+    file_map_close(&file);
+    return;
+  }
+
+  glb_parse_materials(&glb, mesh);
+
+  const int32_t meshes = json_find(&glb.json, glb.root, "meshes");
+  const size_t num_meshes = json_count(&glb.json, meshes);
+  size_t num_bad_faces = 0;
+
+  for (size_t i = 0; i < num_meshes; ++i) {
+    const int32_t node = json_at(&glb.json, meshes, i);
+    const int32_t primitives = json_find(&glb.json, node, "primitives");
+
+    mesh_group_t group = { .first_face = (uint32_t)darray_size(mesh->faces) };
+    json_string(&glb.json, json_find(&glb.json, node, "name"), group.name, sizeof(group.name));
+
+    for (size_t j = 0; j < json_count(&glb.json, primitives); ++j)
+      num_bad_faces += glb_parse_primitive(&glb, mesh, json_at(&glb.json, primitives, j));
+
+    group.num_faces = (uint32_t)(darray_size(mesh->faces) - group.first_face);
+    darray_push(mesh->groups, group);
+  }
+
+  if (num_bad_faces > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu triangles with out of range indices.\n", filepath, num_bad_faces);
+
+  json_free(&glb.json);
+  file_map_close(&file);
+
+  mesh_compute_bounds(mesh);
+}
@@ -0,0 +1,17 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Binary glTF 2.0: a 12 byte header followed by a JSON chunk and a BIN chunk. Accessor data is
+// read straight from the mapped BIN chunk, only the layout of vertex_t and face_t is written.
+
+#define GLB_MAGIC 0x46546C67u
+#define GLB_VERSION 2
+#define GLB_CHUNK_JSON 0x4E4F534Au
+#define GLB_CHUNK_BIN 0x004E4942u
+
+void mesh_parse_glb(mesh_t* mesh, const char* filepath);
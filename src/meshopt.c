@@ -0,0 +1,299 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "meshopt.h"
+
+#define OPT_NONE UINT32_MAX
+
+// Forsyth's scoring: recently used vertices score high, the three most recent a bit less so the
+// next triangle doesn't just reuse the last edge, and vertices with few remaining triangles get
+// a boost so they are finished off instead of leaving isolated triangles behind.
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRIANGLE_SCORE 0.75f
+#define VALENCE_BOOST_SCALE 2.f
+#define VALENCE_BOOST_POWER 0.5f
+
+typedef struct opt_vertex {
+  float score;
+  int32_t cache_pos;
+  uint32_t valence;
+  uint32_t num_active;
+  uint32_t adjacency_offset;
+} opt_vertex_t;
+
+float mesh_acmr(const mesh_t* mesh)
+{
+  if (!mesh) return 0.f;
+
+  const size_t num_faces = darray_size(mesh->faces);
+  const size_t num_vertices = darray_size(mesh->vertices);
+
+  if (num_faces == 0) return 0.f;
+
+  // a vertex is cached if fewer than VERTEX_CACHE_SIZE misses happened since it was loaded
+  int64_t* loaded_at = malloc(sizeof(int64_t) * num_vertices);
+  if (!loaded_at) exit(EXIT_FAILURE);
+
+  for (size_t i = 0; i < num_vertices; ++i)
+    loaded_at[i] = -(int64_t)VERTEX_CACHE_SIZE - 1;
+
+  int64_t num_misses = 0;
+
+  for (size_t i = 0; i < num_faces; ++i) {
+    const uint32_t indices[3] = { mesh->faces[i].a, mesh->faces[i].b, mesh->faces[i].c };
+
+    for (size_t j = 0; j < 3; ++j) {
+      if (num_misses - loaded_at[indices[j]] > VERTEX_CACHE_SIZE)
+        loaded_at[indices[j]] = num_misses++;
+    }
+  }
+
+  free(loaded_at);
+
+  return (float)num_misses / (float)num_faces;
+}
+
+static float vertex_score(const opt_vertex_t* vertex)
+{
+  if (vertex->num_active == 0)
+    return -1.f;
+
+  float score = 0.f;
+
+  if (vertex->cache_pos >= 0) {
+    if (vertex->cache_pos < 3) {
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      const float scale = 1.f / (VERTEX_CACHE_SIZE - 3);
+      score = powf(1.f - (float)(vertex->cache_pos - 3) * scale, CACHE_DECAY_POWER);
+    }
+  }
+
+  return score + VALENCE_BOOST_SCALE * powf((float)vertex->num_active, -VALENCE_BOOST_POWER);
+}
+
+// Greedy Forsyth ordering of faces[first, last). All vertex state is initialized from the
+// range's own faces, so the cost is linear in the range and independent of the mesh size.
+static void optimize_face_range(face_t* faces, const size_t first, const size_t last, opt_vertex_t* vertices,
+  uint32_t* adjacency, float* tri_scores, bool* tri_added, face_t* out)
+{
+  const size_t num_tris = last - first;
+  const face_t* tris = faces + first;
+
+  // valences, with cache_pos -2 marking vertices without an adjacency offset yet
+  for (size_t i = 0; i < num_tris; ++i) {
+    const uint32_t indices[3] = { tris[i].a, tris[i].b, tris[i].c };
+
+    for (size_t j = 0; j < 3; ++j)
+      vertices[indices[j]] = (opt_vertex_t) { .cache_pos = -2 };
+  }
+
+  for (size_t i = 0; i < num_tris; ++i) {
+    vertices[tris[i].a].valence++;
+    vertices[tris[i].b].valence++;
+    vertices[tris[i].c].valence++;
+  }
+
+  uint32_t offset = 0;
+
+  for (size_t i = 0; i < num_tris; ++i) {
+    const uint32_t indices[3] = { tris[i].a, tris[i].b, tris[i].c };
+
+    for (size_t j = 0; j < 3; ++j) {
+      opt_vertex_t* vertex = &vertices[indices[j]];
+
+      if (vertex->cache_pos == -2) {
+        vertex->cache_pos = -1;
+        vertex->adjacency_offset = offset;
+        offset += vertex->valence;
+      }
+
+      adjacency[vertex->adjacency_offset + vertex->num_active++] = (uint32_t)i;
+    }
+  }
+
+  for (size_t i = 0; i < num_tris; ++i) {
+    const uint32_t indices[3] = { tris[i].a, tris[i].b, tris[i].c };
+
+    for (size_t j = 0; j < 3; ++j)
+      vertices[indices[j]].score = vertex_score(&vertices[indices[j]]);
+  }
+
+  uint32_t best = OPT_NONE;
+  float best_score = -1.f;
+
+  for (size_t i = 0; i < num_tris; ++i) {
+    tri_added[i] = false;
+    tri_scores[i] = vertices[tris[i].a].score + vertices[tris[i].b].score + vertices[tris[i].c].score;
+
+    if (tri_scores[i] > best_score) {
+      best_score = tri_scores[i];
+      best = (uint32_t)i;
+    }
+  }
+
+  uint32_t cache[VERTEX_CACHE_SIZE + 3];
+  uint32_t new_cache[VERTEX_CACHE_SIZE + 3];
+  size_t cache_size = 0;
+  size_t next_unadded = 0;
+
+  for (size_t num_out = 0; num_out < num_tris; ++num_out) {
+    // nothing in the cache has triangles left, so continue with the first remaining one
+    if (best == OPT_NONE) {
+      while (tri_added[next_unadded])
+        ++next_unadded;
+
+      best = (uint32_t)next_unadded;
+    }
+
+    const face_t* tri = &tris[best];
+    const uint32_t indices[3] = { tri->a, tri->b, tri->c };
+
+    out[num_out] = *tri;
+    tri_added[best] = true;
+
+    for (size_t j = 0; j < 3; ++j) {
+      opt_vertex_t* vertex = &vertices[indices[j]];
+      uint32_t* adjacent = adjacency + vertex->adjacency_offset;
+
+      for (uint32_t k = 0; k < vertex->num_active; ++k) {
+        if (adjacent[k] == best) {
+          adjacent[k] = adjacent[--vertex->num_active];
+          break;
+        }
+      }
+
+      new_cache[j] = indices[j];
+    }
+
+    size_t new_cache_size = 3;
+
+    for (size_t j = 0; j < cache_size; ++j) {
+      if (cache[j] != indices[0] && cache[j] != indices[1] && cache[j] != indices[2])
+        new_cache[new_cache_size++] = cache[j];
+    }
+
+    // entries pushed past the cache size are evicted, but their scores still change
+    for (size_t j = 0; j < new_cache_size; ++j) {
+      opt_vertex_t* vertex = &vertices[new_cache[j]];
+
+      vertex->cache_pos = j < VERTEX_CACHE_SIZE ? (int32_t)j : -1;
+      vertex->score = vertex_score(vertex);
+    }
+
+    best = OPT_NONE;
+    best_score = -1.f;
+
+    for (size_t j = 0; j < new_cache_size; ++j) {
+      const opt_vertex_t* vertex = &vertices[new_cache[j]];
+      const uint32_t* adjacent = adjacency + vertex->adjacency_offset;
+
+      for (uint32_t k = 0; k < vertex->num_active; ++k) {
+        const face_t* candidate = &tris[adjacent[k]];
+        const float score = vertices[candidate->a].score + vertices[candidate->b].score + vertices[candidate->c].score;
+
+        tri_scores[adjacent[k]] = score;
+
+        if (score > best_score) {
+          best_score = score;
+          best = adjacent[k];
+        }
+      }
+    }
+
+    cache_size = MIN(new_cache_size, (size_t)VERTEX_CACHE_SIZE);
+    memcpy(cache, new_cache, sizeof(uint32_t) * cache_size);
+  }
+
+  memcpy(faces + first, out, sizeof(face_t) * num_tris);
+}
+
+// renumbers the vertices in order of first use, unreferenced ones go last
+static void reorder_vertices(mesh_t* mesh)
+{
+  const size_t num_faces = darray_size(mesh->faces);
+  const size_t num_vertices = darray_size(mesh->vertices);
+
+  uint32_t* remap = malloc(sizeof(uint32_t) * num_vertices);
+  if (!remap) exit(EXIT_FAILURE);
+
+  for (size_t i = 0; i < num_vertices; ++i)
+    remap[i] = OPT_NONE;
+
+  uint32_t next = 0;
+
+  for (size_t i = 0; i < num_faces; ++i) {
+    uint32_t* indices[3] = { &mesh->faces[i].a, &mesh->faces[i].b, &mesh->faces[i].c };
+
+    for (size_t j = 0; j < 3; ++j) {
+      if (remap[*indices[j]] == OPT_NONE)
+        remap[*indices[j]] = next++;
+
+      *indices[j] = remap[*indices[j]];
+    }
+  }
+
+  vertex_t* vertices = darray_alloc(NULL, sizeof(vertex_t), num_vertices);
+
+  for (size_t i = 0; i < num_vertices; ++i) {
+    if (remap[i] == OPT_NONE)
+      remap[i] = next++;
+
+    vertices[remap[i]] = mesh->vertices[i];
+  }
+
+  darray_free(mesh->vertices);
+  mesh->vertices = vertices;
+
+  free(remap);
+}
+
+void mesh_optimize_vertex_cache(mesh_t* mesh)
+{
+  // mapped arrays belong to the mapping
+  if (!mesh || mesh->mapping.data || mesh->borrowed) return;
+
+  const size_t num_faces = darray_size(mesh->faces);
+  const size_t num_vertices = darray_size(mesh->vertices);
+
+  if (num_faces == 0 || num_vertices == 0) return;
+
+  opt_vertex_t* vertices = malloc(sizeof(opt_vertex_t) * num_vertices);
+  uint32_t* adjacency = malloc(sizeof(uint32_t) * num_faces * 3);
+  float* tri_scores = malloc(sizeof(float) * num_faces);
+  bool* tri_added = malloc(sizeof(bool) * num_faces);
+  face_t* out = malloc(sizeof(face_t) * num_faces);
+
+  if (!vertices || !adjacency || !tri_scores || !tri_added || !out) exit(EXIT_FAILURE);
+
+  // faces only move within their group and their run of one material, so group ranges stay valid
+  // and the renderer finds the faces grouped by material
+  size_t first = 0;
+  size_t next_group = 0;
+
+  for (size_t i = 1; i <= num_faces; ++i) {
+    while (next_group < darray_size(mesh->groups) && mesh->groups[next_group].first_face < i)
+      ++next_group;
+
+    const bool group_starts = next_group < darray_size(mesh->groups) && mesh->groups[next_group].first_face == i;
+
+    if (i < num_faces && !group_starts && mesh->faces[i].material == mesh->faces[i - 1].material)
+      continue;
+
+    optimize_face_range(mesh->faces, first, i, vertices, adjacency, tri_scores, tri_added, out);
+    first = i;
+  }
+
+  free(vertices);
+  free(adjacency);
+  free(tri_scores);
+  free(tri_added);
+  free(out);
+
+  reorder_vertices(mesh);
+}
@@ -0,0 +1,12 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include "types.h"
+
+// Average cache miss ratio: transformed vertices per triangle with a FIFO post-transform
+// cache of VERTEX_CACHE_SIZE entries. 3 is the worst case, about 0.6 the optimum for grids.
+float mesh_acmr(const mesh_t* mesh);
+
+// Reorders the faces of every group for vertex cache reuse, then the vertices by first use.
+void mesh_optimize_vertex_cache(mesh_t* mesh);
@@ -0,0 +1,635 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "filemap.h"
+#include "mesh.h"
+#include "meshply.h"
+#include "parse.h"
+
+#define PLY_MAX_ELEMENTS 8
+#define PLY_MAX_PROPERTIES 32
+#define PLY_MAX_NAME 32
+
+typedef enum ply_type {
+  PLY_NONE,
+  PLY_INT8,
+  PLY_UINT8,
+  PLY_INT16,
+  PLY_UINT16,
+  PLY_INT32,
+  PLY_UINT32,
+  PLY_FLOAT32,
+  PLY_FLOAT64
+} ply_type_t;
+
+typedef struct ply_property {
+  char name[PLY_MAX_NAME];
+  ply_type_t type;
+  // element type of a list, whose count has type
+  ply_type_t list_type;
+  size_t offset;
+} ply_property_t;
+
+typedef struct ply_element {
+  char name[PLY_MAX_NAME];
+  uint64_t count;
+  ply_property_t properties[PLY_MAX_PROPERTIES];
+  size_t num_properties;
+  // record size, 0 if the element has lists and records have to be walked
+  size_t stride;
+} ply_element_t;
+
+typedef struct ply_header {
+  ply_element_t elements[PLY_MAX_ELEMENTS];
+  size_t num_elements;
+  const char* body;
+} ply_header_t;
+
+static size_t ply_type_size(const ply_type_t type)
+{
+  static const size_t sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+  return sizes[type];
+}
+
+static ply_type_t ply_type_of(const char* name)
+{
+  static const char* names[][2] = {
+    { "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+    { "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" }
+  };
+
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    if (strcmp(name, names[i][0]) == 0 || strcmp(name, names[i][1]) == 0)
+      return (ply_type_t)(i + 1);
+  }
+
+  return PLY_NONE;
+}
+
+// copies the next space separated word of the line into buffer
+static bool ply_word(const char** cur, const char* end, char* buffer, const size_t size)
+{
+  const char* p = parse_skip_spaces(*cur, end);
+  size_t length = 0;
+
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+    if (length + 1 < size)
+      buffer[length++] = *p;
+
+    ++p;
+  }
+
+  buffer[length] = '\0';
+  *cur = p;
+
+  return length > 0;
+}
+
+static bool ply_parse_header(const char* data, const char* end, ply_header_t* header, const char* filepath)
+{
+  memset(header, 0, sizeof(*header));
+
+  if (end - data < 4 || memcmp(data, "ply", 3) != 0 || (data[3] != '\n' && data[3] != '\r')) {
+    fprintf(stderr, "Error: %s is not a PLY file.\n", filepath);
+    return false;
+  }
+
+  const char* line = parse_skip_line(data, end);
+  ply_element_t* element = NULL;
+
+  while (line < end) {
+    const char* cur = line;
+    const char* next = parse_skip_line(line, end);
+    char word[PLY_MAX_NAME];
+
+    line = next;
+
+    if (!ply_word(&cur, next, word, sizeof(word)))
+      continue;
+
+    if (strcmp(word, "end_header") == 0) {
+      header->body = next;
+      return true;
+    }
+
+    if (strcmp(word, "format") == 0) {
+      ply_word(&cur, next, word, sizeof(word));
+
+      if (strcmp(word, "binary_little_endian") != 0) {
+        fprintf(stderr, "Error: %s: PLY format %s is not supported, only binary_little_endian.\n", filepath, word);
+        return false;
+      }
+    } else if (strcmp(word, "element") == 0) {
+      if (header->num_elements == PLY_MAX_ELEMENTS) {
+        fprintf(stderr, "Error: %s has more than %d PLY elements.\n", filepath, PLY_MAX_ELEMENTS);
+        return false;
+      }
+
+      element = &header->elements[header->num_elements++];
+      ply_word(&cur, next, element->name, sizeof(element->name));
+
+      int64_t count = 0;
+
+      if (!parse_int(&cur, next, &count) || count < 0) {
+        fprintf(stderr, "Error: %s: PLY element %s has no valid count.\n", filepath, element->name);
+        return false;
+      }
+
+      element->count = (uint64_t)count;
+    } else if (strcmp(word, "property") == 0) {
+      if (!element || element->num_properties == PLY_MAX_PROPERTIES) {
+        fprintf(stderr, "Error: %s: unexpected PLY property.\n", filepath);
+        return false;
+      }
+
+      ply_property_t* property = &element->properties[element->num_properties++];
+      ply_word(&cur, next, word, sizeof(word));
+
+      if (strcmp(word, "list") == 0) {
+        ply_word(&cur, next, word, sizeof(word));
+        property->type = ply_type_of(word);
+        ply_word(&cur, next, word, sizeof(word));
+        property->list_type = ply_type_of(word);
+
+        if (property->list_type == PLY_NONE) {
+          fprintf(stderr, "Error: %s: unknown PLY type %s.\n", filepath, word);
+          return false;
+        }
+      } else {
+        property->type = ply_type_of(word);
+      }
+
+      if (property->type == PLY_NONE) {
+        fprintf(stderr, "Error: %s: unknown PLY type %s.\n", filepath, word);
+        return false;
+      }
+
+      ply_word(&cur, next, property->name, sizeof(property->name));
+    }
+
+    // comments and obj_info are ignored
+  }
+
+  fprintf(stderr, "Error: %s: PLY header has no end_header.\n", filepath);
+  return false;
+}
+
+// offsets of the properties in a record, valid up to the first list
+static void ply_compute_layout(ply_element_t* element)
+{
+  size_t offset = 0;
+
+  for (size_t i = 0; i < element->num_properties; ++i) {
+    ply_property_t* property = &element->properties[i];
+    property->offset = offset;
+
+    if (property->list_type != PLY_NONE) {
+      element->stride = 0;
+      return;
+    }
+
+    offset += ply_type_size(property->type);
+  }
+
+  element->stride = offset;
+}
+
+static const ply_property_t* ply_find_property(const ply_element_t* element, const char* name)
+{
+  for (size_t i = 0; i < element->num_properties; ++i) {
+    if (strcmp(element->properties[i].name, name) == 0)
+      return &element->properties[i];
+  }
+
+  return NULL;
+}
+
+static double ply_read(const char* data, const ply_type_t type)
+{
+  switch (type) {
+    case PLY_INT8: return (double)*(const int8_t*)data;
+    case PLY_UINT8: return (double)*(const uint8_t*)data;
+    case PLY_INT16: { int16_t v; memcpy(&v, data, sizeof(v)); return (double)v; }
+    case PLY_UINT16: { uint16_t v; memcpy(&v, data, sizeof(v)); return (double)v; }
+    case PLY_INT32: { int32_t v; memcpy(&v, data, sizeof(v)); return (double)v; }
+    case PLY_UINT32: { uint32_t v; memcpy(&v, data, sizeof(v)); return (double)v; }
+    case PLY_FLOAT32: { float v; memcpy(&v, data, sizeof(v)); return (double)v; }
+    case PLY_FLOAT64: { double v; memcpy(&v, data, sizeof(v)); return v; }
+    default: return 0.0;
+  }
+}
+
+static int64_t ply_read_int(const char* data, const ply_type_t type)
+{
+  switch (type) {
+    case PLY_INT8: return *(const int8_t*)data;
+    case PLY_UINT8: return *(const uint8_t*)data;
+    case PLY_INT16: { int16_t v; memcpy(&v, data, sizeof(v)); return v; }
+    case PLY_UINT16: { uint16_t v; memcpy(&v, data, sizeof(v)); return v; }
+    case PLY_INT32: { int32_t v; memcpy(&v, data, sizeof(v)); return v; }
+    case PLY_UINT32: { uint32_t v; memcpy(&v, data, sizeof(v)); return v; }
+    default: return (int64_t)ply_read(data, type);
+  }
+}
+
+// skips one record of an element with lists, returns NULL if it runs past end
+static const char* ply_skip_record(const ply_element_t* element, const char* cur, const char* end)
+{
+  for (size_t i = 0; i < element->num_properties; ++i) {
+    const ply_property_t* property = &element->properties[i];
+    const size_t size = ply_type_size(property->type);
+
+    if ((size_t)(end - cur) < size)
+      return NULL;
+
+    if (property->list_type == PLY_NONE) {
+      cur += size;
+      continue;
+    }
+
+    const int64_t count = ply_read_int(cur, property->type);
+    const size_t list_size = ply_type_size(property->list_type) * (size_t)MAX(count, 0);
+
+    cur += size;
+
+    if ((size_t)(end - cur) < list_size)
+      return NULL;
+
+    cur += list_size;
+  }
+
+  return cur;
+}
+
+// three consecutive float32 properties can be copied as a vec3_t
+static bool ply_is_float3(const ply_property_t* x, const ply_property_t* y, const ply_property_t* z)
+{
+  return x && y && z && x->type == PLY_FLOAT32 && y->type == PLY_FLOAT32 && z->type == PLY_FLOAT32 &&
+    y->offset == x->offset + 4 && z->offset == x->offset + 8;
+}
+
+static void ply_read_vec3(const char* record, const ply_property_t* x, const ply_property_t* y,
+  const ply_property_t* z, const bool float3, vec3_t* out)
+{
+  if (float3) {
+    memcpy(out, record + x->offset, sizeof(vec3_t));
+    return;
+  }
+
+  out->x = (float)ply_read(record + x->offset, x->type);
+  out->y = (float)ply_read(record + y->offset, y->type);
+  out->z = (float)ply_read(record + z->offset, z->type);
+}
+
+// the vertex properties that are read, found once per element
+typedef struct ply_vertex_layout {
+  const ply_property_t* position[3];
+  const ply_property_t* normal[3];
+  const ply_property_t* u;
+  const ply_property_t* v;
+  bool float3_position;
+  bool float3_normal;
+  bool has_normals;
+  bool has_uvs;
+} ply_vertex_layout_t;
+
+static bool ply_find_vertex_layout(const ply_element_t* element, const char* cur, const char* end,
+  ply_vertex_layout_t* layout, const char* filepath)
+{
+  const char* position_names[] = { "x", "y", "z" };
+  const char* normal_names[] = { "nx", "ny", "nz" };
+
+  for (size_t i = 0; i < 3; ++i) {
+    layout->position[i] = ply_find_property(element, position_names[i]);
+    layout->normal[i] = ply_find_property(element, normal_names[i]);
+  }
+
+  // uv properties go by several names
+  const char* u_names[] = { "u", "s", "texture_u", "texture_s" };
+  const char* v_names[] = { "v", "t", "texture_v", "texture_t" };
+  layout->u = NULL;
+  layout->v = NULL;
+
+  for (size_t i = 0; i < 4 && !(layout->u && layout->v); ++i) {
+    layout->u = ply_find_property(element, u_names[i]);
+    layout->v = ply_find_property(element, v_names[i]);
+  }
+
+  if (element->stride == 0 || !layout->position[0] || !layout->position[1] || !layout->position[2]) {
+    fprintf(stderr, "Error: %s: PLY vertices need fixed size records with x, y and z.\n", filepath);
+    return false;
+  }
+
+  if (element->count > UINT32_MAX || element->count > (uint64_t)(end - cur) / element->stride) {
+    fprintf(stderr, "Error: %s: PLY vertex data is truncated or too large.\n", filepath);
+    return false;
+  }
+
+  layout->float3_position = ply_is_float3(layout->position[0], layout->position[1], layout->position[2]);
+  layout->float3_normal = ply_is_float3(layout->normal[0], layout->normal[1], layout->normal[2]);
+  layout->has_normals = layout->normal[0] && layout->normal[1] && layout->normal[2];
+  layout->has_uvs = layout->u && layout->v;
+
+  return true;
+}
+
+static void ply_read_vertex(const char* record, const ply_vertex_layout_t* layout, vertex_t* vertex)
+{
+  *vertex = (vertex_t) { 0 };
+  ply_read_vec3(record, layout->position[0], layout->position[1], layout->position[2], layout->float3_position,
+    &vertex->position);
+
+  if (layout->has_normals)
+    ply_read_vec3(record, layout->normal[0], layout->normal[1], layout->normal[2], layout->float3_normal,
+      &vertex->normal);
+
+  // flipped like OBJ's, both have their origin at the bottom left
+  if (layout->has_uvs) {
+    vertex->uv.u = (float)ply_read(record + layout->u->offset, layout->u->type);
+    vertex->uv.v = 1.f - (float)ply_read(record + layout->v->offset, layout->v->type);
+  }
+}
+
+static const char* ply_read_vertices(mesh_t* mesh, const ply_element_t* element, const char* cur, const char* end,
+  bool* has_normals, const char* filepath)
+{
+  ply_vertex_layout_t layout;
+
+  if (!ply_find_vertex_layout(element, cur, end, &layout, filepath))
+    return NULL;
+
+  const size_t num_vertices = (size_t)element->count;
+  *has_normals = layout.has_normals;
+
+  if (num_vertices == 0)
+    return cur;
+
+  mesh->vertices = darray_alloc(mesh->vertices, sizeof(vertex_t), num_vertices);
+
+  for (size_t i = 0; i < num_vertices; ++i)
+    ply_read_vertex(cur + element->stride * i, &layout, &mesh->vertices[i]);
+
+  return cur + element->stride * num_vertices;
+}
+
+// receives the triangles of ply_read_faces(), with indices below the vertex count. reserve, if set,
+// is told the most triangles to expect first
+typedef struct ply_face_sink {
+  void* user;
+  void (*reserve)(void* user, const size_t count);
+  void (*triangle)(void* user, const uint32_t a, const uint32_t b, const uint32_t c);
+} ply_face_sink_t;
+
+static const char* ply_read_faces(const ply_element_t* element, const char* cur, const char* end,
+  const size_t num_vertices, const ply_face_sink_t* sink, size_t* num_bad_faces, const char* filepath)
+{
+  const ply_property_t* indices = ply_find_property(element, "vertex_indices");
+
+  if (!indices)
+    indices = ply_find_property(element, "vertex_index");
+
+  if (!indices || indices->list_type == PLY_NONE || indices->list_type == PLY_FLOAT32 ||
+    indices->list_type == PLY_FLOAT64) {
+    fprintf(stderr, "Error: %s: PLY faces need an integer vertex_indices list.\n", filepath);
+    return NULL;
+  }
+
+  const size_t count_size = ply_type_size(indices->type);
+  const size_t index_size = ply_type_size(indices->list_type);
+
+  // the common layout, a uchar count and int indices only, reads triangles as three words
+  const bool only_indices = element->num_properties == 1;
+  const bool int_indices = indices->list_type == PLY_INT32 || indices->list_type == PLY_UINT32;
+
+  // the list's offset is only known if no other list comes before it
+  for (const ply_property_t* property = element->properties; property != indices; ++property) {
+    if (property->list_type != PLY_NONE) {
+      fprintf(stderr, "Error: %s: PLY faces with lists before vertex_indices aren't supported.\n", filepath);
+      return NULL;
+    }
+  }
+
+  // scans are triangle meshes, so one face per record is the usual count
+  if (sink->reserve)
+    sink->reserve(sink->user, (size_t)MIN(element->count, (uint64_t)(end - cur) / (count_size + 3 * index_size)));
+
+  for (uint64_t i = 0; i < element->count; ++i) {
+    const char* record = cur;
+    const char* list = record + indices->offset;
+
+    if ((size_t)(end - list) < count_size) {
+      fprintf(stderr, "Error: %s: PLY face data is truncated.\n", filepath);
+      return NULL;
+    }
+
+    const int64_t count = ply_read_int(list, indices->type);
+    const char* first = list + count_size;
+
+    if (count < 0 || (size_t)(end - first) < (size_t)count * index_size) {
+      fprintf(stderr, "Error: %s: PLY face data is truncated.\n", filepath);
+      return NULL;
+    }
+
+    if (count == 3 && int_indices) {
+      uint32_t corners[3];
+      memcpy(corners, first, sizeof(corners));
+
+      if (corners[0] < num_vertices && corners[1] < num_vertices && corners[2] < num_vertices) {
+        sink->triangle(sink->user, corners[0], corners[1], corners[2]);
+      } else {
+        ++*num_bad_faces;
+      }
+    } else {
+      // polygons are fan triangulated
+      const int64_t a = count >= 3 ? ply_read_int(first, indices->list_type) : -1;
+
+      for (int64_t j = 1; j + 1 < count; ++j) {
+        const int64_t b = ply_read_int(first + index_size * (size_t)j, indices->list_type);
+        const int64_t c = ply_read_int(first + index_size * (size_t)(j + 1), indices->list_type);
+
+        if (a < 0 || b < 0 || c < 0 || (size_t)a >= num_vertices || (size_t)b >= num_vertices || (size_t)c >= num_vertices) {
+          ++*num_bad_faces;
+          continue;
+        }
+
+        sink->triangle(sink->user, (uint32_t)a, (uint32_t)b, (uint32_t)c);
+      }
+    }
+
+    cur = only_indices ? first + (size_t)count * index_size : ply_skip_record(element, record, end);
+
+    if (!cur) {
+      fprintf(stderr, "Error: %s: PLY face data is truncated.\n", filepath);
+      return NULL;
+    }
+  }
+
+  return cur;
+}
+
+// edges, materials etc. aren't used
+static const char* ply_skip_element(const ply_element_t* element, const char* cur, const char* end)
+{
+  if (element->stride > 0)
+    return element->count <= (uint64_t)(end - cur) / element->stride ? cur + element->stride * element->count : NULL;
+
+  for (uint64_t i = 0; i < element->count && cur; ++i)
+    cur = ply_skip_record(element, cur, end);
+
+  return cur;
+}
+
+// reserving rarely reallocates while the faces are pushed
+static void reserve_faces(void* user, const size_t count)
+{
+  mesh_t* mesh = (mesh_t*)user;
+
+  if (count > 0) {
+    mesh->faces = darray_alloc(mesh->faces, sizeof(face_t), count);
+    darray_reset_size(mesh->faces, 0);
+  }
+}
+
+static void push_face(void* user, const uint32_t a, const uint32_t b, const uint32_t c)
+{
+  mesh_t* mesh = (mesh_t*)user;
+  const face_t face = { .a = a, .b = b, .c = c, .color = 0xFF000000, .material = MATERIAL_NONE };
+
+  darray_push(mesh->faces, face);
+}
+
+void mesh_parse_ply(mesh_t* mesh, const char* filepath)
+{
+  if (!mesh || !filepath) return;
+
+  mesh_free(mesh);
+
+  file_map_t file;
+
+  if (!file_map_open(&file, filepath))
+    return;
+
+  const char* end = file.data + file.size;
+  ply_header_t header;
+
+  if (!ply_parse_header(file.data, end, &header, filepath)) {
+    file_map_close(&file);
+    return;
+  }
+
+  const char* cur = header.body;
+  bool has_normals = false;
+  size_t num_bad_faces = 0;
+
+  for (size_t i = 0; i < header.num_elements && cur; ++i) {
+    ply_element_t* element = &header.elements[i];
+    ply_compute_layout(element);
+
+    if (strcmp(element->name, "vertex") == 0) {
+      cur = ply_read_vertices(mesh, element, cur, end, &has_normals, filepath);
+    } else if (strcmp(element->name, "face") == 0) {
+      const ply_face_sink_t sink = { .user = mesh, .reserve = reserve_faces, .triangle = push_face };
+      cur = ply_read_faces(element, cur, end, darray_size(mesh->vertices), &sink, &num_bad_faces, filepath);
+    } else {
+      cur = ply_skip_element(element, cur, end);
+    }
+  }
+
+  if (!cur) {
+    mesh_free(mesh);
+    file_map_close(&file);
+    return;
+  }
+
+  if (num_bad_faces > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu triangles with out of range indices.\n", filepath, num_bad_faces);
+
+  if (!has_normals)
+    mesh_generate_normals(mesh, 0, 0);
+
+  file_map_close(&file);
+
+  mesh_compute_bounds(mesh);
+}
+
+typedef struct ply_scan {
+  const mesh_scan_t* scan;
+  bool has_uvs;
+  bool has_normals;
+} ply_scan_t;
+
+// uvs and normals are per vertex, so the corners index them like the positions
+static void scan_triangle(void* user, const uint32_t a, const uint32_t b, const uint32_t c)
+{
+  const ply_scan_t* ply = (const ply_scan_t*)user;
+  const uint32_t corners[3] = { a, b, c };
+  const uint32_t none[3] = { MESH_SCAN_NONE, MESH_SCAN_NONE, MESH_SCAN_NONE };
+
+  ply->scan->triangle(ply->scan->user, corners, ply->has_uvs ? corners : none, ply->has_normals ? corners : none);
+}
+
+bool mesh_scan_ply(const char* filepath, const mesh_scan_t* scan)
+{
+  file_map_t file;
+
+  if (!file_map_open(&file, filepath))
+    return false;
+
+  const char* end = file.data + file.size;
+  ply_header_t header;
+
+  if (!ply_parse_header(file.data, end, &header, filepath)) {
+    file_map_close(&file);
+    return false;
+  }
+
+  const char* cur = header.body;
+  ply_scan_t ply = { .scan = scan };
+  size_t num_vertices = 0;
+  size_t num_bad_faces = 0;
+
+  for (size_t i = 0; i < header.num_elements && cur; ++i) {
+    ply_element_t* element = &header.elements[i];
+    ply_compute_layout(element);
+
+    if (strcmp(element->name, "vertex") == 0) {
+      ply_vertex_layout_t layout;
+
+      if (!ply_find_vertex_layout(element, cur, end, &layout, filepath)) {
+        cur = NULL;
+        continue;
+      }
+
+      num_vertices = (size_t)element->count;
+      ply.has_uvs = layout.has_uvs;
+      ply.has_normals = layout.has_normals;
+
+      for (size_t j = 0; j < num_vertices; ++j) {
+        vertex_t vertex;
+        ply_read_vertex(cur + element->stride * j, &layout, &vertex);
+
+        scan->position(scan->user, &vertex.position);
+        if (layout.has_uvs) scan->tex_coord(scan->user, &vertex.uv);
+        if (layout.has_normals) scan->normal(scan->user, &vertex.normal);
+      }
+
+      cur += element->stride * num_vertices;
+    } else if (strcmp(element->name, "face") == 0) {
+      const ply_face_sink_t sink = { .user = &ply, .reserve = NULL, .triangle = scan_triangle };
+      cur = ply_read_faces(element, cur, end, num_vertices, &sink, &num_bad_faces, filepath);
+    } else {
+      cur = ply_skip_element(element, cur, end);
+    }
+  }
+
+  if (num_bad_faces > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu triangles with out of range indices.\n", filepath, num_bad_faces);
+
+  file_map_close(&file);
+
+  return cur != NULL;
+}
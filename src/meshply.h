@@ -0,0 +1,17 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "mesh.h"
+#include "types.h"
+
+// Binary little endian PLY. Only the header is text, the vertex and face elements are copied
+// from the mapped file with offsets detected from the header. Files without faces (point clouds)
+// only fill the vertices.
+
+void mesh_parse_ply(mesh_t* mesh, const char* filepath);
+
+// see mesh_scan(), the vertices are passed on with all their attributes before the faces
+bool mesh_scan_ply(const char* filepath, const mesh_scan_t* scan);
@@ -0,0 +1,266 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <math.h>
+#include <string.h>
+
+#include "darray.h"
+#include "matrix.h"
+#include "meshquant.h"
+#include "vector.h"
+
+#define QUANTIZE_MAX 65535.f
+#define OCTAHEDRAL_MAX 127.f
+
+static float sign_not_zero(const float x)
+{
+  return x < 0.f ? -1.f : 1.f;
+}
+
+static uint16_t quantize_unorm16(const float value, const float min, const float scale)
+{
+  if (scale <= 0.f) return 0;
+
+  const float q = roundf((value - min) / scale);
+  return (uint16_t)MIN(MAX(q, 0.f), QUANTIZE_MAX);
+}
+
+static int8_t quantize_snorm8(const float value)
+{
+  return (int8_t)roundf(MIN(MAX(value, -1.f), 1.f) * OCTAHEDRAL_MAX);
+}
+
+// the normal projected onto the octahedron |x| + |y| + |z| = 1, with the lower half folded outwards
+static void octahedral_encode(const vec3_t* normal, int8_t* out)
+{
+  const float l1 = fabsf(normal->x) + fabsf(normal->y) + fabsf(normal->z);
+
+  if (l1 <= 0.f) {
+    out[0] = out[1] = 0;
+    return;
+  }
+
+  float u = normal->x / l1;
+  float v = normal->y / l1;
+
+  if (normal->z < 0.f) {
+    const float folded_u = (1.f - fabsf(v)) * sign_not_zero(u);
+    const float folded_v = (1.f - fabsf(u)) * sign_not_zero(v);
+    u = folded_u;
+    v = folded_v;
+  }
+
+  out[0] = quantize_snorm8(u);
+  out[1] = quantize_snorm8(v);
+}
+
+static vec3_t octahedral_decode(const int8_t* in)
+{
+  float u = (float)in[0] / OCTAHEDRAL_MAX;
+  float v = (float)in[1] / OCTAHEDRAL_MAX;
+  const float z = 1.f - fabsf(u) - fabsf(v);
+
+  if (z < 0.f) {
+    const float unfolded_u = (1.f - fabsf(v)) * sign_not_zero(u);
+    const float unfolded_v = (1.f - fabsf(u)) * sign_not_zero(v);
+    u = unfolded_u;
+    v = unfolded_v;
+  }
+
+  vec3_t normal = { u, v, z };
+
+  if (in[0] != 0 || in[1] != 0)
+    vec3_normalize(&normal);
+
+  return normal;
+}
+
+void vertex_quantization_init(vertex_quantization_t* quantization, const vertex_t* vertices, const size_t count)
+{
+  memset(quantization, 0, sizeof(*quantization));
+  if (count == 0) return;
+
+  vec3_t min = vertices[0].position;
+  vec3_t max = min;
+  uv_t uv_min = vertices[0].uv;
+  uv_t uv_max = uv_min;
+
+  for (size_t i = 1; i < count; ++i) {
+    const vec3_t* p = &vertices[i].position;
+    const uv_t* uv = &vertices[i].uv;
+
+    min.x = MIN(min.x, p->x);
+    min.y = MIN(min.y, p->y);
+    min.z = MIN(min.z, p->z);
+    max.x = MAX(max.x, p->x);
+    max.y = MAX(max.y, p->y);
+    max.z = MAX(max.z, p->z);
+
+    uv_min.u = MIN(uv_min.u, uv->u);
+    uv_min.v = MIN(uv_min.v, uv->v);
+    uv_max.u = MAX(uv_max.u, uv->u);
+    uv_max.v = MAX(uv_max.v, uv->v);
+  }
+
+  quantization->position_min = min;
+  quantization->position_scale = (vec3_t) {
+    (max.x - min.x) / QUANTIZE_MAX,
+    (max.y - min.y) / QUANTIZE_MAX,
+    (max.z - min.z) / QUANTIZE_MAX
+  };
+
+  quantization->uv_min = uv_min;
+  quantization->uv_scale = (uv_t) { (uv_max.u - uv_min.u) / QUANTIZE_MAX, (uv_max.v - uv_min.v) / QUANTIZE_MAX };
+}
+
+packed_vertex_t vertex_quantize(const vertex_t* vertex, const vertex_quantization_t* quantization)
+{
+  const vertex_quantization_t* q = quantization;
+  packed_vertex_t packed;
+
+  packed.position[0] = quantize_unorm16(vertex->position.x, q->position_min.x, q->position_scale.x);
+  packed.position[1] = quantize_unorm16(vertex->position.y, q->position_min.y, q->position_scale.y);
+  packed.position[2] = quantize_unorm16(vertex->position.z, q->position_min.z, q->position_scale.z);
+  packed.uv[0] = quantize_unorm16(vertex->uv.u, q->uv_min.u, q->uv_scale.u);
+  packed.uv[1] = quantize_unorm16(vertex->uv.v, q->uv_min.v, q->uv_scale.v);
+  octahedral_encode(&vertex->normal, packed.normal);
+
+  return packed;
+}
+
+void mesh_quantize(mesh_t* mesh)
+{
+  // mapped arrays belong to the mapping
+  if (!mesh || !mesh->vertices || mesh->mapping.data || mesh->borrowed) return;
+
+  const size_t num_vertices = darray_size(mesh->vertices);
+
+  vertex_quantization_init(&mesh->quantization, mesh->vertices, num_vertices);
+
+  packed_vertex_t* packed = darray_alloc(NULL, sizeof(packed_vertex_t), num_vertices);
+
+  for (size_t i = 0; i < num_vertices; ++i)
+    packed[i] = vertex_quantize(&mesh->vertices[i], &mesh->quantization);
+
+  darray_free(mesh->packed_vertices);
+  darray_free(mesh->vertices);
+
+  mesh->packed_vertices = packed;
+  mesh->vertices = NULL;
+}
+
+vertex_t mesh_vertex(const mesh_t* mesh, const size_t index)
+{
+  if (!mesh->packed_vertices)
+    return mesh->vertices[index];
+
+  const packed_vertex_t* packed = &mesh->packed_vertices[index];
+  const vertex_quantization_t* q = &mesh->quantization;
+
+  return (vertex_t) {
+    .position = {
+      q->position_min.x + (float)packed->position[0] * q->position_scale.x,
+      q->position_min.y + (float)packed->position[1] * q->position_scale.y,
+      q->position_min.z + (float)packed->position[2] * q->position_scale.z
+    },
+    .uv = packed_vertex_uv(packed, q),
+    .normal = octahedral_decode(packed->normal)
+  };
+}
+
+mat4_t vertex_quantization_matrix(const vertex_quantization_t* quantization)
+{
+  const mat4_t translation = mat4_make_translation(&quantization->position_min);
+  const mat4_t scale = mat4_make_scale(&quantization->position_scale);
+
+  return mat4_mul_mat4(&translation, &scale);
+}
+
+static uint8_t* write_varint(uint8_t* out, uint32_t value)
+{
+  while (value >= 0x80) {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+
+  *out++ = (uint8_t)value;
+  return out;
+}
+
+// the difference of two uint32_t, mapped so small magnitudes of either sign become small values
+static uint32_t zigzag(const uint32_t value, const uint32_t previous)
+{
+  const int32_t delta = (int32_t)(value - previous);
+  return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+static uint32_t unzigzag(const uint32_t encoded, const uint32_t previous)
+{
+  const uint32_t delta = (encoded >> 1) ^ (0u - (encoded & 1));
+  return previous + delta;
+}
+
+size_t mesh_encode_faces(const face_t* faces, const size_t count, uint8_t* out)
+{
+  uint8_t* begin = out;
+  uint32_t previous_index = 0;
+  uint32_t previous_material = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t indices[3] = { faces[i].a, faces[i].b, faces[i].c };
+
+    for (size_t j = 0; j < 3; ++j) {
+      out = write_varint(out, zigzag(indices[j], previous_index));
+      previous_index = indices[j];
+    }
+
+    out = write_varint(out, zigzag(faces[i].material, previous_material));
+    previous_material = faces[i].material;
+  }
+
+  return (size_t)(out - begin);
+}
+
+static bool read_varint(const uint8_t** data, const uint8_t* end, uint32_t* value)
+{
+  uint32_t result = 0;
+
+  for (uint32_t shift = 0; shift < 35; shift += 7) {
+    if (*data == end) return false;
+
+    const uint8_t byte = *(*data)++;
+    result |= (uint32_t)(byte & 0x7F) << shift;
+
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t mesh_decode_faces(const uint8_t* data, const size_t size, face_t* faces, const size_t count)
+{
+  const uint8_t* begin = data;
+  const uint8_t* end = data + size;
+  uint32_t previous_index = 0;
+  uint32_t previous_material = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t encoded[4];
+
+    for (size_t j = 0; j < 4; ++j) {
+      if (!read_varint(&data, end, &encoded[j])) return 0;
+    }
+
+    face_t* face = &faces[i];
+
+    face->a = previous_index = unzigzag(encoded[0], previous_index);
+    face->b = previous_index = unzigzag(encoded[1], previous_index);
+    face->c = previous_index = unzigzag(encoded[2], previous_index);
+    face->material = previous_material = unzigzag(encoded[3], previous_material);
+    face->color = 0;
+  }
+
+  return (size_t)(data - begin);
+}
@@ -0,0 +1,53 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+#include "types.h"
+
+// Vertex quantization and index compression for large static meshes.
+
+// worst case size of mesh_encode_faces() output, 5 varint bytes per index and material
+#define MESH_ENCODED_FACE_MAX_SIZE 20
+
+// replaces the vertices by packed_vertices, quantized to the mesh's bounds and uv range
+void mesh_quantize(mesh_t* mesh);
+void vertex_quantization_init(vertex_quantization_t* quantization, const vertex_t* vertices, const size_t count);
+packed_vertex_t vertex_quantize(const vertex_t* vertex, const vertex_quantization_t* quantization);
+
+// the vertex at index, decoded if the mesh is quantized
+vertex_t mesh_vertex(const mesh_t* mesh, const size_t index);
+
+static inline size_t mesh_vertex_count(const mesh_t* mesh)
+{
+  return mesh->packed_vertices ? darray_size(mesh->packed_vertices) : darray_size(mesh->vertices);
+}
+
+static inline uv_t packed_vertex_uv(const packed_vertex_t* vertex, const vertex_quantization_t* quantization)
+{
+  return (uv_t) {
+    quantization->uv_min.u + (float)vertex->uv[0] * quantization->uv_scale.u,
+    quantization->uv_min.v + (float)vertex->uv[1] * quantization->uv_scale.v
+  };
+}
+
+// the uv of the vertex at index, for either vertex format
+static inline uv_t mesh_vertex_uv(const mesh_t* mesh, const size_t index)
+{
+  return mesh->packed_vertices ?
+    packed_vertex_uv(&mesh->packed_vertices[index], &mesh->quantization) : mesh->vertices[index].uv;
+}
+
+// maps quantized positions to model space, so it can be folded into the model transform
+mat4_t vertex_quantization_matrix(const vertex_quantization_t* quantization);
+
+// Index compression: every index is stored as the zigzag varint of its difference to the previous
+// one, followed by the face's material the same way. After vertex cache optimization most faces
+// reuse recently referenced vertices, so most indices take a single byte. Colors aren't stored.
+size_t mesh_encode_faces(const face_t* faces, const size_t count, uint8_t* out);
+
+// returns the number of bytes read, or 0 if data ends early
+size_t mesh_decode_faces(const uint8_t* data, const size_t size, face_t* faces, const size_t count);
@@ -0,0 +1,790 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "matrix.h"
+#include "mesh.h"
+#include "meshopt.h"
+#include "meshquant.h"
+#include "meshstream.h"
+#include "vector.h"
+
+#define STREAM_NONE UINT32_MAX
+
+static const char mesh_stream_magic[8] = { 'S', 'R', 'B', 'L', 'O', 'C', 'K', 'S' };
+
+typedef struct mesh_block_order {
+  float distance;
+  uint32_t block;
+} mesh_block_order_t;
+
+static void mesh_stream_path(char* buffer, const size_t size, const char* source_path)
+{
+  snprintf(buffer, size, "%s%s", source_path, MESH_STREAM_EXTENSION);
+}
+
+// in the file, with quantized vertices and compressed faces
+static size_t block_data_bytes(const mesh_block_t* block)
+{
+  return sizeof(packed_vertex_t) * block->num_vertices + block->face_bytes;
+}
+
+// in memory once loaded, with the faces decoded
+static size_t block_resident_bytes(const mesh_block_t* block)
+{
+  return sizeof(packed_vertex_t) * block->num_vertices + sizeof(face_t) * block->num_faces;
+}
+
+// the scan is spilled into files next to the blocks, and mapped back once it's complete
+enum stream_spill {
+  SPILL_POSITIONS,
+  SPILL_TEX_COORDS,
+  SPILL_NORMALS,
+  SPILL_TRIANGLES,
+  SPILL_CELLS,
+  SPILL_COUNT
+};
+
+static const char* spill_extensions[SPILL_COUNT] = { ".positions", ".uvs", ".normals", ".triangles", ".cells" };
+
+// corners index the spilled attributes
+typedef struct spill_triangle {
+  uint32_t positions[3];
+  uint32_t tex_coords[3];
+  uint32_t normals[3];
+} spill_triangle_t;
+
+// a (position, uv, normal) combination welded into a block vertex, entries of older blocks are
+// recognized by their stamp, so the table isn't cleared per block
+typedef struct corner_entry {
+  uint32_t key[3];
+  uint32_t vertex;
+  uint32_t stamp;
+} corner_entry_t;
+
+// a power of two with at least twice as many entries as a block has corners, so probes stay short
+#define STREAM_CORNER_BITS 17
+
+#define STREAM_NUM_CELLS ((size_t)1 << (3 * MESH_STREAM_GRID_BITS))
+
+// State of the block partitioning. Only the per cell counts, the triangles of the cells being
+// split and a single block live in the heap, everything else is mapped.
+typedef struct block_builder {
+  char spill_paths[SPILL_COUNT][1024 + 16];
+  FILE* spills[SPILL_COUNT];
+  file_map_t maps[SPILL_COUNT];
+  size_t counts[SPILL_COUNT];
+  bool spilled;
+
+  const vec3_t* positions;
+  const uv_t* tex_coords;
+  const vec3_t* normals;
+  const spill_triangle_t* triangles;
+  const uint32_t* cells;
+  vec3_t bounds_min;
+  vec3_t bounds_max;
+  float cell_scale[3];
+
+  uint32_t* cell_counts;
+  uint32_t* ids;
+  corner_entry_t* corners;
+  uint32_t stamp;
+
+  mesh_t block;
+  bool* generated;
+  mesh_block_t* blocks;
+  packed_vertex_t* packed;
+  uint8_t* encoded;
+  FILE* file;
+  uint64_t offset;
+  bool written;
+} block_builder_t;
+
+static void spill(block_builder_t* builder, const enum stream_spill which, const void* data, const size_t size)
+{
+  builder->spilled = builder->spilled && fwrite(data, size, 1, builder->spills[which]) == 1;
+  ++builder->counts[which];
+}
+
+static void spill_position(void* user, const vec3_t* position)
+{
+  block_builder_t* builder = user;
+
+  if (builder->counts[SPILL_POSITIONS] == 0) {
+    builder->bounds_min = *position;
+    builder->bounds_max = *position;
+  }
+
+  builder->bounds_min.x = MIN(builder->bounds_min.x, position->x);
+  builder->bounds_min.y = MIN(builder->bounds_min.y, position->y);
+  builder->bounds_min.z = MIN(builder->bounds_min.z, position->z);
+  builder->bounds_max.x = MAX(builder->bounds_max.x, position->x);
+  builder->bounds_max.y = MAX(builder->bounds_max.y, position->y);
+  builder->bounds_max.z = MAX(builder->bounds_max.z, position->z);
+
+  spill(builder, SPILL_POSITIONS, position, sizeof(*position));
+}
+
+static void spill_tex_coord(void* user, const uv_t* uv)
+{
+  spill(user, SPILL_TEX_COORDS, uv, sizeof(*uv));
+}
+
+static void spill_normal(void* user, const vec3_t* normal)
+{
+  spill(user, SPILL_NORMALS, normal, sizeof(*normal));
+}
+
+static void spill_triangle(void* user, const uint32_t* positions, const uint32_t* tex_coords, const uint32_t* normals)
+{
+  spill_triangle_t triangle;
+
+  memcpy(triangle.positions, positions, sizeof(triangle.positions));
+  memcpy(triangle.tex_coords, tex_coords, sizeof(triangle.tex_coords));
+  memcpy(triangle.normals, normals, sizeof(triangle.normals));
+
+  spill(user, SPILL_TRIANGLES, &triangle, sizeof(triangle));
+}
+
+static bool open_spill(block_builder_t* builder, const enum stream_spill which)
+{
+  builder->spills[which] = fopen(builder->spill_paths[which], "wb");
+
+  if (!builder->spills[which]) {
+    perror("Error creating mesh blocks");
+    return false;
+  }
+
+  return true;
+}
+
+// maps the finished spill, an empty one stays NULL
+static bool map_spill(block_builder_t* builder, const enum stream_spill which)
+{
+  fclose(builder->spills[which]);
+  builder->spills[which] = NULL;
+
+  return builder->counts[which] == 0 || file_map_open(&builder->maps[which], builder->spill_paths[which]);
+}
+
+static void remove_spills(block_builder_t* builder)
+{
+  for (size_t i = 0; i < SPILL_COUNT; ++i) {
+    if (builder->spills[i]) fclose(builder->spills[i]);
+    file_map_close(&builder->maps[i]);
+    remove(builder->spill_paths[i]);
+  }
+}
+
+static uint32_t morton_code(const uint32_t* cell)
+{
+  uint32_t code = 0;
+
+  for (uint32_t bit = 0; bit < MESH_STREAM_GRID_BITS; ++bit) {
+    for (uint32_t axis = 0; axis < 3; ++axis)
+      code |= ((cell[axis] >> bit) & 1u) << (3 * bit + axis);
+  }
+
+  return code;
+}
+
+// the grid cell of the triangle's centroid, numbered along a Morton curve so that consecutive cells
+// are close, or STREAM_NONE if it indexes attributes the file doesn't have
+static uint32_t triangle_cell(const block_builder_t* builder, const spill_triangle_t* triangle)
+{
+  vec3_t centroid = vec3_null;
+
+  for (size_t j = 0; j < 3; ++j) {
+    if (triangle->positions[j] >= builder->counts[SPILL_POSITIONS] || (triangle->tex_coords[j] != MESH_SCAN_NONE &&
+      triangle->tex_coords[j] >= builder->counts[SPILL_TEX_COORDS]))
+      return STREAM_NONE;
+
+    centroid = vec3_add(&centroid, &builder->positions[triangle->positions[j]]);
+  }
+
+  const float* c = &centroid.x;
+  const float* min = &builder->bounds_min.x;
+  uint32_t cell[3];
+
+  for (size_t axis = 0; axis < 3; ++axis) {
+    const float t = (c[axis] / 3.f - min[axis]) * builder->cell_scale[axis];
+    cell[axis] = (uint32_t)MIN(MAX(t, 0.f), (float)((1u << MESH_STREAM_GRID_BITS) - 1));
+  }
+
+  return morton_code(cell);
+}
+
+// spills the cell of every triangle and counts the triangles per cell, returns the skipped ones
+static size_t count_cells(block_builder_t* builder)
+{
+  const float* min = &builder->bounds_min.x;
+  const float* max = &builder->bounds_max.x;
+  size_t num_bad = 0;
+
+  for (size_t axis = 0; axis < 3; ++axis)
+    builder->cell_scale[axis] = max[axis] > min[axis] ? (float)(1u << MESH_STREAM_GRID_BITS) / (max[axis] - min[axis]) : 0.f;
+
+  for (size_t i = 0; i < builder->counts[SPILL_TRIANGLES]; ++i) {
+    const uint32_t cell = triangle_cell(builder, &builder->triangles[i]);
+
+    if (cell == STREAM_NONE) ++num_bad;
+    else ++builder->cell_counts[cell];
+
+    spill(builder, SPILL_CELLS, &cell, sizeof(cell));
+  }
+
+  return num_bad;
+}
+
+static uint32_t weld_corner(block_builder_t* builder, const uint32_t position, const uint32_t tex_coord, uint32_t normal)
+{
+  // broken normal indices get a generated normal, like missing ones
+  if (normal != MESH_SCAN_NONE && normal >= builder->counts[SPILL_NORMALS])
+    normal = MESH_SCAN_NONE;
+
+  const size_t mask = ((size_t)1 << STREAM_CORNER_BITS) - 1;
+  uint64_t h = position * 0x9E3779B97F4A7C15ULL;
+  h ^= (tex_coord + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+  h ^= (normal + 0x165667B19E3779F9ULL) * 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+
+  for (size_t slot = (size_t)h & mask;; slot = (slot + 1) & mask) {
+    corner_entry_t* entry = &builder->corners[slot];
+
+    if (entry->stamp == builder->stamp && entry->key[0] == position && entry->key[1] == tex_coord &&
+      entry->key[2] == normal)
+      return entry->vertex;
+
+    if (entry->stamp != builder->stamp) {
+      vertex_t vertex = { .position = builder->positions[position] };
+      const bool generated = normal == MESH_SCAN_NONE;
+
+      if (tex_coord != MESH_SCAN_NONE) vertex.uv = builder->tex_coords[tex_coord];
+      if (!generated) vertex.normal = builder->normals[normal];
+
+      *entry = (corner_entry_t) {
+        .key = { position, tex_coord, normal },
+        .vertex = (uint32_t)darray_size(builder->block.vertices),
+        .stamp = builder->stamp
+      };
+
+      darray_push(builder->block.vertices, vertex);
+      darray_push(builder->generated, generated);
+      return entry->vertex;
+    }
+  }
+}
+
+// quantizes, compresses and appends the block that was welded into builder->block
+static void store_block(block_builder_t* builder)
+{
+  const vertex_t* vertices = builder->block.vertices;
+  mesh_block_t block = {
+    .offset = builder->offset,
+    .num_vertices = (uint32_t)darray_size(builder->block.vertices),
+    .num_faces = (uint32_t)darray_size(builder->block.faces)
+  };
+
+  block.bounds_min = block.num_vertices > 0 ? vertices[0].position : vec3_null;
+  block.bounds_max = block.bounds_min;
+
+  for (uint32_t i = 0; i < block.num_vertices; ++i) {
+    const vec3_t* p = &vertices[i].position;
+
+    block.bounds_min.x = MIN(block.bounds_min.x, p->x);
+    block.bounds_min.y = MIN(block.bounds_min.y, p->y);
+    block.bounds_min.z = MIN(block.bounds_min.z, p->z);
+    block.bounds_max.x = MAX(block.bounds_max.x, p->x);
+    block.bounds_max.y = MAX(block.bounds_max.y, p->y);
+    block.bounds_max.z = MAX(block.bounds_max.z, p->z);
+  }
+
+  // quantized to the block's own bounds, which are much tighter than the mesh's
+  vertex_quantization_init(&block.quantization, vertices, block.num_vertices);
+  darray_clear(builder->packed);
+
+  for (uint32_t i = 0; i < block.num_vertices; ++i)
+    darray_push(builder->packed, vertex_quantize(&vertices[i], &block.quantization));
+
+  block.face_bytes = (uint32_t)mesh_encode_faces(builder->block.faces, block.num_faces, builder->encoded);
+
+  builder->written = builder->written &&
+    (block.num_vertices == 0 || 
+      fwrite(builder->packed, sizeof(packed_vertex_t), block.num_vertices, builder->file) == block.num_vertices) &&
+    (block.face_bytes == 0 || fwrite(builder->encoded, 1, block.face_bytes, builder->file) == block.face_bytes);
+
+  builder->offset += block_data_bytes(&block);
+  darray_push(builder->blocks, block);
+}
+
+// Welds the triangles into a block. Vertices without a normal get the area weighted average of
+// the block's faces around them, so they may differ slightly along block borders.
+static void write_block(block_builder_t* builder, const uint32_t* ids, const size_t count)
+{
+  if (++builder->stamp == 0) {
+    memset(builder->corners, 0, sizeof(corner_entry_t) << STREAM_CORNER_BITS);
+    builder->stamp = 1;
+  }
+
+  darray_clear(builder->block.vertices);
+  darray_clear(builder->block.faces);
+  darray_clear(builder->generated);
+
+  for (size_t i = 0; i < count; ++i) {
+    const spill_triangle_t* triangle = &builder->triangles[ids[i]];
+    uint32_t corners[3];
+
+    for (size_t j = 0; j < 3; ++j)
+      corners[j] = weld_corner(builder, triangle->positions[j], triangle->tex_coords[j], triangle->normals[j]);
+
+    const face_t face = { .a = corners[0], .b = corners[1], .c = corners[2], .color = 0xFF000000, .material = MATERIAL_NONE };
+    darray_push(builder->block.faces, face);
+  }
+
+  vertex_t* vertices = builder->block.vertices;
+  const size_t num_vertices = darray_size(vertices);
+
+  for (size_t i = 0; i < count; ++i) {
+    const face_t* face = &builder->block.faces[i];
+    const uint32_t corners[3] = { face->a, face->b, face->c };
+
+    if (!builder->generated[face->a] && !builder->generated[face->b] && !builder->generated[face->c])
+      continue;
+
+    // unnormalized, its length is twice the face's area
+    const vec3_t ab = vec3_sub(&vertices[face->b].position, &vertices[face->a].position);
+    const vec3_t ac = vec3_sub(&vertices[face->c].position, &vertices[face->a].position);
+    const vec3_t normal = vec3_cross(&ab, &ac);
+
+    for (size_t j = 0; j < 3; ++j) {
+      if (builder->generated[corners[j]])
+        vertices[corners[j]].normal = vec3_add(&vertices[corners[j]].normal, &normal);
+    }
+  }
+
+  for (size_t i = 0; i < num_vertices; ++i) {
+    if (builder->generated[i] && vec3_mag(&vertices[i].normal) > 0.f)
+      vec3_normalize(&vertices[i].normal);
+  }
+
+  mesh_optimize_vertex_cache(&builder->block);
+  store_block(builder);
+}
+
+static void write_blocks(block_builder_t* builder, const uint32_t* ids, const size_t count)
+{
+  for (size_t i = 0; i < count; i += MESH_BLOCK_MAX_FACES)
+    write_block(builder, ids + i, MIN(count - i, (size_t)MESH_BLOCK_MAX_FACES));
+}
+
+// sorts the triangles of cells [first, last) by cell into ids in one pass over the cells spill, the
+// counts become each cell's next slot in ids
+static void split_cell_range(block_builder_t* builder, const size_t first, const size_t last, const size_t count)
+{
+  size_t offset = 0;
+
+  for (size_t i = first; i < last; ++i) {
+    const uint32_t cell_count = builder->cell_counts[i];
+    builder->cell_counts[i] = (uint32_t)offset;
+    offset += cell_count;
+  }
+
+  for (size_t i = 0; i < builder->counts[SPILL_TRIANGLES]; ++i) {
+    const uint32_t cell = builder->cells[i];
+
+    if (cell != STREAM_NONE && cell >= first && cell < last)
+      builder->ids[builder->cell_counts[cell]++] = (uint32_t)i;
+  }
+
+  write_blocks(builder, builder->ids, count);
+}
+
+// a cell too dense for ids is split in file order, which is usually coherent within a cell
+static void split_large_cell(block_builder_t* builder, const uint32_t cell)
+{
+  size_t count = 0;
+
+  for (size_t i = 0; i < builder->counts[SPILL_TRIANGLES]; ++i) {
+    if (builder->cells[i] != cell) continue;
+
+    builder->ids[count++] = (uint32_t)i;
+
+    if (count == MESH_BLOCK_MAX_FACES) {
+      write_block(builder, builder->ids, count);
+      count = 0;
+    }
+  }
+
+  if (count > 0)
+    write_block(builder, builder->ids, count);
+}
+
+// walks the cells in Morton order, in ranges whose triangles fit in ids together
+static void split_cells(block_builder_t* builder)
+{
+  size_t first = 0;
+
+  while (first < STREAM_NUM_CELLS) {
+    size_t last = first;
+    size_t count = 0;
+
+    while (last < STREAM_NUM_CELLS && (last == first || count + builder->cell_counts[last] <= MESH_STREAM_BUILD_FACES))
+      count += builder->cell_counts[last++];
+
+    if (count > MESH_STREAM_BUILD_FACES) split_large_cell(builder, (uint32_t)first);
+    else if (count > 0) split_cell_range(builder, first, last, count);
+
+    first = last;
+  }
+}
+
+bool mesh_stream_build(const char* source_path)
+{
+  if (!source_path) return false;
+
+  mesh_stream_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  if (!file_stat(source_path, &header.source_size, &header.source_mtime))
+    return false;
+
+  char path[1024];
+  mesh_stream_path(path, sizeof(path), source_path);
+
+  block_builder_t builder;
+  memset(&builder, 0, sizeof(builder));
+  builder.spilled = true;
+  builder.written = true;
+
+  for (size_t i = 0; i < SPILL_COUNT; ++i)
+    snprintf(builder.spill_paths[i], sizeof(builder.spill_paths[i]), "%s%s", path, spill_extensions[i]);
+
+  if (!open_spill(&builder, SPILL_POSITIONS) || !open_spill(&builder, SPILL_TEX_COORDS) ||
+    !open_spill(&builder, SPILL_NORMALS) || !open_spill(&builder, SPILL_TRIANGLES)) {
+    remove_spills(&builder);
+    return false;
+  }
+
+  const mesh_scan_t scan = {
+    .user = &builder,
+    .position = spill_position,
+    .tex_coord = spill_tex_coord,
+    .normal = spill_normal,
+    .triangle = spill_triangle
+  };
+
+  if (!mesh_scan(source_path, &scan)) {
+    fprintf(stderr, "Error: only obj and ply meshes can be split into blocks: %s\n", source_path);
+    remove_spills(&builder);
+    return false;
+  }
+
+  // triangles are referenced by 32-bit ids while they're sorted
+  const size_t num_triangles = builder.counts[SPILL_TRIANGLES];
+
+  if (!builder.spilled || num_triangles == 0 || num_triangles > STREAM_NONE || !map_spill(&builder, SPILL_POSITIONS) ||
+    !map_spill(&builder, SPILL_TEX_COORDS) || !map_spill(&builder, SPILL_NORMALS) || !map_spill(&builder, SPILL_TRIANGLES) ||
+    !open_spill(&builder, SPILL_CELLS)) {
+    fprintf(stderr, "Error splitting %s into blocks.\n", source_path);
+    remove_spills(&builder);
+    return false;
+  }
+
+  builder.positions = (const vec3_t*)builder.maps[SPILL_POSITIONS].data;
+  builder.tex_coords = (const uv_t*)builder.maps[SPILL_TEX_COORDS].data;
+  builder.normals = (const vec3_t*)builder.maps[SPILL_NORMALS].data;
+  builder.triangles = (const spill_triangle_t*)builder.maps[SPILL_TRIANGLES].data;
+  builder.cell_counts = calloc(STREAM_NUM_CELLS, sizeof(uint32_t));
+  builder.ids = malloc(sizeof(uint32_t) * MESH_STREAM_BUILD_FACES);
+  builder.corners = calloc((size_t)1 << STREAM_CORNER_BITS, sizeof(corner_entry_t));
+  builder.encoded = malloc((size_t)MESH_ENCODED_FACE_MAX_SIZE * MESH_BLOCK_MAX_FACES);
+
+  if (!builder.cell_counts || !builder.ids || !builder.corners || !builder.encoded) exit(EXIT_FAILURE);
+
+  const size_t num_bad = count_cells(&builder);
+
+  if (num_bad > 0)
+    fprintf(stderr, "Warning: %s: skipped %zu triangles with out of range indices.\n", source_path, num_bad);
+
+  // the block data goes first, the header and table are written once the blocks are known
+  char temp_path[1024 + 8];
+  snprintf(temp_path, sizeof(temp_path), "%s.data", path);
+
+  if (builder.spilled && map_spill(&builder, SPILL_CELLS)) {
+    builder.cells = (const uint32_t*)builder.maps[SPILL_CELLS].data;
+    builder.file = fopen(temp_path, "wb");
+  }
+
+  if (builder.file) {
+    split_cells(&builder);
+    fclose(builder.file);
+  } else {
+    perror("Error creating mesh blocks");
+    builder.written = false;
+  }
+
+  memcpy(header.magic, mesh_stream_magic, sizeof(header.magic));
+  header.version = MESH_STREAM_VERSION;
+  header.bounds_min = builder.bounds_min;
+  header.bounds_max = builder.bounds_max;
+  header.num_blocks = (uint32_t)darray_size(builder.blocks);
+  const uint64_t data_offset = sizeof(header) + sizeof(mesh_block_t) * header.num_blocks;
+
+  for (uint32_t i = 0; i < header.num_blocks; ++i)
+    builder.blocks[i].offset += data_offset;
+
+  // header and table, then the data appended in chunks
+  FILE* file = builder.written ? fopen(path, "wb") : NULL;
+  FILE* data = builder.written ? fopen(temp_path, "rb") : NULL;
+  bool written = file && data && fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(builder.blocks, sizeof(mesh_block_t), header.num_blocks, file) == header.num_blocks;
+
+  static char buffer[1 << 16];
+  size_t read = 0;
+
+  while (written && data && (read = fread(buffer, 1, sizeof(buffer), data)) > 0)
+    written = fwrite(buffer, 1, read, file) == read;
+
+  if (file) fclose(file);
+  if (data) fclose(data);
+  remove(temp_path);
+  remove_spills(&builder);
+
+  if (!written) {
+    fprintf(stderr, "Error writing mesh blocks: %s\n", path);
+    remove(path);
+  }
+
+  free(builder.cell_counts);
+  free(builder.ids);
+  free(builder.corners);
+  free(builder.encoded);
+  mesh_free(&builder.block);
+  darray_free(builder.generated);
+  darray_free(builder.blocks);
+  darray_free(builder.packed);
+
+  return written;
+}
+
+static bool stream_valid(const mesh_stream_t* stream, const char* source_path)
+{
+  const file_map_t* map = &stream->map;
+  const mesh_stream_header_t* header = &stream->header;
+
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  if (map->size < sizeof(*header) || memcmp(header->magic, mesh_stream_magic, sizeof(header->magic)) != 0 ||
+    header->version != MESH_STREAM_VERSION || !file_stat(source_path, &size, &mtime) ||
+    size != header->source_size || mtime != header->source_mtime)
+    return false;
+
+  if (header->num_blocks > (map->size - sizeof(*header)) / sizeof(mesh_block_t))
+    return false;
+
+  for (uint32_t i = 0; i < header->num_blocks; ++i) {
+    const mesh_block_t* block = &stream->blocks[i];
+
+    if (block->offset > map->size || block_data_bytes(block) > map->size - block->offset)
+      return false;
+  }
+
+  return true;
+}
+
+static bool open_blocks(mesh_stream_t* stream, const char* source_path)
+{
+  char path[1024];
+  mesh_stream_path(path, sizeof(path), source_path);
+
+  FILE* exists = fopen(path, "rb");
+  if (!exists) return false;
+  fclose(exists);
+
+  if (!file_map_open(&stream->map, path))
+    return false;
+
+  if (stream->map.size >= sizeof(stream->header)) {
+    memcpy(&stream->header, stream->map.data, sizeof(stream->header));
+    stream->blocks = (const mesh_block_t*)(stream->map.data + sizeof(stream->header));
+  }
+
+  if (!stream_valid(stream, source_path)) {
+    file_map_close(&stream->map);
+    return false;
+  }
+
+  return true;
+}
+
+bool mesh_stream_open(mesh_stream_t* stream, const char* source_path, const size_t budget)
+{
+  if (!stream || !source_path) return false;
+
+  memset(stream, 0, sizeof(*stream));
+
+  // converted once, straight from the source file's mapping
+  if (!open_blocks(stream, source_path)) {
+    printf("Splitting %s into blocks for streaming...\n", source_path);
+
+    if (!mesh_stream_build(source_path) || !open_blocks(stream, source_path)) {
+      fprintf(stderr, "Error opening mesh blocks for %s.\n", source_path);
+      return false;
+    }
+  }
+
+  const size_t num_blocks = stream->header.num_blocks;
+
+  stream->budget = budget;
+  stream->resident = calloc(num_blocks, sizeof(mesh_t));
+  stream->wanted = calloc(num_blocks, sizeof(bool));
+  stream->order = calloc(num_blocks, sizeof(mesh_block_order_t));
+
+  if (num_blocks > 0 && (!stream->resident || !stream->wanted || !stream->order)) exit(EXIT_FAILURE);
+
+  return true;
+}
+
+static void evict_block(mesh_stream_t* stream, const uint32_t index)
+{
+  mesh_t* mesh = &stream->resident[index];
+
+  if (!mesh->faces) return;
+
+  stream->resident_bytes -= block_resident_bytes(&stream->blocks[index]);
+  mesh_free(mesh);
+}
+
+// copies the vertices out of the mapping and decodes the faces into darrays, since the renderer
+// resets their sizes in place
+static void load_block(mesh_stream_t* stream, const uint32_t index)
+{
+  const mesh_block_t* block = &stream->blocks[index];
+  mesh_t* mesh = &stream->resident[index];
+  const char* data = stream->map.data + block->offset;
+  const size_t vertex_bytes = sizeof(packed_vertex_t) * block->num_vertices;
+
+  if (block->num_vertices == 0 || block->num_faces == 0) return;
+
+  mesh->packed_vertices = darray_alloc(NULL, sizeof(packed_vertex_t), block->num_vertices);
+  mesh->faces = darray_alloc(NULL, sizeof(face_t), block->num_faces);
+
+  memcpy(mesh->packed_vertices, data, vertex_bytes);
+
+  bool valid = mesh_decode_faces((const uint8_t*)data + vertex_bytes, block->face_bytes, mesh->faces, 
+    block->num_faces) == block->face_bytes;
+
+  for (uint32_t i = 0; i < block->num_faces && valid; ++i) {
+    face_t* face = &mesh->faces[i];
+
+    valid = face->a < block->num_vertices && face->b < block->num_vertices && face->c < block->num_vertices;
+  }
+
+  // kept resident as degenerate faces, so it isn't decoded again every frame
+  if (!valid) {
+    fprintf(stderr, "Corrupt mesh block %u, skipping it.\n", index);
+    memset(mesh->faces, 0, sizeof(face_t) * block->num_faces);
+  }
+
+  mesh->quantization = block->quantization;
+  mesh->bounds_min = block->bounds_min;
+  mesh->bounds_max = block->bounds_max;
+
+  stream->resident_bytes += block_resident_bytes(block);
+}
+
+static int compare_block_order(const void* a, const void* b)
+{
+  const float da = ((const mesh_block_order_t*)a)->distance;
+  const float db = ((const mesh_block_order_t*)b)->distance;
+
+  return (da > db) - (da < db);
+}
+
+void mesh_stream_update(mesh_stream_t* stream, const mat4_t* transform, const vec3_t* camera)
+{
+  if (!stream || !stream->blocks) return;
+
+  const uint32_t num_blocks = stream->header.num_blocks;
+
+  // the largest axis scale, so block radii are conservative in world space
+  float scale = 0.f;
+
+  for (size_t axis = 0; axis < 3; ++axis) {
+    vec4_t unit = { 0.f, 0.f, 0.f, 0.f };
+    (&unit.x)[axis] = 1.f;
+    unit = mat4_mul_vec4(transform, &unit);
+    scale = MAX(scale, vec4_mag(&unit));
+  }
+
+  for (uint32_t i = 0; i < num_blocks; ++i) {
+    const mesh_block_t* block = &stream->blocks[i];
+    vec3_t center = vec3_add(&block->bounds_min, &block->bounds_max);
+    vec3_t extent = vec3_sub(&block->bounds_max, &block->bounds_min);
+    vec3_scale(&center, 0.5f);
+
+    vec4_t world = vec4_from_vec3(&center);
+    world = mat4_mul_vec4(transform, &world);
+
+    vec3_t to_camera = vec3_sub(camera, &(vec3_t) { world.x, world.y, world.z });
+
+    stream->order[i] = (mesh_block_order_t) {
+      .distance = MAX(vec3_mag(&to_camera) - 0.5f * vec3_mag(&extent) * scale, 0.f),
+      .block = i
+    };
+  }
+
+  qsort(stream->order, num_blocks, sizeof(mesh_block_order_t), compare_block_order);
+
+  // the nearest blocks, up to the first one that doesn't fit in the budget anymore
+  size_t wanted_bytes = 0;
+  bool full = false;
+
+  for (uint32_t i = 0; i < num_blocks; ++i) {
+    const uint32_t block = stream->order[i].block;
+    const size_t bytes = block_resident_bytes(&stream->blocks[block]);
+
+    full = full || wanted_bytes + bytes > stream->budget;
+    stream->wanted[block] = !full;
+
+    if (!full)
+      wanted_bytes += bytes;
+  }
+
+  for (uint32_t i = 0; i < num_blocks; ++i) {
+    if (!stream->wanted[i])
+      evict_block(stream, i);
+  }
+
+  // bounded per frame, so moving the camera doesn't stall a frame
+  size_t num_loads = 0;
+
+  for (uint32_t i = 0; i < num_blocks && num_loads < MESH_STREAM_LOADS_PER_FRAME; ++i) {
+    const uint32_t block = stream->order[i].block;
+
+    if (stream->wanted[block] && !stream->resident[block].faces) {
+      load_block(stream, block);
+      ++num_loads;
+    }
+  }
+}
+
+void mesh_stream_close(mesh_stream_t* stream)
+{
+  if (!stream) return;
+
+  for (uint32_t i = 0; stream->resident && i < stream->header.num_blocks; ++i)
+    mesh_free(&stream->resident[i]);
+
+  free(stream->resident);
+  free(stream->wanted);
+  free(stream->order);
+  file_map_close(&stream->map);
+
+  memset(stream, 0, sizeof(*stream));
+}
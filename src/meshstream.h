@@ -0,0 +1,62 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "filemap.h"
+#include "types.h"
+
+// Out-of-core meshes: the faces are split into spatially coherent blocks of at most
+// MESH_BLOCK_MAX_FACES, each stored with its own vertices and bounds in <src>.meshblocks.
+// The stream keeps only the blocks closest to the camera resident, within a memory budget.
+
+#define MESH_STREAM_EXTENSION ".meshblocks"
+#define MESH_STREAM_VERSION 3
+
+typedef struct mesh_stream_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_blocks;
+  uint64_t source_size;
+  int64_t source_mtime;
+  vec3_t bounds_min;
+  vec3_t bounds_max;
+} mesh_stream_header_t;
+
+// at offset: num_vertices packed_vertex_t quantized to the block, then face_bytes of faces
+// compressed with mesh_encode_faces(), indices are block local
+typedef struct mesh_block {
+  vec3_t bounds_min;
+  vec3_t bounds_max;
+  vertex_quantization_t quantization;
+  uint64_t offset;
+  uint32_t num_vertices;
+  uint32_t num_faces;
+  uint32_t face_bytes;
+  uint32_t reserved;
+} mesh_block_t;
+
+typedef struct mesh_stream {
+  file_map_t map;
+  mesh_stream_header_t header;
+  const mesh_block_t* blocks;
+
+  // one mesh per block, with NULL arrays while the block isn't resident
+  mesh_t* resident;
+  bool* wanted;
+  struct mesh_block_order* order;
+
+  size_t resident_bytes;
+  size_t budget;
+} mesh_stream_t;
+
+// scans an obj or ply file into <source_path>.meshblocks, without loading the whole mesh
+bool mesh_stream_build(const char* source_path);
+
+// opens <source_path>.meshblocks, building it first if it's missing or outdated
+bool mesh_stream_open(mesh_stream_t* stream, const char* source_path, const size_t budget);
+void mesh_stream_close(mesh_stream_t* stream);
+
+// pages blocks in and out by distance to camera, with transform placing the mesh in the world
+void mesh_stream_update(mesh_stream_t* stream, const mat4_t* transform, const vec3_t* camera);
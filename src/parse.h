@@ -0,0 +1,146 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Locale independent number parsing on [cur, end) character ranges, which don't need to be
+// null terminated (e.g. mapped files). Leading spaces are skipped, and on success the cursor is 
+// advanced past the number.
+
+static inline bool parse_is_digit(const char c)
+{
+  return (unsigned char)(c - '0') < 10;
+}
+
+static inline const char* parse_skip_spaces(const char* cur, const char* end)
+{
+  while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r'))
+    ++cur;
+
+  return cur;
+}
+
+// returns the position after the next '\n', or end
+static inline const char* parse_skip_line(const char* cur, const char* end)
+{
+  const char* newline = cur < end ? memchr(cur, '\n', (size_t)(end - cur)) : NULL;
+  return newline ? newline + 1 : end;
+}
+
+static inline double parse_pow10(int exponent)
+{
+  static const double table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  const bool negative = exponent < 0;
+  double result = 1.0;
+
+  if (negative) exponent = -exponent;
+
+  while (exponent > 22) {
+    result *= table[22];
+    exponent -= 22;
+  }
+
+  result *= table[exponent];
+
+  return negative ? 1.0 / result : result;
+}
+
+static inline bool parse_int(const char** cur, const char* end, int64_t* out)
+{
+  const char* p = parse_skip_spaces(*cur, end);
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  if (p == end || !parse_is_digit(*p)) return false;
+
+  int64_t value = 0;
+
+  while (p < end && parse_is_digit(*p)) {
+    value = value * 10 + (*p - '0');
+    ++p;
+  }
+
+  *out = negative ? -value : value;
+  *cur = p;
+
+  return true;
+}
+
+static inline bool parse_float(const char** cur, const char* end, float* out)
+{
+  const char* p = parse_skip_spaces(*cur, end);
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  // up to 19 significant digits fit into the mantissa, the rest only shift the exponent
+  uint64_t mantissa = 0;
+  int significant = 0;
+  int exponent = 0;
+  bool any_digits = false;
+
+  while (p < end && parse_is_digit(*p)) {
+    if (significant < 19) {
+      mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+      significant += mantissa != 0;
+    }
+
+    else ++exponent;
+
+    any_digits = true;
+    ++p;
+  }
+
+  if (p < end && *p == '.') {
+    ++p;
+
+    while (p < end && parse_is_digit(*p)) {
+      if (significant < 19) {
+        mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        significant += mantissa != 0;
+        --exponent;
+      }
+
+      any_digits = true;
+      ++p;
+    }
+  }
+
+  if (!any_digits) return false;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* exp_start = p + 1;
+    int64_t exp_value = 0;
+
+    if (exp_start < end && *exp_start != ' ' && parse_int(&exp_start, end, &exp_value)) {
+      exp_value = exp_value > 400 ? 400 : exp_value;
+      exp_value = exp_value < -400 ? -400 : exp_value;
+      exponent += (int)exp_value;
+      p = exp_start;
+    }
+  }
+
+  double value = (double)mantissa;
+
+  if (mantissa != 0 && exponent != 0)
+    value *= parse_pow10(exponent);
+
+  *out = (float)(negative ? -value : value);
+  *cur = p;
+
+  return true;
+}
@@ -0,0 +1,296 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "meshquant.h"
+#include "shadecache.h"
+#include "texture.h"
+#include "texturestream.h"
+#include "vector.h"
+
+// texels next to faces that take their neighbours' normals, so filtering doesn't blend in unlit ones
+#define SHADE_CACHE_DILATION 2
+
+// Texels that faces facing different ways share, beyond those along their common edges. If more
+// than 1 / SHADE_CACHE_MAX_OVERLAP of the covered ones are, the uvs are mirrored or reused, e.g. on
+// each side of a cube, and can't hold the lighting.
+#define SHADE_CACHE_OVERLAP_COS 0.5f
+#define SHADE_CACHE_MAX_OVERLAP 8
+
+static size_t atlas_texels(const shade_cache_t* cache)
+{
+  return (size_t)cache->size * cache->size;
+}
+
+static bool is_covered(const vec3_t* normal)
+{
+  return normal->x != 0.f || normal->y != 0.f || normal->z != 0.f;
+}
+
+// uvs outside of [0, 1) wrap around, like the sampler's
+static vec3_t* atlas_normal(shade_cache_t* cache, const int32_t x, const int32_t y)
+{
+  const uint32_t mask = cache->size - 1;
+  return &cache->normals[(size_t)((uint32_t)y & mask) * cache->size + ((uint32_t)x & mask)];
+}
+
+static void set_normal(shade_cache_t* cache, const int32_t x, const int32_t y, const vec3_t* normal)
+{
+  vec3_t* texel = atlas_normal(cache, x, y);
+
+  cache->num_covered += !is_covered(texel);
+  cache->num_overlapping += is_covered(texel) && vec3_dot(texel, normal) < SHADE_CACHE_OVERLAP_COS;
+  *texel = *normal;
+}
+
+static float edge_function(const vec2_t* a, const vec2_t* b, const float x, const float y)
+{
+  return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+// the texels whose centers the face covers in uv space get its interpolated vertex normal, or its
+// face normal if the vertices have none. Faces smaller than a texel still get the one they're in.
+static void bake_face(shade_cache_t* cache, const mesh_t* mesh, const face_t* face)
+{
+  const uint32_t indices[3] = { face->a, face->b, face->c };
+  vertex_t vertices[3];
+  vec2_t p[3];
+
+  for (size_t i = 0; i < 3; ++i) {
+    vertices[i] = mesh_vertex(mesh, indices[i]);
+    p[i] = (vec2_t) { vertices[i].uv.u * (float)cache->size, vertices[i].uv.v * (float)cache->size };
+  }
+
+  const float area = edge_function(&p[0], &p[1], p[2].x, p[2].y);
+  if (area == 0.f) return;
+
+  const vec3_t ab = vec3_sub(&vertices[1].position, &vertices[0].position);
+  const vec3_t ac = vec3_sub(&vertices[2].position, &vertices[0].position);
+  vec3_t face_normal = vec3_cross(&ab, &ac);
+
+  if (vec3_mag(&face_normal) > 0.f)
+    vec3_normalize(&face_normal);
+
+  const float min_x = MIN(MIN(p[0].x, p[1].x), p[2].x);
+  const float min_y = MIN(MIN(p[0].y, p[1].y), p[2].y);
+  const int32_t x0 = (int32_t)floorf(min_x);
+  const int32_t y0 = (int32_t)floorf(min_y);
+
+  // faces spanning more than the atlas cover all of it, since it repeats
+  const int32_t x1 = MIN((int32_t)ceilf(MAX(MAX(p[0].x, p[1].x), p[2].x)), x0 + (int32_t)cache->size);
+  const int32_t y1 = MIN((int32_t)ceilf(MAX(MAX(p[0].y, p[1].y), p[2].y)), y0 + (int32_t)cache->size);
+
+  const float inv_area = 1.f / area;
+  bool covered = false;
+
+  for (int32_t y = y0; y < y1; ++y) {
+    for (int32_t x = x0; x < x1; ++x) {
+      const float cx = (float)x + 0.5f;
+      const float cy = (float)y + 0.5f;
+      const float w0 = edge_function(&p[1], &p[2], cx, cy) * inv_area;
+      const float w1 = edge_function(&p[2], &p[0], cx, cy) * inv_area;
+      const float w2 = edge_function(&p[0], &p[1], cx, cy) * inv_area;
+
+      if (w0 < 0.f || w1 < 0.f || w2 < 0.f) continue;
+
+      vec3_t normal = vec3_scaled(&vertices[0].normal, w0);
+      const vec3_t n1 = vec3_scaled(&vertices[1].normal, w1);
+      const vec3_t n2 = vec3_scaled(&vertices[2].normal, w2);
+
+      normal = vec3_add(&normal, &n1);
+      normal = vec3_add(&normal, &n2);
+
+      if (vec3_mag(&normal) > 1e-6f) vec3_normalize(&normal);
+      else normal = face_normal;
+
+      set_normal(cache, x, y, &normal);
+      covered = true;
+    }
+  }
+
+  if (!covered && is_covered(&face_normal)) {
+    const float cx = (p[0].x + p[1].x + p[2].x) / 3.f;
+    const float cy = (p[0].y + p[1].y + p[2].y) / 3.f;
+
+    set_normal(cache, (int32_t)floorf(cx), (int32_t)floorf(cy), &face_normal);
+  }
+}
+
+static void dilate(shade_cache_t* cache)
+{
+  const size_t num_texels = atlas_texels(cache);
+  const int32_t size = (int32_t)cache->size;
+  bool* covered = malloc(sizeof(bool) * num_texels);
+  if (!covered) exit(EXIT_FAILURE);
+
+  const int32_t offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+  for (int pass = 0; pass < SHADE_CACHE_DILATION; ++pass) {
+    for (size_t i = 0; i < num_texels; ++i)
+      covered[i] = is_covered(&cache->normals[i]);
+
+    for (int32_t y = 0; y < size; ++y) {
+      for (int32_t x = 0; x < size; ++x) {
+        vec3_t* texel = atlas_normal(cache, x, y);
+        if (is_covered(texel)) continue;
+
+        for (size_t i = 0; i < 4; ++i) {
+          const int32_t nx = x + offsets[i][0];
+          const int32_t ny = y + offsets[i][1];
+
+          if (covered[(size_t)(ny & (size - 1)) * cache->size + (size_t)(nx & (size - 1))]) {
+            *texel = *atlas_normal(cache, nx, ny);
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  free(covered);
+}
+
+// the albedo's base level in texels, or more if that leaves fewer than SHADE_CACHE_FACE_TEXELS
+// across the average face, assuming the faces fill the uv square
+static uint32_t atlas_size(const tex2_t* albedo, const size_t num_faces)
+{
+  const float face_size = sqrtf((float)num_faces) * SHADE_CACHE_FACE_TEXELS;
+  const float wanted = albedo ? MAX(MAX(albedo->size.x, albedo->size.y), face_size) : face_size;
+  uint32_t size = SHADE_CACHE_MIN_SIZE;
+
+  while (size < SHADE_CACHE_MAX_SIZE && (float)size < wanted)
+    size <<= 1;
+
+  return size;
+}
+
+void shade_cache_init(shade_cache_t* cache, const mesh_t* mesh, const uint32_t material, const uint32_t* faces,
+  const size_t num_faces, const tex2_t* albedo)
+{
+  if (!cache || !mesh) return;
+
+  memset(cache, 0, sizeof(*cache));
+
+  if (num_faces == 0) return;
+
+  cache->size = atlas_size(albedo, num_faces);
+  cache->normals = calloc(atlas_texels(cache), sizeof(vec3_t));
+  cache->next_row = cache->size;
+
+  if (!cache->normals) exit(EXIT_FAILURE);
+
+  for (size_t i = 0; i < num_faces; ++i)
+    bake_face(cache, mesh, &mesh->faces[faces[i]]);
+
+  const bool overlapping = cache->num_overlapping > cache->num_covered / SHADE_CACHE_MAX_OVERLAP;
+
+  if (cache->num_covered > 0 && !overlapping) {
+    dilate(cache);
+    return;
+  }
+
+  if (overlapping)
+    fprintf(stderr, "Faces of material %d share their uvs, they're drawn without texture-space shading.\n",
+      material == MATERIAL_NONE ? -1 : (int)material);
+
+  // nothing to shade, e.g. for faces that are all degenerate in uv space
+  shade_cache_free(cache);
+}
+
+void shade_cache_free(shade_cache_t* cache)
+{
+  if (!cache) return;
+
+  free(cache->normals);
+  free(cache->pending);
+  texture_free(&cache->atlas);
+
+  memset(cache, 0, sizeof(*cache));
+}
+
+// the same light factor as flat shading, texels no face covers keep the albedo
+static color_t shade_texel(const color_t albedo, const vec3_t* normal, const vec3_t* light)
+{
+  if (!is_covered(normal)) return albedo;
+
+  const float factor = (vec3_dot(normal, light) + 1.f) * 0.5f;
+  return color_lerp(albedo & 0xFF000000, albedo, (uint32_t)(MIN(MAX(factor, 0.f), 1.f) * 256.f));
+}
+
+static color_t sample_albedo(const tex2_t* albedo, const float u, const float v, const float lod)
+{
+  if (albedo->stream)
+    return texture_stream_sample(albedo->stream, u, v, lod, true, true);
+
+  return texture_sample_lod(albedo, u, v, lod, true, true);
+}
+
+// the atlas views pending, its tiled copy with mips is owned
+static void finish_pass(shade_cache_t* cache)
+{
+  texture_free(&cache->atlas);
+  texture_init(&cache->atlas, cache->pending, cache->size, cache->size, cache->size, false, false);
+  texture_swizzle(&cache->atlas);
+
+  ++cache->passes;
+}
+
+size_t shade_cache_update(shade_cache_t* cache, const tex2_t* albedo, const vec3_t* light, const size_t max_texels)
+{
+  if (!cache || !cache->normals || cache->num_covered == 0 || !albedo || albedo->num_levels == 0 ||
+    max_texels == 0)
+    return 0;
+
+  const bool same_albedo = albedo == cache->albedo && albedo->levels[0].width == cache->albedo_width;
+
+  // a pass runs with the inputs it started with, unless the albedo is gone
+  if (cache->next_row == cache->size || !same_albedo) {
+    if (cache->atlas.num_levels > 0 && same_albedo && vec3_dot(light, &cache->light) >= SHADE_CACHE_LIGHT_TOLERANCE)
+      return 0;
+
+    cache->next_row = 0;
+    cache->light = *light;
+    cache->albedo = albedo;
+    cache->albedo_width = albedo->levels[0].width;
+  }
+
+  // allocated with the first pass, caches that are never shaded don't need it
+  if (!cache->pending) {
+    cache->pending = malloc(sizeof(color_t) * atlas_texels(cache));
+    if (!cache->pending) exit(EXIT_FAILURE);
+  }
+
+  // the albedo level whose texels match the atlas's in size
+  const uint32_t size = cache->size;
+  const float lod = MAX(log2f(MAX(albedo->size.x, albedo->size.y) / (float)size), 0.f);
+  const uint32_t num_rows = (uint32_t)MIN(MAX(max_texels / size, (size_t)1), (size_t)(size - cache->next_row));
+  const float texel_size = 1.f / (float)size;
+
+  for (uint32_t y = cache->next_row; y < cache->next_row + num_rows; ++y) {
+    const float v = ((float)y + 0.5f) * texel_size;
+    const vec3_t* normals = &cache->normals[(size_t)y * size];
+    color_t* row = &cache->pending[(size_t)y * size];
+
+    for (uint32_t x = 0; x < size; ++x) {
+      const color_t color = sample_albedo(albedo, ((float)x + 0.5f) * texel_size, v, lod);
+      row[x] = shade_texel(color, &normals[x], &cache->light);
+    }
+  }
+
+  cache->next_row += num_rows;
+
+  if (cache->next_row == size)
+    finish_pass(cache);
+
+  return (size_t)num_rows * size;
+}
+
+const tex2_t* shade_cache_atlas(const shade_cache_t* cache)
+{
+  return cache && cache->atlas.num_levels > 0 ? &cache->atlas : NULL;
+}
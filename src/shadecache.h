@@ -0,0 +1,51 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "types.h"
+
+// Texture-space shading: the faces of a mesh are lit per texel of an atlas laid out like their uvs,
+// which screen pixels then only sample. A pass over the atlas shades a bounded number of texels per
+// call and is only started when the inputs changed, so the cost of lighting depends neither on the
+// frame rate, nor on the resolution, nor on the camera. Faces sharing uvs share their shading.
+
+typedef struct shade_cache {
+  // the atlas is size texels squared, a power of two
+  uint32_t size;
+
+  // object space normal per texel, in rows, zero where no face covers the texel
+  vec3_t* normals;
+  size_t num_covered;
+  size_t num_overlapping;
+
+  // the pass in progress fills pending from row next_row on, size while there is none
+  color_t* pending;
+  uint32_t next_row;
+
+  // inputs of the pass in progress, or of the atlas if there is none
+  vec3_t light;
+  const tex2_t* albedo;
+  uint32_t albedo_width;
+
+  // the last finished pass, with its mips
+  tex2_t atlas;
+  uint64_t passes;
+} shade_cache_t;
+
+// Rasterizes the normals of the faces of material, given by their indices, into uv space, at a size
+// derived from the albedo and the number of faces. MATERIAL_NONE stands for faces without one of the
+// mesh's materials. Faces that share uvs leave the cache empty, and are drawn unlit.
+void shade_cache_init(shade_cache_t* cache, const mesh_t* mesh, const uint32_t material, const uint32_t* faces,
+  const size_t num_faces, const tex2_t* albedo);
+void shade_cache_free(shade_cache_t* cache);
+
+// Continues the pass in progress, or starts one if albedo or light, a unit direction in the mesh's
+// object space, changed. Shades as many whole rows as fit into max_texels, at least one unless it's
+// 0, and returns the texels shaded. A finished pass replaces the atlas.
+size_t shade_cache_update(shade_cache_t* cache, const tex2_t* albedo, const vec3_t* light, const size_t max_texels);
+
+// NULL until the first pass is finished
+const tex2_t* shade_cache_atlas(const shade_cache_t* cache);
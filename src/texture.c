@@ -1,39 +1,657 @@
 // Copyright 2025 Sebastian Cyliax
 
+#include <math.h>
 #include <memory.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <SDL_image.h>
 
 #include "defs.h"
 #include "texture.h"
+#include "texturecache.h"
 
-void  load_texture(tex2_t* texture, const char* filepath) {
-  SDL_Surface* tempSurface = IMG_Load(filepath);
-  
-  if (tempSurface == NULL) {
-    printf("Error loading surface: %s\n", SDL_GetError());
-    return;
-  }
+TEXTURE_THREAD_LOCAL texture_block_cache_t texture_block_cache;
+
+static SDL_atomic_t next_level_id;
 
+static void load_texture_surface(tex2_t* texture, SDL_Surface* tempSurface) {
   SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(tempSurface, PIXELFORMAT, 0);
   
   if (formattedSurface == NULL) {
     printf("Error converting surface: %s\n", SDL_GetError());
+    SDL_FreeSurface(tempSurface);
     return;
   }
 
   SDL_LockSurface(formattedSurface);
 
-  texture->size.x = (float)formattedSurface->w;
-  texture->size.y = (float)formattedSurface->h;
+  const uint32_t width = (uint32_t)formattedSurface->w;
+  const uint32_t height = (uint32_t)formattedSurface->h;
+  color_t* data = malloc(sizeof(color_t) * width * height);
 
-  // texture->data = (color_t*)formattedSurface->pixels;
+  if (!data) exit(EXIT_FAILURE);
 
-  color_t* pixels = (color_t*)formattedSurface->pixels;
+  // the surface's pitch may pad its rows, the copy is packed
+  for (uint32_t y = 0; y < height; ++y) {
+    const char* row = (const char*)formattedSurface->pixels + (size_t)y * (size_t)formattedSurface->pitch;
+    memcpy(data + (size_t)y * width, row, sizeof(color_t) * width);
+  }
+
+  texture_free(texture);
+  texture_init(texture, data, width, height, width, false, true);
+  texture_swizzle(texture);
 
-  memcpy(texture->data, pixels, sizeof(color_t) * TEXTURE_SIZE * TEXTURE_SIZE/*TEXTURE_WIDTH * TEXTURE_HEIGHT*/);
+#if TEXTURE_COMPRESS
+  if ((size_t)width * height >= TEXTURE_COMPRESS_MIN_TEXELS)
+    texture_compress(texture);
+#endif
 
   SDL_UnlockSurface(formattedSurface);
   SDL_FreeSurface(formattedSurface);
   SDL_FreeSurface(tempSurface);
 }
+
+static bool is_pow2(const uint32_t x) {
+  return x > 0 && (x & (x - 1)) == 0;
+}
+
+static uint32_t log2_pow2(uint32_t x) {
+  uint32_t log2 = 0;
+
+  while (x > 1) {
+    x >>= 1;
+    ++log2;
+  }
+
+  return log2;
+}
+
+static tex2_level_t make_level(const color_t* data, const uint32_t width, const uint32_t height, 
+  const uint32_t stride, const bool pow2) {
+  tex2_level_t level = {
+    .data = data,
+    .size = { (float)width, (float)height },
+    .width = width,
+    .height = height,
+    .stride = stride
+  };
+
+  if (pow2) {
+    level.mask_x = width - 1;
+    level.mask_y = height - 1;
+    level.stride_shift = log2_pow2(stride);
+    level.tile_bits = MIN(log2_pow2(MIN(width, height)), TEXTURE_TILE_BITS);
+    level.tile_mask = (1u << level.tile_bits) - 1;
+    level.tiles_shift = log2_pow2(width) - level.tile_bits;
+  }
+
+  return level;
+}
+
+static size_t texel_offset(const tex2_level_t* level, const bool tiled, const uint32_t x, const uint32_t y) {
+  return tiled ? texture_tiled_offset(level, x, y) : (size_t)y * level->stride + x;
+}
+
+// per channel and rounded, red and blue, then alpha and green, two channels per 32-bit sum
+static color_t average_texels(const color_t* texels) {
+  uint32_t rb = 0x00020002;
+  uint32_t ag = 0x00020002;
+
+  for (int i = 0; i < 4; ++i) {
+    rb += texels[i] & 0x00FF00FF;
+    ag += (texels[i] >> 8) & 0x00FF00FF;
+  }
+
+  return ((rb >> 2) & 0x00FF00FF) | (((ag >> 2) & 0x00FF00FF) << 8);
+}
+
+// each texel averages the 2x2 texels above it; the last row and column of odd sized levels only
+// contribute through their neighbours' clamped reads
+static void downsample(const tex2_level_t* src, const tex2_level_t* dst, const bool tiled) {
+  color_t* out = (color_t*)dst->data;
+
+  for (uint32_t y = 0; y < dst->height; ++y) {
+    const uint32_t y0 = 2 * y;
+    const uint32_t y1 = MIN(2 * y + 1, src->height - 1);
+
+    for (uint32_t x = 0; x < dst->width; ++x) {
+      const uint32_t x0 = 2 * x;
+      const uint32_t x1 = MIN(2 * x + 1, src->width - 1);
+      const color_t texels[4] = {
+        src->data[texel_offset(src, tiled, x0, y0)], 
+        src->data[texel_offset(src, tiled, x1, y0)],
+        src->data[texel_offset(src, tiled, x0, y1)], 
+        src->data[texel_offset(src, tiled, x1, y1)]
+      };
+
+      out[texel_offset(dst, tiled, x, y)] = average_texels(texels);
+    }
+  }
+}
+
+void texture_downsample_row(const color_t* row0, const color_t* row1, const uint32_t width, color_t* out) {
+  for (uint32_t x = 0; x < MAX(width / 2, 1); ++x) {
+    const uint32_t x0 = 2 * x;
+    const uint32_t x1 = MIN(2 * x + 1, width - 1);
+    const color_t texels[4] = { row0[x0], row0[x1], row1[x0], row1[x1] };
+
+    out[x] = average_texels(texels);
+  }
+}
+
+// the levels below the base, packed one after another
+static size_t mip_texels(const uint32_t base_width, const uint32_t base_height, uint32_t* num_levels) {
+  uint32_t width = base_width;
+  uint32_t height = base_height;
+  size_t num_texels = 0;
+
+  *num_levels = 1;
+
+  while ((width > 1 || height > 1) && *num_levels < TEXTURE_MAX_LEVELS) {
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    num_texels += (size_t)width * height;
+    ++*num_levels;
+  }
+
+  return num_texels;
+}
+
+static void generate_mips(tex2_t* texture) {
+  uint32_t num_levels = 1;
+  const size_t num_texels = mip_texels(texture->levels[0].width, texture->levels[0].height, &num_levels);
+
+  if (num_levels == 1) return;
+
+  texture->mip_data = malloc(sizeof(color_t) * num_texels);
+  if (!texture->mip_data) exit(EXIT_FAILURE);
+
+  color_t* data = texture->mip_data;
+
+  for (uint32_t i = 1; i < num_levels; ++i) {
+    const tex2_level_t* src = &texture->levels[i - 1];
+    const uint32_t width = MAX(src->width / 2, 1);
+    const uint32_t height = MAX(src->height / 2, 1);
+
+    texture->levels[i] = make_level(data, width, height, width, texture->pow2);
+    downsample(src, &texture->levels[i], texture->tiled);
+    data += (size_t)width * height;
+  }
+
+  texture->num_levels = num_levels;
+}
+
+void texture_init(tex2_t* texture, const color_t* data, const uint32_t width, const uint32_t height, 
+  const uint32_t stride, const bool tiled, const bool owned) {
+  memset(texture, 0, sizeof(*texture));
+
+  texture->size = (vec2_t) { (float)width, (float)height };
+  texture->pow2 = is_pow2(width) && is_pow2(height) && is_pow2(stride);
+  texture->tiled = tiled && texture->pow2;
+  texture->owned = owned;
+  texture->num_levels = 1;
+  texture->levels[0] = make_level(data, width, height, stride, texture->pow2);
+
+  generate_mips(texture);
+}
+
+static uint32_t level_id(void) {
+  uint32_t id;
+
+  // 0 tags empty cache slots
+  do id = (uint32_t)SDL_AtomicAdd(&next_level_id, 1) + 1; while (id == 0);
+
+  return id;
+}
+
+static size_t level_blocks(const uint32_t width, const uint32_t height) {
+  return (size_t)((width + 3) / 4) * ((height + 3) / 4);
+}
+
+size_t texture_block_count(uint32_t width, uint32_t height) {
+  size_t num_blocks = level_blocks(width, height);
+  uint32_t num_levels = 1;
+
+  while ((width > 1 || height > 1) && num_levels < TEXTURE_MAX_LEVELS) {
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    num_blocks += level_blocks(width, height);
+    ++num_levels;
+  }
+
+  return num_blocks;
+}
+
+static tex2_level_t make_block_level(const uint64_t* blocks, const uint32_t width, const uint32_t height) {
+  tex2_level_t level = make_level(NULL, width, height, width, true);
+
+  level.blocks = blocks;
+  level.blocks_shift = log2_pow2(MAX(width / 4, 1));
+  level.id = level_id();
+
+  return level;
+}
+
+static color_t color_565(const uint32_t c) {
+  const uint32_t r = (c >> 11) & 31;
+  const uint32_t g = (c >> 5) & 63;
+  const uint32_t b = c & 31;
+
+  return 0xFF000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+static uint32_t to_565(const int32_t r, const int32_t g, const int32_t b) {
+  return (uint32_t)((r * 31 + 127) / 255) << 11 | (uint32_t)((g * 63 + 127) / 255) << 5 | 
+    (uint32_t)((b * 31 + 127) / 255);
+}
+
+// (2a + b) / 3 per color channel, opaque; x * 21846 >> 16 is x / 3 for all sums up to 765
+static color_t color_third(const color_t a, const color_t b) {
+  const uint32_t r = ((2 * ((a >> 16) & 0xFF) + ((b >> 16) & 0xFF)) * 21846) >> 16;
+  const uint32_t g = ((2 * ((a >> 8) & 0xFF) + ((b >> 8) & 0xFF)) * 21846) >> 16;
+  const uint32_t bl = ((2 * (a & 0xFF) + (b & 0xFF)) * 21846) >> 16;
+
+  return 0xFF000000 | (r << 16) | (g << 8) | bl;
+}
+
+// four colors if c0 > c1, otherwise three and transparent black
+static void block_palette(const uint32_t c0, const uint32_t c1, color_t* palette) {
+  palette[0] = color_565(c0);
+  palette[1] = color_565(c1);
+
+  if (c0 > c1) {
+    palette[2] = color_third(palette[0], palette[1]);
+    palette[3] = color_third(palette[1], palette[0]);
+  } else {
+    // the average of two channels at a time, both are opaque
+    palette[2] = 0xFF000000 | ((((palette[0] & 0x00FEFEFE) >> 1) + ((palette[1] & 0x00FEFEFE) >> 1) + 
+      (palette[0] & palette[1] & 0x00010101)));
+    palette[3] = 0;
+  }
+}
+
+void texture_decode_block(const uint64_t block, color_t* texels) {
+  color_t palette[4];
+  uint32_t indices = (uint32_t)(block >> 32);
+
+  block_palette((uint32_t)block & 0xFFFF, (uint32_t)(block >> 16) & 0xFFFF, palette);
+
+  for (int i = 0; i < 16; ++i, indices >>= 2)
+    texels[i] = palette[indices & 3];
+}
+
+static int32_t channel(const color_t color, const int i) {
+  return (int32_t)((color >> (16 - 8 * i)) & 0xFF);
+}
+
+// The endpoints are the extremes of the opaque texels along their principal axis, moved inwards
+// by 1/16 of the range, since the extremes themselves are rarely hit exactly after quantization.
+static uint64_t encode_block(const color_t* texels) {
+  float mean[3] = { 0.f, 0.f, 0.f };
+  uint32_t num_opaque = 0;
+
+  for (int i = 0; i < 16; ++i) {
+    if ((texels[i] >> 24) < 128) continue;
+
+    for (int c = 0; c < 3; ++c)
+      mean[c] += (float)channel(texels[i], c);
+    ++num_opaque;
+  }
+
+  // three color mode with every index at transparent
+  if (num_opaque == 0) return 0xFFFFFFFF00000000ull;
+
+  for (int c = 0; c < 3; ++c)
+    mean[c] /= (float)num_opaque;
+
+  float cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+
+  for (int i = 0; i < 16; ++i) {
+    if ((texels[i] >> 24) < 128) continue;
+
+    const float r = (float)channel(texels[i], 0) - mean[0];
+    const float g = (float)channel(texels[i], 1) - mean[1];
+    const float b = (float)channel(texels[i], 2) - mean[2];
+
+    cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+    cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+  }
+
+  // power iteration, a few steps are enough to separate the endpoints
+  float axis[3] = { 1.f, 1.f, 1.f };
+
+  for (int step = 0; step < 4; ++step) {
+    const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    const float length = MAX(MAX(fabsf(x), fabsf(y)), fabsf(z));
+
+    if (length < 1e-6f) break;
+
+    axis[0] = x / length;
+    axis[1] = y / length;
+    axis[2] = z / length;
+  }
+
+  color_t lo = 0, hi = 0;
+  float lo_dot = 1e30f, hi_dot = -1e30f;
+
+  for (int i = 0; i < 16; ++i) {
+    if ((texels[i] >> 24) < 128) continue;
+
+    const float dot = (float)channel(texels[i], 0) * axis[0] + (float)channel(texels[i], 1) * axis[1] + 
+      (float)channel(texels[i], 2) * axis[2];
+
+    if (dot < lo_dot) { lo_dot = dot; lo = texels[i]; }
+    if (dot > hi_dot) { hi_dot = dot; hi = texels[i]; }
+  }
+
+  int32_t lo_rgb[3], hi_rgb[3];
+
+  for (int c = 0; c < 3; ++c) {
+    const int32_t inset = (channel(hi, c) - channel(lo, c)) / 16;
+
+    lo_rgb[c] = channel(lo, c) + inset;
+    hi_rgb[c] = channel(hi, c) - inset;
+  }
+
+  uint32_t c0 = to_565(hi_rgb[0], hi_rgb[1], hi_rgb[2]);
+  uint32_t c1 = to_565(lo_rgb[0], lo_rgb[1], lo_rgb[2]);
+  const bool transparent = num_opaque < 16;
+
+  // the order of the endpoints selects the mode, three colors are needed for transparent texels
+  if ((transparent && c0 > c1) || (!transparent && c0 < c1)) {
+    const uint32_t swap = c0;
+    c0 = c1;
+    c1 = swap;
+  }
+
+  // equal endpoints of opaque blocks would select three colors, index 0 is the color anyway
+  if (!transparent && c0 == c1) return c0 | (uint64_t)c1 << 16;
+
+  color_t palette[4];
+  block_palette(c0, c1, palette);
+
+  const int num_colors = transparent ? 3 : 4;
+  uint64_t indices = 0;
+
+  for (int i = 0; i < 16; ++i) {
+    uint64_t index = 3;
+
+    if ((texels[i] >> 24) >= 128) {
+      int32_t best = INT32_MAX;
+
+      for (int p = 0; p < num_colors; ++p) {
+        int32_t distance = 0;
+
+        for (int c = 0; c < 3; ++c) {
+          const int32_t d = channel(texels[i], c) - channel(palette[p], c);
+          distance += d * d;
+        }
+
+        if (distance < best) {
+          best = distance;
+          index = (uint64_t)p;
+        }
+      }
+    }
+
+    indices |= index << (2 * i);
+  }
+
+  return c0 | (uint64_t)c1 << 16 | indices << 32;
+}
+
+// small levels repeat their texels to fill a block
+static void compress_level(const tex2_level_t* src, const bool tiled, uint64_t* blocks) {
+  const uint32_t blocks_x = MAX(src->width / 4, 1);
+  const uint32_t blocks_y = MAX(src->height / 4, 1);
+  color_t texels[16];
+
+  for (uint32_t by = 0; by < blocks_y; ++by) {
+    for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+      for (uint32_t i = 0; i < 16; ++i) {
+        const uint32_t x = (bx * 4 + (i & 3)) & src->mask_x;
+        const uint32_t y = (by * 4 + (i >> 2)) & src->mask_y;
+
+        texels[i] = src->data[texel_offset(src, tiled, x, y)];
+      }
+
+      blocks[(size_t)by * blocks_x + bx] = encode_block(texels);
+    }
+  }
+}
+
+void texture_compress(tex2_t* texture) {
+  if (!texture || !texture->pow2 || texture->compressed || texture->num_levels == 0) return;
+
+  const tex2_level_t* base = &texture->levels[0];
+  const size_t num_base_blocks = level_blocks(base->width, base->height);
+  const size_t num_mip_blocks = texture_block_count(base->width, base->height) - num_base_blocks;
+
+  uint64_t* base_blocks = malloc(sizeof(uint64_t) * num_base_blocks);
+  uint64_t* mip_blocks = num_mip_blocks > 0 ? malloc(sizeof(uint64_t) * num_mip_blocks) : NULL;
+
+  if (!base_blocks || (num_mip_blocks > 0 && !mip_blocks)) exit(EXIT_FAILURE);
+
+  tex2_t compressed = *texture;
+  compressed.tiled = false;
+  compressed.compressed = true;
+  compressed.owned = true;
+  compressed.mip_data = NULL;
+  compressed.mip_blocks = mip_blocks;
+
+  for (uint32_t i = 0; i < texture->num_levels; ++i) {
+    const tex2_level_t* src = &texture->levels[i];
+    uint64_t* blocks = i == 0 ? base_blocks : mip_blocks;
+
+    compress_level(src, texture->tiled, blocks);
+    compressed.levels[i] = make_block_level(blocks, src->width, src->height);
+
+    if (i > 0) mip_blocks += level_blocks(src->width, src->height);
+  }
+
+  texture_free(texture);
+  *texture = compressed;
+}
+
+size_t texture_texel_count(const uint32_t width, const uint32_t height) {
+  uint32_t num_levels = 1;
+  return (size_t)width * height + mip_texels(width, height, &num_levels);
+}
+
+void texture_init_chain(tex2_t* texture, const color_t* data, uint32_t width, uint32_t height, const bool tiled) {
+  memset(texture, 0, sizeof(*texture));
+
+  texture->size = (vec2_t) { (float)width, (float)height };
+  texture->pow2 = is_pow2(width) && is_pow2(height);
+  texture->tiled = tiled && texture->pow2;
+  texture->levels[0] = make_level(data, width, height, width, texture->pow2);
+  texture->num_levels = 1;
+
+  while ((width > 1 || height > 1) && texture->num_levels < TEXTURE_MAX_LEVELS) {
+    data += (size_t)width * height;
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    texture->levels[texture->num_levels++] = make_level(data, width, height, width, texture->pow2);
+  }
+}
+
+void texture_init_blocks(tex2_t* texture, const uint64_t* blocks, uint32_t width, uint32_t height) {
+  memset(texture, 0, sizeof(*texture));
+
+  texture->size = (vec2_t) { (float)width, (float)height };
+  texture->pow2 = true;
+  texture->compressed = true;
+  texture->levels[0] = make_block_level(blocks, width, height);
+  texture->num_levels = 1;
+
+  while ((width > 1 || height > 1) && texture->num_levels < TEXTURE_MAX_LEVELS) {
+    blocks += level_blocks(width, height);
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    texture->levels[texture->num_levels++] = make_block_level(blocks, width, height);
+  }
+}
+
+size_t texture_memory_size(const tex2_t* texture) {
+  size_t size = 0;
+
+  for (uint32_t i = 0; i < texture->num_levels; ++i) {
+    const tex2_level_t* level = &texture->levels[i];
+
+    // levels below the base are owned if they were built into mip_data or mip_blocks, not if they
+    // are views of a pack or texture cache file
+    const void* mips = texture->compressed ? (const void*)texture->mip_blocks : (const void*)texture->mip_data;
+    const void* data = texture->compressed ? (const void*)level->blocks : (const void*)level->data;
+    const bool owned = i == 0 ? texture->owned || (mips && data == mips) : mips != NULL;
+
+    if (!owned) continue;
+
+    size += texture->compressed ? sizeof(uint64_t) * level_blocks(level->width, level->height) :
+      sizeof(color_t) * (size_t)level->stride * level->height;
+  }
+
+  return size;
+}
+
+bool texture_drop_base_level(tex2_t* texture) {
+  if (!texture || !texture->owned || texture->num_levels < 2) return false;
+
+  free((void*)texture->levels[0].data);
+  free((void*)texture->levels[0].blocks);
+
+  memmove(&texture->levels[0], &texture->levels[1], sizeof(tex2_level_t) * (texture->num_levels - 1));
+  memset(&texture->levels[texture->num_levels - 1], 0, sizeof(tex2_level_t));
+
+  --texture->num_levels;
+  texture->size = texture->levels[0].size;
+
+  // the new base is part of mip_data or mip_blocks
+  texture->owned = false;
+
+  return true;
+}
+
+static void swizzle_level(const tex2_level_t* src, tex2_level_t* dst, color_t* data) {
+  *dst = *src;
+  dst->data = data;
+  dst->stride = dst->width;
+  dst->stride_shift = log2_pow2(dst->width);
+
+  for (uint32_t y = 0; y < src->height; ++y) {
+    const color_t* row = src->data + (size_t)y * src->stride;
+
+    for (uint32_t x = 0; x < src->width; ++x)
+      data[texture_tiled_offset(dst, x, y)] = row[x];
+  }
+}
+
+void texture_swizzle(tex2_t* texture) {
+  if (!texture || !texture->pow2 || texture->tiled || texture->compressed || texture->num_levels == 0) return;
+
+  const tex2_level_t* base = &texture->levels[0];
+  uint32_t num_levels = 1;
+  const size_t num_texels = mip_texels(base->width, base->height, &num_levels);
+
+  color_t* base_data = malloc(sizeof(color_t) * base->width * base->height);
+  color_t* mip_data = num_texels > 0 ? malloc(sizeof(color_t) * num_texels) : NULL;
+
+  if (!base_data || (num_texels > 0 && !mip_data)) exit(EXIT_FAILURE);
+
+  tex2_t swizzled = *texture;
+  swizzled.tiled = true;
+  swizzled.owned = true;
+  swizzled.mip_data = mip_data;
+
+  swizzle_level(&texture->levels[0], &swizzled.levels[0], base_data);
+
+  for (uint32_t i = 1; i < texture->num_levels; ++i) {
+    swizzle_level(&texture->levels[i], &swizzled.levels[i], mip_data);
+    mip_data += (size_t)texture->levels[i].width * texture->levels[i].height;
+  }
+
+  texture_free(texture);
+  *texture = swizzled;
+}
+
+void texture_free(tex2_t* texture) {
+  if (!texture) return;
+
+  if (texture->owned) {
+    free((void*)texture->levels[0].data);
+    free((void*)texture->levels[0].blocks);
+  }
+
+  free(texture->mip_data);
+  free(texture->mip_blocks);
+  file_map_close(&texture->mapping);
+  memset(texture, 0, sizeof(*texture));
+}
+
+// maps the texture cache file if it's up to date, otherwise decodes the image and writes one
+void  load_texture(tex2_t* texture, const char* filepath) {
+  if (texture_cache_load(texture, filepath))
+    return;
+
+  SDL_Surface* tempSurface = IMG_Load(filepath);
+  
+  if (tempSurface == NULL) {
+    printf("Error loading surface: %s\n", SDL_GetError());
+    return;
+  }
+
+  load_texture_surface(texture, tempSurface);
+
+  if (texture->num_levels > 0)
+    texture_cache_write(texture, filepath);
+}
+
+// png files store their size in the header, other formats would have to be decoded
+bool texture_image_size(const char* filepath, uint32_t* width, uint32_t* height) {
+  static const uint8_t signature[12] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n', 0, 0, 0, 13 };
+  uint8_t header[24];
+  FILE* file = fopen(filepath, "rb");
+
+  if (!file) return false;
+
+  const bool read = fread(header, 1, sizeof(header), file) == sizeof(header);
+  fclose(file);
+
+  if (!read || memcmp(header, signature, sizeof(signature)) != 0 || memcmp(header + 12, "IHDR", 4) != 0)
+    return false;
+
+  *width = (uint32_t)header[16] << 24 | (uint32_t)header[17] << 16 | (uint32_t)header[18] << 8 | header[19];
+  *height = (uint32_t)header[20] << 24 | (uint32_t)header[21] << 16 | (uint32_t)header[22] << 8 | header[23];
+
+  return true;
+}
+
+// decodes an image file that is already in memory, e.g. embedded in a .glb
+void load_texture_memory(tex2_t* texture, const void* data, const size_t size) {
+  SDL_Surface* tempSurface = IMG_Load_RW(SDL_RWFromConstMem(data, (int)size), 1);
+  
+  if (tempSurface == NULL) {
+    printf("Error loading surface: %s\n", SDL_GetError());
+    return;
+  }
+
+  load_texture_surface(texture, tempSurface);
+}
+
+// stands in for textures that are still loading
+void make_checker_texture(tex2_t* texture, const color_t a, const color_t b) {
+  const size_t cell = TEXTURE_SIZE / 8;
+  color_t* data = malloc(sizeof(color_t) * TEXTURE_SIZE * TEXTURE_SIZE);
+
+  if (!data) exit(EXIT_FAILURE);
+
+  for (size_t y = 0; y < TEXTURE_SIZE; ++y) {
+    for (size_t x = 0; x < TEXTURE_SIZE; ++x)
+      data[y * TEXTURE_SIZE + x] = ((x / cell + y / cell) & 1) ? b : a;
+  }
+
+  texture_free(texture);
+  texture_init(texture, data, TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_SIZE, false, true);
+  texture_swizzle(texture);
+}
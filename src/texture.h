@@ -2,6 +2,315 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "types.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_SSE2
+#include <emmintrin.h>
+#endif
+
 void load_texture(tex2_t* texture, const char* filepath);
+void load_texture_memory(tex2_t* texture, const void* data, const size_t size);
+
+// the size of a png image, without decoding it
+bool texture_image_size(const char* filepath, uint32_t* width, uint32_t* height);
+void make_checker_texture(tex2_t* texture, const color_t a, const color_t b);
+
+// Builds the mip chain in the layout of data, which is either rows of stride texels or, for 
+// power-of-two sizes only, tiled. Owned data is released by texture_free().
+void texture_init(tex2_t* texture, const color_t* data, const uint32_t width, const uint32_t height, 
+  const uint32_t stride, const bool tiled, const bool owned);
+void texture_free(tex2_t* texture);
+
+// one row of the next level from two rows of a level width texels wide, filtered like the mip chain
+void texture_downsample_row(const color_t* row0, const color_t* row1, const uint32_t width, color_t* out);
+
+// the heap memory of the texture, views of memory owned elsewhere don't count
+size_t texture_memory_size(const tex2_t* texture);
+
+// Frees an owned base level, so the next level becomes the base. Smaller levels share one
+// allocation, so only the base level can be given back, which is 3/4 of a texture's memory.
+bool texture_drop_base_level(tex2_t* texture);
+
+// reorders the levels of a power-of-two texture from rows into tiles, into owned copies
+void texture_swizzle(tex2_t* texture);
+
+// Compresses every level of a power-of-two texture to BC1 blocks, into owned copies. Each block
+// has two RGB565 endpoints and a 2-bit index per texel into the colors between them. Texels below
+// half opacity become transparent black, the others opaque.
+void texture_compress(tex2_t* texture);
+
+// the texels or BC1 blocks of all levels, one level after another
+size_t texture_texel_count(const uint32_t width, const uint32_t height);
+size_t texture_block_count(const uint32_t width, const uint32_t height);
+
+// Views levels that were built before, laid out as counted by texture_texel_count() or
+// texture_block_count(), e.g. in a texture cache file. Tiled texels have to be power-of-two sized,
+// blocks always are.
+void texture_init_chain(tex2_t* texture, const color_t* data, const uint32_t width, const uint32_t height, 
+  const bool tiled);
+void texture_init_blocks(tex2_t* texture, const uint64_t* blocks, const uint32_t width, const uint32_t height);
+
+#if defined(_MSC_VER)
+#define TEXTURE_THREAD_LOCAL __declspec(thread)
+#else
+#define TEXTURE_THREAD_LOCAL __thread
+#endif
+
+#define TEXTURE_BLOCK_CACHE_SIZE (1 << (2 * TEXTURE_BLOCK_CACHE_BITS))
+
+// Decoded blocks, direct mapped by their position in a level, so neighbouring blocks never evict
+// each other. Tags are the level's id in the upper and the block index in the lower 32 bits, ids
+// start at 1, so 0 is empty. Each thread has its own cache, nothing is shared while sampling.
+typedef struct texture_block_cache {
+  uint64_t tags[TEXTURE_BLOCK_CACHE_SIZE];
+  color_t texels[TEXTURE_BLOCK_CACHE_SIZE][16];
+} texture_block_cache_t;
+
+extern TEXTURE_THREAD_LOCAL texture_block_cache_t texture_block_cache;
+
+void texture_decode_block(const uint64_t block, color_t* texels);
+
+// texel x, y of a compressed level, decoding its block on a cache miss
+static inline color_t texture_block_texel(const tex2_level_t* level, const uint32_t x, const uint32_t y)
+{
+  const uint32_t mask = (1u << TEXTURE_BLOCK_CACHE_BITS) - 1;
+  const uint32_t bx = x >> 2;
+  const uint32_t by = y >> 2;
+  const uint32_t index = (by << level->blocks_shift) + bx;
+  const uint64_t tag = ((uint64_t)level->id << 32) | index;
+
+  // the id offsets the rows, so the two levels of trilinear samples fall into different slots
+  const uint32_t slot = (((by + level->id) & mask) << TEXTURE_BLOCK_CACHE_BITS) | (bx & mask);
+  texture_block_cache_t* cache = &texture_block_cache;
+
+  if (cache->tags[slot] != tag) {
+    texture_decode_block(level->blocks[index], cache->texels[slot]);
+    cache->tags[slot] = tag;
+  }
+
+  return cache->texels[slot][((y & 3) << 2) | (x & 3)];
+}
+
+// Texel offset in a tiled level: tiles of 2^tile_bits texels squared are stored in rows of tiles,
+// each tile's texels in rows within it, so one tile row spans only a few cache lines. The offset
+// is the sum of a part that only depends on x and one that only depends on y.
+static inline size_t texture_tiled_x(const tex2_level_t* level, const uint32_t x)
+{
+  return ((size_t)(x >> level->tile_bits) << (2 * level->tile_bits)) + (x & level->tile_mask);
+}
+
+static inline size_t texture_tiled_y(const tex2_level_t* level, const uint32_t y)
+{
+  return ((size_t)(y >> level->tile_bits) << (level->tiles_shift + 2 * level->tile_bits)) + 
+    ((y & level->tile_mask) << level->tile_bits);
+}
+
+static inline size_t texture_tiled_offset(const tex2_level_t* level, const uint32_t x, const uint32_t y)
+{
+  return texture_tiled_x(level, x) + texture_tiled_y(level, y);
+}
+
+// Nearest texel of a level at uv, repeating outside of [0, 1). The pow2, tiled and compressed
+// variants only mask and shift, the generic one wraps with modulo, which also needs a fixup for 
+// negative coordinates.
+static inline color_t texture_sample_pow2(const tex2_level_t* level, const float u, const float v)
+{
+  const uint32_t x = (uint32_t)(int32_t)(u * level->size.x) & level->mask_x;
+  const uint32_t y = (uint32_t)(int32_t)(v * level->size.y) & level->mask_y;
+
+  return level->data[(y << level->stride_shift) + x];
+}
+
+static inline color_t texture_sample(const tex2_level_t* level, const float u, const float v)
+{
+  int32_t x = (int32_t)(u * level->size.x) % (int32_t)level->width;
+  int32_t y = (int32_t)(v * level->size.y) % (int32_t)level->height;
+
+  x += x < 0 ? (int32_t)level->width : 0;
+  y += y < 0 ? (int32_t)level->height : 0;
+
+  return level->data[(size_t)y * level->stride + (size_t)x];
+}
+
+static inline color_t texture_sample_tiled(const tex2_level_t* level, const float u, const float v)
+{
+  const uint32_t x = (uint32_t)(int32_t)(u * level->size.x) & level->mask_x;
+  const uint32_t y = (uint32_t)(int32_t)(v * level->size.y) & level->mask_y;
+
+  return level->data[texture_tiled_offset(level, x, y)];
+}
+
+static inline color_t texture_sample_compressed(const tex2_level_t* level, const float u, const float v)
+{
+  const uint32_t x = (uint32_t)(int32_t)(u * level->size.x) & level->mask_x;
+  const uint32_t y = (uint32_t)(int32_t)(v * level->size.y) & level->mask_y;
+
+  return texture_block_texel(level, x, y);
+}
+
+static inline color_t texture_sample_level(const tex2_t* texture, const uint32_t level, const float u, const float v)
+{
+  if (texture->compressed) return texture_sample_compressed(&texture->levels[level], u, v);
+  if (texture->tiled) return texture_sample_tiled(&texture->levels[level], u, v);
+
+  return texture->pow2 ? texture_sample_pow2(&texture->levels[level], u, v) : 
+    texture_sample(&texture->levels[level], u, v);
+}
+
+// a + (b - a) * t per channel, t in [0, 256], two channels at a time
+static inline color_t color_lerp(const color_t a, const color_t b, const uint32_t t)
+{
+  const uint32_t a_rb = a & 0x00FF00FF;
+  const uint32_t a_ag = (a >> 8) & 0x00FF00FF;
+  const uint32_t b_rb = b & 0x00FF00FF;
+  const uint32_t b_ag = (b >> 8) & 0x00FF00FF;
+  const uint32_t rb = (a_rb * (256 - t) + b_rb * t) >> 8;
+  const uint32_t ag = (a_ag * (256 - t) + b_ag * t) >> 8;
+
+  return (rb & 0x00FF00FF) | ((ag & 0x00FF00FF) << 8);
+}
+
+// Blends the 2x2 texels t00 t10 / t01 t11 by the fractions fx and fy in [0, 128]. The four weights
+// are 14-bit fixed point and sum to 1 << 14. With SSE2 the texels are widened to 16 bits, so each
+// pmaddwd multiplies one row's pair of texels by their weights and sums them per channel.
+static inline color_t texture_bilerp(const color_t t00, const color_t t10, const color_t t01, const color_t t11, 
+  const int32_t fx, const int32_t fy)
+{
+  const int32_t w00 = (128 - fx) * (128 - fy);
+  const int32_t w10 = fx * (128 - fy);
+  const int32_t w01 = (128 - fx) * fy;
+  const int32_t w11 = fx * fy;
+
+#ifdef TEXTURE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i top = _mm_unpacklo_epi8(
+    _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)t00), _mm_cvtsi32_si128((int)t10)), zero);
+  const __m128i bottom = _mm_unpacklo_epi8(
+    _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)t01), _mm_cvtsi32_si128((int)t11)), zero);
+
+  __m128i sum = _mm_add_epi32(
+    _mm_madd_epi16(top, _mm_set1_epi32((w10 << 16) | w00)),
+    _mm_madd_epi16(bottom, _mm_set1_epi32((w11 << 16) | w01)));
+
+  sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << 13)), 14);
+  sum = _mm_packs_epi32(sum, sum);
+
+  return (color_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#else
+  color_t color = 0;
+
+  for (uint32_t shift = 0; shift < 32; shift += 8) {
+    const int32_t channel = (int32_t)((t00 >> shift) & 0xFF) * w00 + (int32_t)((t10 >> shift) & 0xFF) * w10 +
+      (int32_t)((t01 >> shift) & 0xFF) * w01 + (int32_t)((t11 >> shift) & 0xFF) * w11;
+
+    color |= (color_t)((channel + (1 << 13)) >> 14) << shift;
+  }
+
+  return color;
+#endif
+}
+
+// the 7-bit fixed point texel coordinate, rounded down also for negative coordinates
+static inline int32_t texture_fixed_coord(const float texels)
+{
+  const float scaled = texels * 128.f;
+  const int32_t truncated = (int32_t)scaled;
+
+  return truncated - (scaled < (float)truncated);
+}
+
+// Bilinear sample of a level at uv, repeating outside of [0, 1). Texel centers are at half texels.
+static inline color_t texture_sample_bilinear(const tex2_t* texture, const uint32_t level_index, const float u, 
+  const float v)
+{
+  const tex2_level_t* level = &texture->levels[level_index];
+  const int32_t sx = texture_fixed_coord(u * level->size.x - 0.5f);
+  const int32_t sy = texture_fixed_coord(v * level->size.y - 0.5f);
+
+  // floor division, right shifts of negative values are implementation defined
+  const int32_t ix = sx >= 0 ? sx >> 7 : -((-sx + 127) >> 7);
+  const int32_t iy = sy >= 0 ? sy >> 7 : -((-sy + 127) >> 7);
+
+  const color_t* data = level->data;
+  color_t t00, t10, t01, t11;
+
+  if (texture->pow2) {
+    const uint32_t x0 = (uint32_t)ix & level->mask_x;
+    const uint32_t y0 = (uint32_t)iy & level->mask_y;
+    const uint32_t x1 = (x0 + 1) & level->mask_x;
+    const uint32_t y1 = (y0 + 1) & level->mask_y;
+
+    if (texture->compressed) {
+      t00 = texture_block_texel(level, x0, y0);
+      t10 = texture_block_texel(level, x1, y0);
+      t01 = texture_block_texel(level, x0, y1);
+      t11 = texture_block_texel(level, x1, y1);
+    } else if (texture->tiled) {
+      const color_t* row0 = data + texture_tiled_y(level, y0);
+      const color_t* row1 = data + texture_tiled_y(level, y1);
+      const size_t column0 = texture_tiled_x(level, x0);
+      const size_t column1 = texture_tiled_x(level, x1);
+
+      t00 = row0[column0];
+      t10 = row0[column1];
+      t01 = row1[column0];
+      t11 = row1[column1];
+    } else {
+      const color_t* row0 = data + ((size_t)y0 << level->stride_shift);
+      const color_t* row1 = data + ((size_t)y1 << level->stride_shift);
+
+      t00 = row0[x0];
+      t10 = row0[x1];
+      t01 = row1[x0];
+      t11 = row1[x1];
+    }
+  } else {
+    int32_t x0 = ix % (int32_t)level->width;
+    int32_t y0 = iy % (int32_t)level->height;
+
+    x0 += x0 < 0 ? (int32_t)level->width : 0;
+    y0 += y0 < 0 ? (int32_t)level->height : 0;
+
+    const int32_t x1 = x0 + 1 == (int32_t)level->width ? 0 : x0 + 1;
+    const int32_t y1 = y0 + 1 == (int32_t)level->height ? 0 : y0 + 1;
+    const color_t* row0 = data + (size_t)y0 * level->stride;
+    const color_t* row1 = data + (size_t)y1 * level->stride;
+
+    t00 = row0[x0];
+    t10 = row0[x1];
+    t01 = row1[x0];
+    t11 = row1[x1];
+  }
+
+  return texture_bilerp(t00, t10, t01, t11, sx & 127, sy & 127);
+}
+
+// Samples the mip chain at lod, which is clamped to the available levels. Without trilinear only 
+// the nearest level is sampled, with it the two levels around lod are sampled and blended. Either
+// takes the nearest texel or, with bilinear, blends the four around uv.
+static inline color_t texture_sample_lod(const tex2_t* texture, const float u, const float v, float lod, 
+  const bool bilinear, const bool trilinear)
+{
+  const float max_lod = (float)(texture->num_levels - 1);
+  lod = lod < 0.f ? 0.f : lod > max_lod ? max_lod : lod;
+
+  if (!trilinear) {
+    const uint32_t level = (uint32_t)(lod + 0.5f);
+    return bilinear ? texture_sample_bilinear(texture, level, u, v) : texture_sample_level(texture, level, u, v);
+  }
+
+  const uint32_t level = (uint32_t)lod;
+  const uint32_t t = (uint32_t)((lod - (float)level) * 256.f);
+  const color_t a = bilinear ? texture_sample_bilinear(texture, level, u, v) : texture_sample_level(texture, level, u, v);
+
+  if (t == 0) return a;
+
+  const color_t b = bilinear ? texture_sample_bilinear(texture, level + 1, u, v) : 
+    texture_sample_level(texture, level + 1, u, v);
+
+  return color_lerp(a, b, t);
+}
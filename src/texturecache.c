@@ -0,0 +1,219 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "filemap.h"
+#include "texture.h"
+#include "texturecache.h"
+
+static const char texture_cache_magic[8] = { 'S', 'R', 'T', 'E', 'X', 0, 0, 0 };
+
+static void texture_cache_path(char* buffer, const size_t size, const char* source_path)
+{
+  snprintf(buffer, size, "%s%s", source_path, TEXTURE_CACHE_EXTENSION);
+}
+
+// the level data in bytes, 0 for layouts texture_init_chain() and texture_init_blocks() can't view
+static uint64_t data_size(const texture_cache_header_t* header)
+{
+  const bool pow2 = is_pow2(header->width) && is_pow2(header->height);
+
+  if (header->width == 0 || header->height == 0 || ((header->tiled || header->compressed) && !pow2))
+    return 0;
+
+  return header->compressed ? sizeof(uint64_t) * texture_block_count(header->width, header->height) :
+    sizeof(color_t) * texture_texel_count(header->width, header->height);
+}
+
+bool texture_cache_write(const tex2_t* texture, const char* source_path)
+{
+  if (!texture || !source_path || texture->num_levels == 0) return false;
+
+  const tex2_level_t* base = &texture->levels[0];
+
+  // only packed levels, textures keep the stride of views, e.g. of SDL surfaces
+  if (!texture->compressed && base->stride != base->width) return false;
+
+  texture_cache_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  if (!file_stat(source_path, &header.source_size, &header.source_mtime) ||
+    !file_hash(source_path, &header.source_hash))
+    return false;
+
+  memcpy(header.magic, texture_cache_magic, sizeof(header.magic));
+  header.version = TEXTURE_CACHE_VERSION;
+  header.width = base->width;
+  header.height = base->height;
+  header.tiled = texture->tiled;
+  header.tile_bits = TEXTURE_TILE_BITS;
+  header.compressed = texture->compressed;
+  header.data_offset = align_size(sizeof(header), TEXTURE_CACHE_ALIGN);
+
+  char path[1024];
+  texture_cache_path(path, sizeof(path), source_path);
+
+  // loader threads may convert the same texture at once, each writes its own file and renames it
+  char temp_path[1024 + 32];
+  snprintf(temp_path, sizeof(temp_path), "%s.%lu", path, SDL_ThreadID());
+
+  FILE* file = fopen(temp_path, "wb");
+
+  if (!file) {
+    perror("Error creating texture cache");
+    return false;
+  }
+
+  static const char zeros[TEXTURE_CACHE_ALIGN] = { 0 };
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(zeros, 1, (size_t)header.data_offset - sizeof(header), file) == header.data_offset - sizeof(header);
+
+  for (uint32_t i = 0; i < texture->num_levels && written; ++i) {
+    const tex2_level_t* level = &texture->levels[i];
+
+    if (texture->compressed) {
+      const size_t num_blocks = (size_t)((level->width + 3) / 4) * ((level->height + 3) / 4);
+      written = fwrite(level->blocks, sizeof(uint64_t), num_blocks, file) == num_blocks;
+    } else {
+      const size_t num_texels = (size_t)level->width * level->height;
+      written = fwrite(level->data, sizeof(color_t), num_texels, file) == num_texels;
+    }
+  }
+
+  written = (uint64_t)ftell(file) == header.data_offset + data_size(&header) && written;
+  fclose(file);
+
+  // renaming over an existing file fails on Windows, the other thread's file is as good
+  if (written && rename(temp_path, path) != 0) {
+    FILE* exists = fopen(path, "rb");
+    written = exists != NULL;
+    if (exists) fclose(exists);
+  }
+
+  remove(temp_path);
+
+  if (!written)
+    fprintf(stderr, "Error writing texture cache: %s\n", path);
+
+  return written;
+}
+
+// the source is unchanged if size and mtime match, or if only the mtime changed but the content
+// hash still matches, the stored mtime isn't updated, since other threads may have the file mapped
+static bool source_unchanged(const texture_cache_header_t* header, const char* source_path)
+{
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  if (!file_stat(source_path, &size, &mtime) || size != header->source_size)
+    return false;
+
+  uint64_t hash = 0;
+  return mtime == header->source_mtime || (file_hash(source_path, &hash) && hash == header->source_hash);
+}
+
+bool texture_cache_load(tex2_t* texture, const char* source_path)
+{
+  if (!texture || !source_path) return false;
+
+  char path[1024];
+  texture_cache_path(path, sizeof(path), source_path);
+
+  FILE* exists = fopen(path, "rb");
+  if (!exists) return false;
+  fclose(exists);
+
+  file_map_t map;
+
+  if (!file_map_open(&map, path))
+    return false;
+
+  texture_cache_header_t header;
+  bool valid = map.size >= sizeof(header);
+
+  if (valid) {
+    memcpy(&header, map.data, sizeof(header));
+
+    const uint64_t size = data_size(&header);
+
+    valid = memcmp(header.magic, texture_cache_magic, sizeof(header.magic)) == 0 &&
+      header.version == TEXTURE_CACHE_VERSION &&
+      header.tile_bits == TEXTURE_TILE_BITS &&
+      header.data_offset % TEXTURE_CACHE_ALIGN == 0 && header.data_offset <= map.size &&
+      size > 0 && size <= map.size - header.data_offset &&
+      source_unchanged(&header, source_path);
+  }
+
+  if (!valid) {
+    file_map_close(&map);
+    return false;
+  }
+
+  texture_free(texture);
+
+  if (header.compressed)
+    texture_init_blocks(texture, (const uint64_t*)(map.data + header.data_offset), header.width, header.height);
+  else
+    texture_init_chain(texture, (const color_t*)(map.data + header.data_offset), header.width, header.height,
+      header.tiled != 0);
+
+  texture->mapping = map;
+
+  return true;
+}
+
+typedef struct convert_job {
+  const char* const* source_paths;
+  size_t count;
+  SDL_atomic_t next;
+  SDL_atomic_t converted;
+} convert_job_t;
+
+// takes the next path until all are taken
+static int convert_thread(void* data)
+{
+  convert_job_t* job = (convert_job_t*)data;
+
+  for (;;) {
+    const size_t i = (size_t)SDL_AtomicAdd(&job->next, 1);
+    if (i >= job->count) return 0;
+
+    tex2_t texture = { 0 };
+    load_texture(&texture, job->source_paths[i]);
+
+    if (texture.num_levels > 0)
+      SDL_AtomicAdd(&job->converted, 1);
+
+    texture_free(&texture);
+  }
+}
+
+size_t texture_cache_convert(const char* const* source_paths, const size_t count)
+{
+  if (!source_paths || count == 0) return 0;
+
+  convert_job_t job = { .source_paths = source_paths, .count = count };
+  SDL_Thread* threads[TEXTURE_CACHE_THREADS] = { NULL };
+  const size_t num_threads = MIN(MIN(count, (size_t)TEXTURE_CACHE_THREADS), (size_t)MAX(SDL_GetCPUCount(), 1));
+
+  // the calling thread is the first one, and does everything if no other can be started
+  for (size_t i = 1; i < num_threads; ++i)
+    threads[i] = SDL_CreateThread(convert_thread, "texture_convert", &job);
+
+  convert_thread(&job);
+
+  for (size_t i = 1; i < num_threads; ++i) {
+    if (threads[i])
+      SDL_WaitThread(threads[i], NULL);
+  }
+
+  const size_t converted = (size_t)SDL_AtomicGet(&job.converted);
+  printf("Converted %zu of %zu textures on %zu threads.\n", converted, count, num_threads);
+
+  return converted;
+}
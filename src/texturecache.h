@@ -0,0 +1,39 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+
+// Converted textures written next to the source (e.g. assets/cube.png.texcache), with all levels in
+// the layout they are sampled in, so later runs map the file instead of decoding and converting.
+
+#define TEXTURE_CACHE_EXTENSION ".texcache"
+#define TEXTURE_CACHE_VERSION 2
+#define TEXTURE_CACHE_ALIGN 64
+
+// the levels follow at data_offset, as texels or, if compressed, BC1 blocks. tile_bits has to match
+// the current one. A cache keeps the format it was written in whatever TEXTURE_COMPRESS is now,
+// existing caches have to be deleted for a changed setting to apply to them.
+typedef struct texture_cache_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t tiled;
+  uint32_t tile_bits;
+  uint32_t compressed;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+  uint64_t data_offset;
+} texture_cache_header_t;
+
+bool texture_cache_load(tex2_t* texture, const char* source_path);
+bool texture_cache_write(const tex2_t* texture, const char* source_path);
+
+// loads the textures on up to TEXTURE_CACHE_THREADS threads, which writes the missing cache files
+size_t texture_cache_convert(const char* const* source_paths, const size_t count);
@@ -0,0 +1,490 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "defs.h"
+#include "hash.h"
+#include "texture.h"
+#include "textures.h"
+
+// reloads of reduced textures, requested by textures_end_frame(), handed to a loader thread by
+// textures_reload_requests() and installed by the next textures_end_frame() once they're loaded
+enum texture_reload {
+  TEXTURE_RELOAD_NONE,
+  TEXTURE_RELOAD_REQUESTED,
+  TEXTURE_RELOAD_QUEUED
+};
+
+typedef struct texture_entry {
+  char path[256];
+  uint64_t hash;
+  tex2_t texture;
+  uint32_t refs;
+  uint64_t last_used;
+  size_t dropped_bytes;
+  bool reloadable;
+  enum texture_reload reload;
+  // a finished reload that isn't installed yet
+  tex2_t reloaded;
+} texture_entry_t;
+
+// handles are entry indices + 1, so zero initialized handles are invalid. Entries never move, so
+// texture pointers stay valid while other threads register textures.
+static struct {
+  texture_entry_t entries[TEXTURE_MAX_ENTRIES];
+  uint32_t num_entries;
+  size_t budget;
+  uint64_t frame;
+  const asset_pack_t* pack;
+  SDL_mutex* mutex;
+  texture_stats_t stats;
+} registry = { .budget = TEXTURE_BUDGET };
+
+static void lock(void)
+{
+  if (registry.mutex) SDL_LockMutex(registry.mutex);
+}
+
+static void unlock(void)
+{
+  if (registry.mutex) SDL_UnlockMutex(registry.mutex);
+}
+
+static bool resident(const texture_entry_t* entry)
+{
+  return entry->texture.num_levels > 0;
+}
+
+static texture_entry_t* get_entry(const texture_handle_t handle)
+{
+  if (handle == TEXTURE_INVALID || handle > registry.num_entries) return NULL;
+  return &registry.entries[handle - 1];
+}
+
+static texture_handle_t find(const char* path, const uint64_t hash)
+{
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    const texture_entry_t* entry = &registry.entries[i];
+
+    if (entry->hash == hash && strcmp(entry->path, path) == 0)
+      return i + 1;
+  }
+
+  return TEXTURE_INVALID;
+}
+
+// a new entry, or the first one that is neither referenced nor resident
+static texture_handle_t insert(const char* path, const uint64_t hash)
+{
+  uint32_t index = registry.num_entries;
+
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    if (registry.entries[i].refs == 0 && !resident(&registry.entries[i])) {
+      index = i;
+      break;
+    }
+  }
+
+  if (index == TEXTURE_MAX_ENTRIES) {
+    fprintf(stderr, "Can't register %s, all %d texture entries are used.\n", path, TEXTURE_MAX_ENTRIES);
+    return TEXTURE_INVALID;
+  }
+
+  if (index == registry.num_entries)
+    ++registry.num_entries;
+
+  texture_entry_t* entry = &registry.entries[index];
+
+  memset(entry, 0, sizeof(*entry));
+  snprintf(entry->path, sizeof(entry->path), "%s", path);
+  entry->hash = hash;
+
+  return index + 1;
+}
+
+// the pack first, then the file
+static bool load(const char* path, tex2_t* texture)
+{
+  if (registry.pack && asset_pack_texture(registry.pack, path, texture))
+    return true;
+
+  load_texture(texture, path);
+  return texture->num_levels > 0;
+}
+
+static void unload(texture_entry_t* entry)
+{
+  registry.stats.resident_bytes -= texture_memory_size(&entry->texture);
+  texture_free(&entry->texture);
+  entry->dropped_bytes = 0;
+
+  // a reload that is still loading is dropped when it's done
+  texture_free(&entry->reloaded);
+  entry->reload = TEXTURE_RELOAD_NONE;
+}
+
+static void evict(texture_entry_t* entry)
+{
+  unload(entry);
+  ++registry.stats.evictions;
+}
+
+// takes the data of texture, the entry isn't resident
+static void install(texture_entry_t* entry, tex2_t* texture)
+{
+  entry->texture = *texture;
+  memset(texture, 0, sizeof(*texture));
+  registry.stats.resident_bytes += texture_memory_size(&entry->texture);
+}
+
+void textures_init(const size_t budget)
+{
+  registry.budget = budget;
+  registry.mutex = SDL_CreateMutex();
+
+  if (!registry.mutex)
+    fprintf(stderr, "Error creating texture registry mutex: %s\n", SDL_GetError());
+}
+
+void textures_shutdown(void)
+{
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    texture_free(&registry.entries[i].texture);
+    texture_free(&registry.entries[i].reloaded);
+  }
+
+  SDL_DestroyMutex(registry.mutex);
+  memset(&registry, 0, sizeof(registry));
+  registry.budget = TEXTURE_BUDGET;
+}
+
+void textures_set_pack(const asset_pack_t* pack)
+{
+  lock();
+
+  // unreferenced textures may still borrow their base level from the previous pack
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    texture_entry_t* entry = &registry.entries[i];
+
+    if (entry->refs == 0 && resident(entry) && !entry->texture.owned && !entry->texture.mapping.data)
+      evict(entry);
+  }
+
+  registry.pack = pack;
+  unlock();
+}
+
+texture_handle_t textures_acquire(const char* path)
+{
+  if (!path) return TEXTURE_INVALID;
+
+  const uint64_t hash = hash_string(path);
+
+  lock();
+
+  texture_handle_t handle = find(path, hash);
+  if (handle == TEXTURE_INVALID) handle = insert(path, hash);
+
+  texture_entry_t* entry = get_entry(handle);
+
+  if (!entry) {
+    unlock();
+    return TEXTURE_INVALID;
+  }
+
+  ++entry->refs;
+  entry->reloadable = true;
+  entry->last_used = registry.frame;
+
+  if (resident(entry)) {
+    ++registry.stats.hits;
+    unlock();
+    return handle;
+  }
+
+  unlock();
+
+  // loaded without holding the lock, another thread may load the same path meanwhile
+  tex2_t texture = { 0 };
+  const bool loaded = load(path, &texture);
+
+  lock();
+
+  if (loaded && !resident(entry)) {
+    install(entry, &texture);
+    ++registry.stats.loads;
+  }
+
+  unlock();
+  texture_free(&texture);
+
+  if (!loaded) {
+    textures_release(handle);
+    return TEXTURE_INVALID;
+  }
+
+  return handle;
+}
+
+void textures_retain(const texture_handle_t handle)
+{
+  lock();
+
+  texture_entry_t* entry = get_entry(handle);
+  if (entry && entry->refs > 0) ++entry->refs;
+
+  unlock();
+}
+
+texture_handle_t textures_adopt(const char* name, tex2_t* texture, const bool reloadable)
+{
+  if (!name || !texture || texture->num_levels == 0) return TEXTURE_INVALID;
+
+  const uint64_t hash = hash_string(name);
+
+  lock();
+
+  texture_handle_t handle = find(name, hash);
+  if (handle == TEXTURE_INVALID) handle = insert(name, hash);
+
+  texture_entry_t* entry = get_entry(handle);
+
+  if (entry) {
+    ++entry->refs;
+    entry->reloadable |= reloadable;
+    entry->last_used = registry.frame;
+
+    if (!resident(entry)) {
+      install(entry, texture);
+      ++registry.stats.loads;
+    } else {
+      ++registry.stats.hits;
+    }
+  }
+
+  unlock();
+  texture_free(texture);
+
+  return handle;
+}
+
+// the least recently used entry that may be evicted, or reduced if referenced is set
+static texture_entry_t* least_recently_used(const bool referenced)
+{
+  texture_entry_t* lru = NULL;
+
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    texture_entry_t* entry = &registry.entries[i];
+    const tex2_t* texture = &entry->texture;
+
+    if (!resident(entry) || (entry->refs > 0) != referenced)
+      continue;
+
+    // only reloadable owned base levels that weren't needed in this frame give memory back
+    if (referenced && (!entry->reloadable || !texture->owned || texture->num_levels < 2 ||
+      entry->last_used >= registry.frame))
+      continue;
+
+    if (!lru || entry->last_used < lru->last_used)
+      lru = entry;
+  }
+
+  return lru;
+}
+
+static void evict_unreferenced(void)
+{
+  while (registry.stats.resident_bytes > registry.budget) {
+    texture_entry_t* entry = least_recently_used(false);
+    if (!entry) return;
+
+    evict(entry);
+  }
+}
+
+void textures_release(const texture_handle_t handle)
+{
+  lock();
+
+  texture_entry_t* entry = get_entry(handle);
+
+  if (entry && entry->refs > 0) {
+    --entry->refs;
+
+    // nobody can hold a pointer to textures without references, so they go right away
+    if (entry->refs == 0)
+      evict_unreferenced();
+  }
+
+  unlock();
+}
+
+const tex2_t* textures_get(const texture_handle_t handle)
+{
+  lock();
+
+  texture_entry_t* entry = get_entry(handle);
+  const tex2_t* texture = NULL;
+
+  if (entry && resident(entry)) {
+    entry->last_used = registry.frame;
+    texture = &entry->texture;
+  }
+
+  unlock();
+
+  return texture;
+}
+
+// swaps in the reloads that finished, if they still fit, nobody holds pointers to the reduced
+// textures between frames
+static void install_reloads(void)
+{
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    texture_entry_t* entry = &registry.entries[i];
+    if (entry->reloaded.num_levels == 0) continue;
+
+    const size_t size = texture_memory_size(&entry->reloaded);
+    const size_t reduced_size = texture_memory_size(&entry->texture);
+
+    if (entry->dropped_bytes > 0 && registry.stats.resident_bytes - reduced_size + size <= registry.budget) {
+      tex2_t texture = entry->reloaded;
+      memset(&entry->reloaded, 0, sizeof(entry->reloaded));
+
+      unload(entry);
+      install(entry, &texture);
+      ++registry.stats.loads;
+    }
+
+    texture_free(&entry->reloaded);
+  }
+}
+
+// reduced textures used in this frame are reloaded on a loader thread if there is room for them
+static void request_reloads(void)
+{
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    texture_entry_t* entry = &registry.entries[i];
+
+    if (entry->dropped_bytes == 0 || entry->last_used < registry.frame || entry->reload != TEXTURE_RELOAD_NONE ||
+      entry->reloaded.num_levels > 0 || registry.stats.resident_bytes + entry->dropped_bytes > registry.budget)
+      continue;
+
+    entry->reload = TEXTURE_RELOAD_REQUESTED;
+  }
+}
+
+size_t textures_reload_requests(texture_handle_t* handles, const size_t max_handles)
+{
+  size_t count = 0;
+
+  lock();
+
+  for (uint32_t i = 0; i < registry.num_entries && count < max_handles; ++i) {
+    texture_entry_t* entry = &registry.entries[i];
+    if (entry->reload != TEXTURE_RELOAD_REQUESTED) continue;
+
+    entry->reload = TEXTURE_RELOAD_QUEUED;
+    ++entry->refs;
+    handles[count++] = i + 1;
+  }
+
+  unlock();
+
+  return count;
+}
+
+void textures_reload(const texture_handle_t handle)
+{
+  char path[sizeof(registry.entries[0].path)] = { 0 };
+
+  lock();
+
+  const texture_entry_t* entry = get_entry(handle);
+  if (entry && entry->reload == TEXTURE_RELOAD_QUEUED) memcpy(path, entry->path, sizeof(path));
+
+  unlock();
+
+  if (!path[0]) return;
+
+  // decoded without holding the lock, like in textures_acquire()
+  tex2_t texture = { 0 };
+  const bool loaded = load(path, &texture);
+
+  lock();
+
+  texture_entry_t* queued = get_entry(handle);
+
+  // unless the entry was unloaded meanwhile
+  if (loaded && queued->reload == TEXTURE_RELOAD_QUEUED) {
+    queued->reloaded = texture;
+    memset(&texture, 0, sizeof(texture));
+  }
+
+  if (queued->reload == TEXTURE_RELOAD_QUEUED)
+    queued->reload = TEXTURE_RELOAD_NONE;
+
+  unlock();
+  texture_free(&texture);
+}
+
+void textures_end_frame(void)
+{
+  lock();
+
+  install_reloads();
+  evict_unreferenced();
+
+  while (registry.stats.resident_bytes > registry.budget) {
+    texture_entry_t* entry = least_recently_used(true);
+    if (!entry) break;
+
+    const size_t size = texture_memory_size(&entry->texture);
+
+    texture_drop_base_level(&entry->texture);
+    entry->dropped_bytes += size - texture_memory_size(&entry->texture);
+    registry.stats.resident_bytes -= size - texture_memory_size(&entry->texture);
+    ++registry.stats.dropped_levels;
+  }
+
+  request_reloads();
+  ++registry.frame;
+
+  unlock();
+}
+
+texture_stats_t textures_stats(void)
+{
+  lock();
+
+  texture_stats_t stats = registry.stats;
+  stats.budget = registry.budget;
+
+  for (uint32_t i = 0; i < registry.num_entries; ++i) {
+    const texture_entry_t* entry = &registry.entries[i];
+
+    stats.num_registered += entry->refs > 0 || resident(entry);
+    stats.num_resident += resident(entry);
+    stats.num_referenced += entry->refs > 0;
+    stats.num_reduced += entry->dropped_bytes > 0;
+  }
+
+  unlock();
+
+  return stats;
+}
+
+void textures_print_stats(void)
+{
+  const texture_stats_t stats = textures_stats();
+
+  printf("Textures: %u registered, %u resident, %u referenced, %u reduced, %.1f of %.1f MB.\n",
+    stats.num_registered, stats.num_resident, stats.num_referenced, stats.num_reduced,
+    (double)stats.resident_bytes / (1024. * 1024.), (double)stats.budget / (1024. * 1024.));
+  printf("Texture hits: %llu, loads: %llu, evictions: %llu, dropped levels: %llu.\n",
+    (unsigned long long)stats.hits, (unsigned long long)stats.loads, (unsigned long long)stats.evictions,
+    (unsigned long long)stats.dropped_levels);
+}
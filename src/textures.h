@@ -0,0 +1,68 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "assetpack.h"
+#include "types.h"
+
+// Registry of the loaded textures, keyed by the hash of their path, so every path is loaded once
+// and shared. Users hold handles, each counting as a reference until it's released. Textures
+// without references stay resident while they fit into the budget, beyond it the least recently
+// used are evicted, then the base levels of referenced textures that weren't used in the current
+// frame. Those are reloaded on a loader thread once they are used again and there is room for them.
+// A mutex guards the registry, so loader threads may acquire and reload textures. Eviction,
+// installing reloaded textures and the texture pointers returned by textures_get() belong to the
+// main thread.
+
+typedef struct texture_stats {
+  uint32_t num_registered;
+  uint32_t num_resident;
+  uint32_t num_referenced;
+  uint32_t num_reduced;
+  size_t resident_bytes;
+  size_t budget;
+  uint64_t hits;
+  uint64_t loads;
+  uint64_t evictions;
+  uint64_t dropped_levels;
+} texture_stats_t;
+
+void textures_init(const size_t budget);
+void textures_shutdown(void);
+
+// evicted textures that are in the pack are reloaded from it. Unreferenced textures borrowed from
+// the previous pack are evicted, so it may be closed afterwards.
+void textures_set_pack(const asset_pack_t* pack);
+
+// loads the texture at path from the pack or the file, unless it's already registered
+texture_handle_t textures_acquire(const char* path);
+
+// registers a texture loaded elsewhere, e.g. embedded in a .glb, under name and takes its data.
+// If name is already resident the new texture is freed instead. Only reloadable textures, which
+// can be loaded again through textures_acquire(), give up levels while they're referenced.
+texture_handle_t textures_adopt(const char* name, tex2_t* texture, const bool reloadable);
+
+// another reference to a texture that is referenced already
+void textures_retain(const texture_handle_t handle);
+void textures_release(const texture_handle_t handle);
+
+// NULL unless the texture is resident, the pointer is valid until textures_end_frame()
+const tex2_t* textures_get(const texture_handle_t handle);
+
+// Installs the reloads that finished, evicts down to the budget and requests reloads of reduced
+// textures used in this frame if there is room. Nothing is loaded on the calling thread.
+void textures_end_frame(void);
+
+// up to max_handles textures whose reload was requested, each with a reference that is released
+// once textures_reload() was called for it
+size_t textures_reload_requests(texture_handle_t* handles, const size_t max_handles);
+
+// loads the texture again for the next textures_end_frame() to install, meant for loader threads
+void textures_reload(const texture_handle_t handle);
+
+texture_stats_t textures_stats(void);
+void textures_print_stats(void);
@@ -0,0 +1,558 @@
+// Copyright 2025 Sebastian Cyliax
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL_image.h>
+
+#include "darray.h"
+#include "defs.h"
+#include "texture.h"
+#include "texturestream.h"
+
+// pages start on OS page boundaries in the file, so loading one touches no more of them than needed
+#define TEXTURE_STREAM_ALIGN 4096
+
+static const char texture_stream_magic[8] = { 'S', 'R', 'P', 'A', 'G', 'E', 'S', 0 };
+
+static const size_t page_texels = (size_t)TEXTURE_PAGE_SIZE * TEXTURE_PAGE_SIZE;
+
+static void texture_stream_path(char* buffer, const size_t size, const char* source_path)
+{
+  snprintf(buffer, size, "%s%s", source_path, TEXTURE_STREAM_EXTENSION);
+}
+
+static uint32_t log2_pow2(uint32_t x)
+{
+  uint32_t log2 = 0;
+
+  while (x > 1) {
+    x >>= 1;
+    ++log2;
+  }
+
+  return log2;
+}
+
+// the levels of the mip chain down to 1x1, as texture_init() builds them
+static uint32_t level_count(uint32_t width, uint32_t height)
+{
+  uint32_t num_levels = 1;
+
+  while ((width > 1 || height > 1) && num_levels < TEXTURE_MAX_LEVELS) {
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    ++num_levels;
+  }
+
+  return num_levels;
+}
+
+// fills the page table layout of each level and returns the number of pages of all levels
+static uint32_t layout_pages(uint32_t width, uint32_t height, const uint32_t num_levels, uint32_t* first_page,
+  uint32_t* pages_shift)
+{
+  uint32_t num_pages = 0;
+
+  for (uint32_t i = 0; i < num_levels; ++i) {
+    const uint32_t pages_x = MAX(width >> TEXTURE_PAGE_BITS, 1);
+    const uint32_t pages_y = MAX(height >> TEXTURE_PAGE_BITS, 1);
+
+    first_page[i] = num_pages;
+    pages_shift[i] = log2_pow2(pages_x);
+    num_pages += pages_x * pages_y;
+
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+  }
+
+  return num_pages;
+}
+
+// copies the page at column px of a strip of a level's rows, repeating the last row and column past
+// the level's edges
+static void gather_page(const color_t* rows, const size_t stride, const uint32_t width, const uint32_t num_rows,
+  const uint32_t px, color_t* page)
+{
+  const uint32_t x0 = px << TEXTURE_PAGE_BITS;
+  const uint32_t columns = MIN(width - x0, TEXTURE_PAGE_SIZE);
+
+  for (uint32_t y = 0; y < TEXTURE_PAGE_SIZE; ++y) {
+    const color_t* row = rows + (size_t)MIN(y, num_rows - 1) * stride + x0;
+    color_t* out = page + ((size_t)y << TEXTURE_PAGE_BITS);
+
+    memcpy(out, row, sizeof(color_t) * columns);
+
+    for (uint32_t x = columns; x < TEXTURE_PAGE_SIZE; ++x)
+      out[x] = row[columns - 1];
+  }
+}
+
+// Writes the row of pages starting at first_row of a level, from its rows, and averages them into
+// the rows of the next level, unless next is NULL.
+static bool write_strip(FILE* file, color_t* page, const color_t* rows, const size_t stride, const uint32_t width,
+  const uint32_t height, const uint32_t first_row, color_t* next)
+{
+  const uint32_t num_rows = MIN(height - first_row, TEXTURE_PAGE_SIZE);
+  const uint32_t pages_x = MAX(width >> TEXTURE_PAGE_BITS, 1);
+
+  for (uint32_t px = 0; px < pages_x; ++px) {
+    gather_page(rows, stride, width, num_rows, px, page);
+
+    if (fwrite(page, sizeof(color_t), page_texels, file) != page_texels)
+      return false;
+  }
+
+  const uint32_t next_width = MAX(width / 2, 1);
+
+  for (uint32_t y = first_row / 2; next && y < MAX(height / 2, 1) && 2 * y < first_row + num_rows; ++y) {
+    const uint32_t y1 = MIN(2 * y + 1, height - 1);
+
+    texture_downsample_row(rows + (size_t)(2 * y - first_row) * stride, rows + (size_t)(y1 - first_row) * stride,
+      width, next + (size_t)y * next_width);
+  }
+
+  return true;
+}
+
+// rows [first_row, first_row + num_rows) of the decoded image in PIXELFORMAT, converted through a
+// view of them in the image's own format
+static SDL_Surface* convert_rows(SDL_Surface* image, const uint32_t first_row, const uint32_t num_rows)
+{
+  SDL_Surface* view = SDL_CreateRGBSurfaceWithFormatFrom((char*)image->pixels + (size_t)first_row * image->pitch,
+    image->w, (int)num_rows, image->format->BitsPerPixel, image->pitch, image->format->format);
+  Uint32 key = 0;
+
+  if (!view) return NULL;
+
+  if (image->format->palette) SDL_SetSurfacePalette(view, image->format->palette);
+  if (SDL_GetColorKey(image, &key) == 0) SDL_SetColorKey(view, SDL_TRUE, key);
+
+  SDL_Surface* rows = SDL_ConvertSurfaceFormat(view, PIXELFORMAT, 0);
+  SDL_FreeSurface(view);
+
+  return rows;
+}
+
+bool texture_stream_build(const char* source_path)
+{
+  if (!source_path) return false;
+
+  texture_stream_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  if (!file_stat(source_path, &header.source_size, &header.source_mtime))
+    return false;
+
+  // The one time conversion decodes the image once, then converts and writes it one row of pages
+  // at a time. Each coarser level is averaged from those rows, and written from its own buffer
+  // while the next one is averaged from it, so at most a quarter of the image is added to it.
+  SDL_Surface* image = IMG_Load(source_path);
+
+  if (!image) {
+    fprintf(stderr, "Error loading %s: %s\n", source_path, IMG_GetError());
+    return false;
+  }
+
+  const uint32_t width = (uint32_t)image->w;
+  const uint32_t height = (uint32_t)image->h;
+
+  if (!is_pow2(width) || !is_pow2(height)) {
+    fprintf(stderr, "Virtual textures need power-of-two sizes, %s is %ux%u.\n", source_path, width, height);
+    SDL_FreeSurface(image);
+    return false;
+  }
+
+  uint32_t first_page[TEXTURE_MAX_LEVELS];
+  uint32_t pages_shift[TEXTURE_MAX_LEVELS];
+
+  memcpy(header.magic, texture_stream_magic, sizeof(header.magic));
+  header.version = TEXTURE_STREAM_VERSION;
+  header.width = width;
+  header.height = height;
+  header.num_levels = level_count(width, height);
+  header.page_bits = TEXTURE_PAGE_BITS;
+  header.num_pages = layout_pages(width, height, header.num_levels, first_page, pages_shift);
+  header.data_offset = align_size(sizeof(header), TEXTURE_STREAM_ALIGN);
+
+  char path[1024];
+  texture_stream_path(path, sizeof(path), source_path);
+
+  char temp_path[1024 + 8];
+  snprintf(temp_path, sizeof(temp_path), "%s.data", path);
+
+  FILE* file = fopen(temp_path, "wb");
+  bool written = false;
+
+  if (file) {
+    static const char zeros[TEXTURE_STREAM_ALIGN] = { 0 };
+    const size_t padding = (size_t)header.data_offset - sizeof(header);
+
+    written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(zeros, 1, padding, file) == padding;
+  } else {
+    perror("Error creating texture pages");
+  }
+
+  color_t* page = malloc(sizeof(color_t) * page_texels);
+  color_t* level = NULL;
+  color_t* next = header.num_levels > 1 ? malloc(sizeof(color_t) * MAX(width / 2, 1) * MAX(height / 2, 1)) : NULL;
+
+  if (!page || (header.num_levels > 1 && !next)) exit(EXIT_FAILURE);
+
+  SDL_LockSurface(image);
+
+  for (uint32_t first_row = 0; first_row < height && written; first_row += TEXTURE_PAGE_SIZE) {
+    SDL_Surface* rows = convert_rows(image, first_row, MIN(height - first_row, TEXTURE_PAGE_SIZE));
+
+    if (!rows) {
+      fprintf(stderr, "Error converting %s: %s\n", source_path, SDL_GetError());
+      written = false;
+      break;
+    }
+
+    SDL_LockSurface(rows);
+    written = write_strip(file, page, rows->pixels, (size_t)rows->pitch / sizeof(color_t), width, height, first_row,
+      next);
+    SDL_UnlockSurface(rows);
+    SDL_FreeSurface(rows);
+  }
+
+  SDL_UnlockSurface(image);
+  SDL_FreeSurface(image);
+
+  uint32_t level_width = width;
+  uint32_t level_height = height;
+
+  // the previous level's buffer is large enough for the one after the current level
+  for (uint32_t i = 1; i < header.num_levels && written; ++i) {
+    SWAP(color_t*, &level, &next);
+    level_width = MAX(level_width / 2, 1);
+    level_height = MAX(level_height / 2, 1);
+
+    if (!next && i + 1 < header.num_levels) {
+      next = malloc(sizeof(color_t) * MAX(level_width / 2, 1) * MAX(level_height / 2, 1));
+      if (!next) exit(EXIT_FAILURE);
+    }
+
+    for (uint32_t first_row = 0; first_row < level_height && written; first_row += TEXTURE_PAGE_SIZE) {
+      written = write_strip(file, page, level + (size_t)first_row * level_width, level_width, level_width,
+        level_height, first_row, i + 1 < header.num_levels ? next : NULL);
+    }
+  }
+
+  if (file) fclose(file);
+
+  free(page);
+  free(level);
+  free(next);
+
+  if (written) {
+    remove(path);
+    written = rename(temp_path, path) == 0;
+  }
+
+  if (!written) {
+    fprintf(stderr, "Error writing texture pages: %s\n", path);
+    remove(temp_path);
+  }
+
+  return written;
+}
+
+static bool stream_valid(const texture_stream_t* stream, const char* source_path)
+{
+  const file_map_t* map = &stream->map;
+  const texture_stream_header_t* header = &stream->header;
+
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  if (map->size < sizeof(*header) || memcmp(header->magic, texture_stream_magic, sizeof(header->magic)) != 0 ||
+    header->version != TEXTURE_STREAM_VERSION || header->page_bits != TEXTURE_PAGE_BITS ||
+    !file_stat(source_path, &size, &mtime) || size != header->source_size || mtime != header->source_mtime)
+    return false;
+
+  if (!is_pow2(header->width) || !is_pow2(header->height) ||
+    header->num_levels != level_count(header->width, header->height))
+    return false;
+
+  uint32_t first_page[TEXTURE_MAX_LEVELS];
+  uint32_t pages_shift[TEXTURE_MAX_LEVELS];
+  const uint64_t page_bytes = sizeof(color_t) * page_texels;
+
+  return header->num_pages == layout_pages(header->width, header->height, header->num_levels, first_page,
+      pages_shift) &&
+    header->data_offset <= map->size && header->num_pages <= (map->size - header->data_offset) / page_bytes;
+}
+
+static bool open_pages(texture_stream_t* stream, const char* source_path)
+{
+  char path[1024];
+  texture_stream_path(path, sizeof(path), source_path);
+
+  FILE* exists = fopen(path, "rb");
+  if (!exists) return false;
+  fclose(exists);
+
+  if (!file_map_open(&stream->map, path))
+    return false;
+
+  if (stream->map.size >= sizeof(stream->header))
+    memcpy(&stream->header, stream->map.data, sizeof(stream->header));
+
+  if (!stream_valid(stream, source_path)) {
+    file_map_close(&stream->map);
+    return false;
+  }
+
+  return true;
+}
+
+// evicts the slot's page, if it has one
+static void load_page(texture_stream_t* stream, const uint32_t page, const uint32_t slot)
+{
+  const size_t page_bytes = sizeof(color_t) * page_texels;
+
+  if (stream->slot_page[slot] != TEXTURE_PAGE_NONE) {
+    stream->table[stream->slot_page[slot]] = TEXTURE_PAGE_NONE;
+    ++stream->stats.evictions;
+  }
+
+  memcpy(stream->slots + (size_t)slot * page_texels,
+    stream->map.data + stream->header.data_offset + (uint64_t)page * page_bytes, page_bytes);
+
+  stream->table[page] = slot;
+  stream->slot_page[slot] = page;
+  stream->slot_used[slot] = stream->frame;
+  ++stream->stats.loads;
+}
+
+bool texture_stream_open(texture_stream_t* stream, const char* source_path, const size_t budget)
+{
+  if (!stream || !source_path) return false;
+
+  memset(stream, 0, sizeof(*stream));
+
+  if (!open_pages(stream, source_path)) {
+    printf("Splitting %s into pages for streaming...\n", source_path);
+
+    if (!texture_stream_build(source_path) || !open_pages(stream, source_path)) {
+      fprintf(stderr, "Error opening texture pages for %s.\n", source_path);
+      return false;
+    }
+  }
+
+  const texture_stream_header_t* header = &stream->header;
+  tex2_t* texture = &stream->texture;
+
+  layout_pages(header->width, header->height, header->num_levels, stream->first_page, stream->pages_shift);
+
+  texture->size = (vec2_t) { (float)header->width, (float)header->height };
+  texture->pow2 = true;
+  texture->num_levels = header->num_levels;
+  texture->stream = stream;
+
+  uint32_t width = header->width;
+  uint32_t height = header->height;
+
+  for (uint32_t i = 0; i < header->num_levels; ++i) {
+    texture->levels[i] = (tex2_level_t) {
+      .size = { (float)width, (float)height },
+      .width = width,
+      .height = height,
+      .mask_x = width - 1,
+      .mask_y = height - 1
+    };
+
+    stream->num_pinned += width <= TEXTURE_PAGE_SIZE && height <= TEXTURE_PAGE_SIZE;
+
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+  }
+
+  const size_t page_bytes = sizeof(color_t) * page_texels;
+
+  stream->num_slots = (uint32_t)MIN(MAX(budget / page_bytes, (size_t)stream->num_pinned + TEXTURE_STREAM_LOADS_PER_FRAME),
+    (size_t)header->num_pages);
+  stream->table = malloc(sizeof(uint32_t) * header->num_pages);
+  stream->requested = calloc(header->num_pages, sizeof(uint32_t));
+  stream->slots = malloc(page_bytes * stream->num_slots);
+  stream->slot_page = malloc(sizeof(uint32_t) * stream->num_slots);
+  stream->slot_used = calloc(stream->num_slots, sizeof(uint32_t));
+
+  if (!stream->table || !stream->requested || !stream->slots || !stream->slot_page || !stream->slot_used)
+    exit(EXIT_FAILURE);
+
+  memset(stream->table, 0xFF, sizeof(uint32_t) * header->num_pages);
+  memset(stream->slot_page, 0xFF, sizeof(uint32_t) * stream->num_slots);
+
+  // 0 is never requested
+  stream->frame = 1;
+
+  // the pinned levels are the last ones, with one page each
+  for (uint32_t i = 0; i < stream->num_pinned; ++i)
+    load_page(stream, header->num_pages - stream->num_pinned + i, i);
+
+  return true;
+}
+
+void texture_stream_close(texture_stream_t* stream)
+{
+  if (!stream) return;
+
+  free(stream->table);
+  free(stream->requested);
+  free(stream->slots);
+  free(stream->slot_page);
+  free(stream->slot_used);
+  darray_free(stream->requests);
+  file_map_close(&stream->map);
+
+  memset(stream, 0, sizeof(*stream));
+}
+
+// texel x, y of level, or of the finest resident level above it, requesting the pages it misses
+static color_t page_texel(texture_stream_t* stream, uint32_t level, uint32_t x, uint32_t y)
+{
+  const uint32_t mask = TEXTURE_PAGE_SIZE - 1;
+
+  for (;;) {
+    const uint32_t page = stream->first_page[level] + ((y >> TEXTURE_PAGE_BITS) << stream->pages_shift[level]) +
+      (x >> TEXTURE_PAGE_BITS);
+    const uint32_t slot = stream->table[page];
+
+    if (slot != TEXTURE_PAGE_NONE) {
+      stream->slot_used[slot] = stream->frame;
+      return stream->slots[(size_t)slot * page_texels + ((y & mask) << TEXTURE_PAGE_BITS) + (x & mask)];
+    }
+
+    if (stream->requested[page] != stream->frame) {
+      stream->requested[page] = stream->frame;
+      darray_push(stream->requests, page);
+    }
+
+    // the last level is pinned, so this ends there at the latest
+    if (level + 1 >= stream->texture.num_levels) return 0;
+
+    ++level;
+    x >>= 1;
+    y >>= 1;
+  }
+}
+
+// nearest or bilinear, like texture_sample_level() and texture_sample_bilinear()
+static color_t sample_level(texture_stream_t* stream, const uint32_t level_index, const float u, const float v,
+  const bool bilinear)
+{
+  const tex2_level_t* level = &stream->texture.levels[level_index];
+
+  if (!bilinear) {
+    const uint32_t x = (uint32_t)(int32_t)(u * level->size.x) & level->mask_x;
+    const uint32_t y = (uint32_t)(int32_t)(v * level->size.y) & level->mask_y;
+
+    return page_texel(stream, level_index, x, y);
+  }
+
+  const int32_t sx = texture_fixed_coord(u * level->size.x - 0.5f);
+  const int32_t sy = texture_fixed_coord(v * level->size.y - 0.5f);
+  const int32_t ix = sx >= 0 ? sx >> 7 : -((-sx + 127) >> 7);
+  const int32_t iy = sy >= 0 ? sy >> 7 : -((-sy + 127) >> 7);
+
+  const uint32_t x0 = (uint32_t)ix & level->mask_x;
+  const uint32_t y0 = (uint32_t)iy & level->mask_y;
+  const uint32_t x1 = (x0 + 1) & level->mask_x;
+  const uint32_t y1 = (y0 + 1) & level->mask_y;
+
+  // each texel is translated on its own, the four may lie in different pages
+  return texture_bilerp(page_texel(stream, level_index, x0, y0), page_texel(stream, level_index, x1, y0),
+    page_texel(stream, level_index, x0, y1), page_texel(stream, level_index, x1, y1), sx & 127, sy & 127);
+}
+
+color_t texture_stream_sample(texture_stream_t* stream, const float u, const float v, float lod,
+  const bool bilinear, const bool trilinear)
+{
+  const float max_lod = (float)(stream->texture.num_levels - 1);
+  lod = lod < 0.f ? 0.f : lod > max_lod ? max_lod : lod;
+
+  if (!trilinear)
+    return sample_level(stream, (uint32_t)(lod + 0.5f), u, v, bilinear);
+
+  const uint32_t level = (uint32_t)lod;
+  const uint32_t t = (uint32_t)((lod - (float)level) * 256.f);
+  const color_t a = sample_level(stream, level, u, v, bilinear);
+
+  if (t == 0) return a;
+
+  return color_lerp(a, sample_level(stream, level + 1, u, v, bilinear), t);
+}
+
+// an empty slot, or the one of the least recently used page that wasn't sampled in this frame
+static uint32_t free_slot(const texture_stream_t* stream)
+{
+  uint32_t lru = TEXTURE_PAGE_NONE;
+
+  for (uint32_t i = stream->num_pinned; i < stream->num_slots; ++i) {
+    if (stream->slot_page[i] == TEXTURE_PAGE_NONE)
+      return i;
+
+    if (stream->slot_used[i] < stream->frame && (lru == TEXTURE_PAGE_NONE || stream->slot_used[i] < stream->slot_used[lru]))
+      lru = i;
+  }
+
+  return lru;
+}
+
+// coarser levels come later in the file, so descending pages are coarse first
+static int compare_pages_coarse_first(const void* a, const void* b)
+{
+  const uint32_t pa = *(const uint32_t*)a;
+  const uint32_t pb = *(const uint32_t*)b;
+
+  return (pa < pb) - (pa > pb);
+}
+
+void texture_stream_end_frame(texture_stream_t* stream)
+{
+  if (!stream || !stream->table) return;
+
+  const size_t num_requests = darray_size(stream->requests);
+
+  // a coarse page is the fallback of every finer page below it
+  if (num_requests > 0)
+    qsort(stream->requests, num_requests, sizeof(uint32_t), compare_pages_coarse_first);
+
+  // bounded per frame, so turning the camera doesn't stall a frame
+  size_t num_loads = 0;
+
+  for (size_t i = 0; i < num_requests && num_loads < TEXTURE_STREAM_LOADS_PER_FRAME; ++i) {
+    const uint32_t page = stream->requests[i];
+    if (stream->table[page] != TEXTURE_PAGE_NONE) continue;
+
+    const uint32_t slot = free_slot(stream);
+    if (slot == TEXTURE_PAGE_NONE) break;
+
+    load_page(stream, page, slot);
+    ++num_loads;
+  }
+
+  stream->stats.requests += num_requests;
+  darray_clear(stream->requests);
+  ++stream->frame;
+}
+
+void texture_stream_print_stats(const texture_stream_t* stream)
+{
+  if (!stream || !stream->table) return;
+
+  uint32_t num_resident = 0;
+
+  for (uint32_t i = 0; i < stream->num_slots; ++i)
+    num_resident += stream->slot_page[i] != TEXTURE_PAGE_NONE;
+
+  printf("Texture pages: %u of %u resident in %u slots (%.1f MB), requests: %llu, loads: %llu, evictions: %llu.\n",
+    num_resident, stream->header.num_pages, stream->num_slots,
+    (double)(sizeof(color_t) * page_texels * stream->num_slots) / (1024. * 1024.),
+    (unsigned long long)stream->stats.requests, (unsigned long long)stream->stats.loads,
+    (unsigned long long)stream->stats.evictions);
+}
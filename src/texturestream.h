@@ -0,0 +1,86 @@
+// Copyright 2025 Sebastian Cyliax
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "filemap.h"
+#include "types.h"
+
+// Virtual textures, for power-of-two textures far larger than memory: every level of the mip chain
+// is split into pages of 2^TEXTURE_PAGE_BITS texels squared, stored in <src>.texpages. A fixed
+// pool of page slots, sized by the budget, holds the resident pages, and a page table per level
+// maps each page to its slot. The sampler translates texel coordinates through it, records the
+// pages it missed as requests and falls back to the next coarser level that is resident. The levels
+// that fit into a single page are always resident, so every lookup ends there at the latest.
+
+#define TEXTURE_STREAM_EXTENSION ".texpages"
+#define TEXTURE_STREAM_VERSION 1
+
+#define TEXTURE_PAGE_SIZE (1u << TEXTURE_PAGE_BITS)
+#define TEXTURE_PAGE_NONE UINT32_MAX
+
+// followed by the pages at data_offset, level by level, each level's in rows of pages and each
+// page's texels in rows. Pages of levels smaller than a page repeat their last row and column.
+typedef struct texture_stream_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t num_levels;
+  uint32_t page_bits;
+  uint32_t num_pages;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t data_offset;
+} texture_stream_header_t;
+
+typedef struct texture_stream_stats {
+  uint64_t requests;
+  uint64_t loads;
+  uint64_t evictions;
+} texture_stream_stats_t;
+
+typedef struct texture_stream {
+  file_map_t map;
+  texture_stream_header_t header;
+
+  // what the renderer samples, with the sizes of the levels but no texels, stream points back here
+  tex2_t texture;
+
+  // the page table: pages of level l start at first_page[l], in rows of 2^pages_shift[l]
+  uint32_t first_page[TEXTURE_MAX_LEVELS];
+  uint32_t pages_shift[TEXTURE_MAX_LEVELS];
+  uint32_t* table;
+
+  // frame each page was last requested in, and the pages requested in the current frame (darray)
+  uint32_t* requested;
+  uint32_t* requests;
+
+  // the first num_pinned slots hold the levels that fit into one page
+  color_t* slots;
+  uint32_t* slot_page;
+  uint32_t* slot_used;
+  uint32_t num_slots;
+  uint32_t num_pinned;
+
+  uint32_t frame;
+  texture_stream_stats_t stats;
+} texture_stream_t;
+
+bool texture_stream_build(const char* source_path);
+
+// opens <source_path>.texpages, building it first if it's missing or outdated
+bool texture_stream_open(texture_stream_t* stream, const char* source_path, const size_t budget);
+void texture_stream_close(texture_stream_t* stream);
+
+// Samples like texture_sample_lod(), from the finest resident level at or above lod. Missing pages
+// are requested, and loaded by texture_stream_end_frame().
+color_t texture_stream_sample(texture_stream_t* stream, const float u, const float v, float lod,
+  const bool bilinear, const bool trilinear);
+
+// loads the requested pages, the coarsest first and at most TEXTURE_STREAM_LOADS_PER_FRAME, into
+// free slots or those of the least recently used pages that weren't sampled in this frame
+void texture_stream_end_frame(texture_stream_t* stream);
+
+void texture_stream_print_stats(const texture_stream_t* stream);
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <float.h>
+#include <math.h>
 #include "defs.h"
 #include "triangle.h"
 
@@ -10,7 +11,7 @@
 void face_print(face_t* face)
 {
   if (!face) return;
-  printf("a: %zd, b: %zd, c: %zd\n", face->a, face->b, face->c);
+  printf("a: %u, b: %u, c: %u\n", face->a, face->b, face->c);
 }
 
 void face_fix_obj_indices(face_t* face)
@@ -100,11 +101,25 @@ void tri2_flat_top(tri2_t* t, color_t color)
   }
 }
 
+static bool uses_mips(const tex2_t* texture)
+{
+  return texture && texture->num_levels > 1 && texture_filter != TEXTURE_FILTER_NEAREST;
+}
+
 void tri2_draw_texture(const tri2_t* t, const tex2_t* texture)
 {
   if (render_method == RENDER_WIRE || render_method == RENDER_WIRE_VERTEX)
     return;
 
+  if (tri2_area(t) >= (float)LARGE_TRIANGLE_AREA) {
+    tri2_draw_texture_blocks(t, texture);
+    return;
+  }
+
+  const bool mipmapped = uses_mips(texture);
+  const tri2_gradients_t gradients = mipmapped ? tri2_make_gradients(t) : (tri2_gradients_t) { 0 };
+  float lod = 0.f;
+
   const tri2_t sorted = tri2_sort_y(t);
   const vec2_t a = sorted.vertices[0];
   const vec2_t b = sorted.vertices[1];
@@ -121,9 +136,13 @@ void tri2_draw_texture(const tri2_t* t, const tex2_t* texture)
       if (x1 < x0)
         SWAP(int, &x0, &x1);
 
-      for (int x = x0; x < x1; ++x)
-        draw_texel(x, y, texture, t);
+      for (int x = x0; x < x1; ++x) {
+        if (mipmapped && ((x & 1) == 0 || x == x0))
+          lod = tri2_texture_lod(&gradients, texture, x, y);
+
+        draw_texel(x, y, texture, t, lod);
         // draw_pixel(x, y, x % 2 == 0 && y % 2 == 0 ? 0xFF000000 : 0xFFFFFFFF);
+      }
     }
   }
 
@@ -138,13 +157,179 @@ void tri2_draw_texture(const tri2_t* t, const tex2_t* texture)
       if (x1 < x0)
         SWAP(int, &x0, &x1);
 
-      for (int x = x0; x < x1; ++x)
-        draw_texel(x, y, texture, t);
+      for (int x = x0; x < x1; ++x) {
+        if (mipmapped && ((x & 1) == 0 || x == x0))
+          lod = tri2_texture_lod(&gradients, texture, x, y);
+
+        draw_texel(x, y, texture, t, lod);
         // draw_pixel(x, y, x % 2 == 0 && y % 2 == 0 ? 0xFF000000 : 0xFFFFFFFF);
+      }
     }
   }
 }
 
+static inline float edge_function(const vec2_t* a, const vec2_t* b, const float x, const float y)
+{
+  return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+// Half-space rasterization in RASTER_BLOCK_SIZE blocks. The edge functions are evaluated at the 
+// block corners: blocks outside of any edge are skipped, blocks inside all edges are shaded 
+// without per-pixel coverage tests, and only the blocks crossing an edge test every pixel.
+void tri2_draw_texture_blocks(const tri2_t* t, const tex2_t* texture)
+{
+  const vec2_t* vs = t->vertices;
+
+  const float area_doubled = edge_function(&vs[0], &vs[1], vs[2].x, vs[2].y);
+  if (area_doubled == 0.f) return;
+
+  // flip the edges of clockwise triangles, so inside is always positive
+  const float orient = area_doubled > 0.f ? 1.f : -1.f;
+  const float inv_area = 1.f / fabsf(area_doubled);
+
+  // edge i is opposite to vertex i, so its normalized value is the barycentric weight of vertex i
+  const vec2_t* edges[3][2] = {
+    { &vs[1], &vs[2] },
+    { &vs[2], &vs[0] },
+    { &vs[0], &vs[1] }
+  };
+
+  float step_x[3];
+  float step_y[3];
+
+  for (int i = 0; i < 3; ++i) {
+    step_x[i] = -(edges[i][1]->y - edges[i][0]->y) * orient;
+    step_y[i] =  (edges[i][1]->x - edges[i][0]->x) * orient;
+  }
+
+  const int min_x = MAX((int)floorf(MIN(MIN(vs[0].x, vs[1].x), vs[2].x)), 0);
+  const int min_y = MAX((int)floorf(MIN(MIN(vs[0].y, vs[1].y), vs[2].y)), 0);
+  const int max_x = MIN((int)ceilf(MAX(MAX(vs[0].x, vs[1].x), vs[2].x)), WINDOW_WIDTH - 1);
+  const int max_y = MIN((int)ceilf(MAX(MAX(vs[0].y, vs[1].y), vs[2].y)), WINDOW_HEIGHT - 1);
+
+  const bool mipmapped = uses_mips(texture);
+  const tri2_gradients_t gradients = mipmapped ? tri2_make_gradients(t) : (tri2_gradients_t) { 0 };
+  float lod = 0.f;
+
+  const int block_mask = ~(RASTER_BLOCK_SIZE - 1);
+  const int last = RASTER_BLOCK_SIZE - 1;
+
+  for (int by = min_y & block_mask; by <= max_y; by += RASTER_BLOCK_SIZE) {
+    for (int bx = min_x & block_mask; bx <= max_x; bx += RASTER_BLOCK_SIZE) {
+      float origin[3];
+      int inside_all = 1;
+      int outside_any = 0;
+
+      for (int i = 0; i < 3; ++i) {
+        origin[i] = edge_function(edges[i][0], edges[i][1], (float)bx, (float)by) * orient;
+
+        const float e00 = origin[i];
+        const float e10 = e00 + step_x[i] * last;
+        const float e01 = e00 + step_y[i] * last;
+        const float e11 = e10 + step_y[i] * last;
+
+        const int inside = (e00 >= 0.f) + (e10 >= 0.f) + (e01 >= 0.f) + (e11 >= 0.f);
+
+        inside_all &= inside == 4;
+        outside_any |= inside == 0;
+      }
+
+      if (outside_any) continue;
+
+      const int x_end = MIN(bx + last, max_x);
+      const int y_end = MIN(by + last, max_y);
+      const int x_start = MAX(bx, min_x);
+      const int y_start = MAX(by, min_y);
+
+      for (int y = y_start; y <= y_end; ++y) {
+        float w[3];
+
+        for (int i = 0; i < 3; ++i)
+          w[i] = origin[i] + step_x[i] * (x_start - bx) + step_y[i] * (y - by);
+
+        if (inside_all) {
+          for (int x = x_start; x <= x_end; ++x) {
+            if (mipmapped && ((x & 1) == 0 || x == x_start))
+              lod = tri2_texture_lod(&gradients, texture, x, y);
+
+            const vec3_t weights = { w[0] * inv_area, w[1] * inv_area, w[2] * inv_area };
+            draw_texel_weighted(x, y, texture, t, &weights, lod);
+
+            w[0] += step_x[0];
+            w[1] += step_x[1];
+            w[2] += step_x[2];
+          }
+
+          continue;
+        }
+
+        for (int x = x_start; x <= x_end; ++x) {
+          if (mipmapped && ((x & 1) == 0 || x == x_start))
+            lod = tri2_texture_lod(&gradients, texture, x, y);
+
+          if (w[0] >= 0.f && w[1] >= 0.f && w[2] >= 0.f) {
+            const vec3_t weights = { w[0] * inv_area, w[1] * inv_area, w[2] * inv_area };
+            draw_texel_weighted(x, y, texture, t, &weights, lod);
+          }
+
+          w[0] += step_x[0];
+          w[1] += step_x[1];
+          w[2] += step_x[2];
+        }
+      }
+    }
+  }
+}
+
+static vec3_t make_plane(const vec2_t* vs, const float a0, const float a1, const float a2)
+{
+  const float d = (vs[1].x - vs[0].x) * (vs[2].y - vs[0].y) - (vs[2].x - vs[0].x) * (vs[1].y - vs[0].y);
+  if (d == 0.f) return (vec3_t) { 0.f, 0.f, a0 };
+
+  const float dx = ((a1 - a0) * (vs[2].y - vs[0].y) - (a2 - a0) * (vs[1].y - vs[0].y)) / d;
+  const float dy = ((a2 - a0) * (vs[1].x - vs[0].x) - (a1 - a0) * (vs[2].x - vs[0].x)) / d;
+
+  return (vec3_t) { dx, dy, a0 - dx * vs[0].x - dy * vs[0].y };
+}
+
+tri2_gradients_t tri2_make_gradients(const tri2_t* t)
+{
+  const uv_t* uv = t->tex_coords;
+  const float* q = t->inv_depth;
+
+  return (tri2_gradients_t) {
+    .u = make_plane(t->vertices, uv[0].u * q[0], uv[1].u * q[1], uv[2].u * q[2]),
+    .v = make_plane(t->vertices, uv[0].v * q[0], uv[1].v * q[1], uv[2].v * q[2]),
+    .q = make_plane(t->vertices, q[0], q[1], q[2])
+  };
+}
+
+// The mip level for the 2x2 quad containing x, y: the log2 of the larger of the texel footprints 
+// of a pixel step in x and in y, both taken at the quad's origin so the quad shares one level. 
+// The uv derivatives follow from the quotient rule, d(u/w / q) = (d(u/w) - u * dq) / q.
+float tri2_texture_lod(const tri2_gradients_t* g, const tex2_t* texture, const int x, const int y)
+{
+  const float px = (float)(x & ~1);
+  const float py = (float)(y & ~1);
+  const float q = g->q.x * px + g->q.y * py + g->q.z;
+
+  if (q <= 0.f) return 0.f;
+
+  const float inv_q = 1.f / q;
+  const float u = (g->u.x * px + g->u.y * py + g->u.z) * inv_q;
+  const float v = (g->v.x * px + g->v.y * py + g->v.z) * inv_q;
+
+  const float du_dx = (g->u.x - u * g->q.x) * inv_q * texture->size.x;
+  const float dv_dx = (g->v.x - v * g->q.x) * inv_q * texture->size.y;
+  const float du_dy = (g->u.y - u * g->q.y) * inv_q * texture->size.x;
+  const float dv_dy = (g->v.y - v * g->q.y) * inv_q * texture->size.y;
+
+  const float footprint = MAX(du_dx * du_dx + dv_dx * dv_dx, du_dy * du_dy + dv_dy * dv_dy);
+  if (footprint <= 1.f) return 0.f;
+
+  return 0.5f * log2f(footprint);
+}
+
 tri2_t tri2_sort_y(const tri2_t* t)
 {
   vec2_t a = t->vertices[0];
@@ -194,6 +379,14 @@ void tri2_round(tri2_t* t)
   t->vertices[2].y = roundf(t->vertices[2].y);
 }
 
+float tri2_area(const tri2_t* t)
+{
+  if (!t) return 0.f;
+
+  const vec2_t* vs = t->vertices;
+  return 0.5f * fabsf((vs[1].x - vs[0].x) * (vs[2].y - vs[0].y) - (vs[1].y - vs[0].y) * (vs[2].x - vs[0].x));
+}
+
 vec3_t tri2_barycentric_weights(const tri2_t* t, vec2_t p)
 {
   const float even_split = 1.f / 3.f;
@@ -234,5 +427,6 @@ const tri2_t tri2_null = {
   },
 
   .color = 0x00000000,
-  .inv_depth = 1.f / FLT_MAX
+  .inv_depth = 1.f / FLT_MAX,
+  .material = MATERIAL_NONE
 };
@@ -4,6 +4,14 @@
 
 #include "types.h"
 
+// screen space plane equations (x, y, constant) of u / w, v / w and 1 / w, which unlike u and v
+// are linear in screen space
+typedef struct tri2_gradients {
+  vec3_t u;
+  vec3_t v;
+  vec3_t q;
+} tri2_gradients_t;
+
 void    face_print(face_t* face);
 void    face_fix_obj_indices(face_t* face);
 
@@ -12,11 +20,15 @@ void    tri2_fill(const tri2_t* t, color_t color);
 void    tri2_flat_bottom(tri2_t* t, color_t color);
 void    tri2_flat_top(tri2_t* t, color_t color);
 void    tri2_draw_texture(const tri2_t* t, const tex2_t* texture);
+void    tri2_draw_texture_blocks(const tri2_t* t, const tex2_t* texture);
 tri2_t  tri2_sort_y(const tri2_t* t);
 void    tri2_sort(tri2_t* t);
 void    tri2_swap(tri2_t* a, tri2_t* b);
 void    tri2_round(tri2_t* t);
+float   tri2_area(const tri2_t* t);
 vec3_t  tri2_barycentric_weights(const tri2_t* t, vec2_t p);
+tri2_gradients_t tri2_make_gradients(const tri2_t* t);
+float   tri2_texture_lod(const tri2_gradients_t* g, const tex2_t* texture, const int x, const int y);
 
 extern const tri2_t tri2_null;
 
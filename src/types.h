@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "defs.h"
+#include "filemap.h"
 
 enum plane_type {
   PLANE_RIGHT,
@@ -54,22 +55,66 @@ typedef struct uv {
   float v;
 } uv_t;
 
+// unique combination of attributes, shared by all faces that reference it
+typedef struct vertex {
+  vec3_t position;
+  uv_t uv;
+  vec3_t normal;
+} vertex_t;
+
+// 12 byte vertex of quantized meshes: positions and uvs are 16-bit fractions of the mesh's
+// bounds and uv range, normals 8-bit octahedral. Decoded with the mesh's vertex_quantization_t.
+typedef struct packed_vertex {
+  uint16_t position[3];
+  int8_t normal[2];
+  uint16_t uv[2];
+} packed_vertex_t;
+
+// value = min + quantized * scale
+typedef struct vertex_quantization {
+  vec3_t position_min;
+  vec3_t position_scale;
+  uv_t uv_min;
+  uv_t uv_scale;
+} vertex_quantization_t;
+
 // vertex indices of the corresponding mesh
 typedef struct face {
-  size_t a;
-  size_t b;
-  size_t c;
-  uv_t tex_coords[3]; // [0] = tex coords of a, etc.
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
   color_t color;
-  int clipped_plane;
+  uint32_t material; // index into mesh_t::materials, or MATERIAL_NONE
 } face_t;
 
+// face being clipped against the frustum, with its own copy of the attributes that change
+typedef struct clip_face {
+  uv_t tex_coords[3]; // [0] = tex coords of a, etc.
+  int clipped_plane;
+} clip_face_t;
+
+#define MATERIAL_NONE UINT32_MAX
+
+typedef struct material {
+  char name[64];
+  color_t diffuse;
+  char texture_path[256];
+} material_t;
+
+// consecutive faces following an "o" or "g" statement
+typedef struct mesh_group {
+  char name[64];
+  uint32_t first_face;
+  uint32_t num_faces;
+} mesh_group_t;
+
 // triangle 2d projection
 typedef struct tri2 {
   vec2_t vertices[3];
   uv_t tex_coords[3];
   float inv_depth[3];
   color_t color;
+  uint32_t material; // of the face it's projected from, or MATERIAL_NONE
 } tri2_t;
 
 typedef struct tri4 {
@@ -79,18 +124,71 @@ typedef struct tri4 {
   color_t color;
 } tri4_t;
 
+// one level of a mip chain, rows of stride texels or, if compressed, rows of 4x4 texel blocks
+typedef struct tex2_level {
+  const color_t* data;
+  const uint64_t* blocks;
+  vec2_t size;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+  uint32_t mask_x;
+  uint32_t mask_y;
+  uint32_t stride_shift;
+  uint32_t tile_mask;
+  uint32_t tile_bits;
+  uint32_t tiles_shift;
+  uint32_t blocks_shift;
+  uint32_t id;
+} tex2_level_t;
+
+// refers to a texture registered in textures.h, 0 is no texture
+typedef uint32_t texture_handle_t;
+
+#define TEXTURE_INVALID 0
+
+// The base level is either heap allocated (owned) or a view of memory owned elsewhere, e.g. an
+// asset pack. The smaller levels are always built at load into mip_data, and everything owned is
+// released through texture_free(). Power-of-two textures whose stride is a power of two too (pow2)
+// are sampled with masks and shifts, on every level. Their levels are usually stored in square
+// tiles (tiled) rather than in rows, so texels that are close in any direction share cache lines.
+// Large power-of-two textures are compressed to BC1 blocks of 8 bytes per 4x4 texels instead, which
+// are stored in mip_blocks below the base and decoded while sampling. Textures loaded from a texture
+// cache file view all their levels in its mapping, which texture_free() closes. Virtual textures
+// have no texels of their own, they are sampled through their stream (see texturestream.h).
 typedef struct tex2 {
-  color_t data[TEXTURE_SIZE * TEXTURE_SIZE];
   vec2_t size;
+  bool pow2;
+  bool tiled;
+  bool compressed;
+  bool owned;
+  uint32_t num_levels;
+  color_t* mip_data;
+  uint64_t* mip_blocks;
+  file_map_t mapping;
+  struct texture_stream* stream;
+  tex2_level_t levels[TEXTURE_MAX_LEVELS];
 } tex2_t;
 
+// vertices and faces are darrays, which may point into a mapped mesh cache file 
+// (mapping.data != NULL) or into an asset pack mapped by someone else (borrowed);
+// those have to be released through mesh_free() and must not grow.
+// Quantized meshes have packed_vertices instead of vertices.
 typedef struct mesh {
-  vec3_t* vertices;
+  vertex_t* vertices;
+  packed_vertex_t* packed_vertices;
+  vertex_quantization_t quantization;
   face_t* faces;
+  material_t* materials;
+  mesh_group_t* groups;
+  vec3_t bounds_min;
+  vec3_t bounds_max;
+  file_map_t mapping;
+  bool borrowed;
   vec3_t scale;
   rot3_t rotation;
   vec3_t translation;
-  tex2_t texture;
+  texture_handle_t texture;
 } mesh_t;
 
 typedef struct plane {
@@ -0,0 +1,96 @@
+// Copyright 2025 Sebastian Cyliax
+
+// Checks that mesh_parse_glb rejects files whose header is cut short or claims a length too short
+// for the JSON chunk header, instead of reading past the mapping.
+// Usage: glb_header_test [path]
+// The test files are written to path, which is removed afterwards.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "../src/mesh.h"
+#include "../src/meshglb.h"
+
+#define DEFAULT_PATH "glb_header_test.glb"
+
+typedef struct header_case {
+  const char* name;
+  size_t file_size;
+  uint32_t length;
+  uint32_t json_size;
+} header_case_t;
+
+static void write_u32(uint8_t* p, const uint32_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static bool write_case(const char* filepath, const header_case_t* test)
+{
+  uint8_t data[64] = { 0 };
+
+  write_u32(data, GLB_MAGIC);
+  write_u32(data + 4, GLB_VERSION);
+  write_u32(data + 8, test->length);
+
+  // a JSON chunk header that would reach far beyond the file, with an unterminated string that
+  // keeps the parser reading up to its end
+  if (test->file_size >= 20) {
+    write_u32(data + 12, test->json_size);
+    write_u32(data + 16, GLB_CHUNK_JSON);
+    memset(data + 20, 'a', sizeof(data) - 20);
+    memcpy(data + 20, "[\"", 2);
+  }
+
+  FILE* file = fopen(filepath, "wb");
+
+  if (!file) {
+    perror("Error creating file");
+    return false;
+  }
+
+  const bool written = fwrite(data, 1, test->file_size, file) == test->file_size;
+  fclose(file);
+
+  return written;
+}
+
+int main(int argc, char* argv[])
+{
+  const char* filepath = argc > 1 ? argv[1] : DEFAULT_PATH;
+
+  const header_case_t cases[] = {
+    { "header only", 12, 12, 0 },
+    { "length of the header", 64, 12, 0xFFFFFF00u },
+    { "length inside the chunk header", 64, 19, 0xFFFFFF00u },
+    { "length of the chunk header", 64, 20, 0xFFFFFF00u }
+  };
+
+  size_t num_failed = 0;
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    if (!write_case(filepath, &cases[i]))
+      return EXIT_FAILURE;
+
+    mesh_t mesh = { 0 };
+    mesh_parse_glb(&mesh, filepath);
+
+    const bool rejected = !mesh.vertices && !mesh.faces;
+    printf("%-32s %s\n", cases[i].name, rejected ? "rejected" : "FAILED, parsed");
+
+    num_failed += !rejected;
+    mesh_free(&mesh);
+  }
+
+  remove(filepath);
+
+  return num_failed == 0 ? 0 : EXIT_FAILURE;
+}